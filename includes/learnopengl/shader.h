@@ -13,9 +13,9 @@ class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // constructor generates the shader on the fly, optional defines are inserted after the #version line of every stage
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr)
+    Shader(const char* vertexPath, const char* fragmentPath, const char* geometryPath = nullptr, const std::string& defines = "")
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -57,6 +57,12 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
+        if(!defines.empty())
+        {
+            vertexCode = insertDefines(vertexCode, defines);
+            fragmentCode = insertDefines(fragmentCode, defines);
+            geometryCode = insertDefines(geometryCode, defines);
+        }
         const char* vShaderCode = vertexCode.c_str();
         const char * fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
@@ -162,6 +168,16 @@ public:
     }
 
 private:
+    // #version must stay the first directive, so defines go right after it
+    // ------------------------------------------------------------------------
+    static std::string insertDefines(const std::string& code, const std::string& defines)
+    {
+        size_t version = code.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        if(lineEnd == std::string::npos)
+            return code;
+        return code.substr(0, lineEnd + 1) + defines + code.substr(lineEnd + 1);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
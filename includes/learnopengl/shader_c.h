@@ -15,7 +15,7 @@ public:
     unsigned int ID;
     // constructor generates the shader on the fly
     // ------------------------------------------------------------------------
-    ComputeShader(const char* computePath)
+    ComputeShader(const char* computePath, const std::string& defines = "")
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string computeCode;
@@ -39,6 +39,8 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
+        if(!defines.empty())
+            computeCode = insertDefines(computeCode, defines);
         const char* cShaderCode = computeCode.c_str();
         // 2. compile shaders
         unsigned int compute;
@@ -122,6 +124,16 @@ public:
     }
 
 private:
+    // #version must stay the first directive, so defines go right after it
+    // ------------------------------------------------------------------------
+    static std::string insertDefines(const std::string& code, const std::string& defines)
+    {
+        size_t version = code.find("#version");
+        size_t lineEnd = version == std::string::npos ? std::string::npos : code.find('\n', version);
+        if(lineEnd == std::string::npos)
+            return code;
+        return code.substr(0, lineEnd + 1) + defines + code.substr(lineEnd + 1);
+    }
     // utility function for checking shader compilation/linking errors.
     // ------------------------------------------------------------------------
     void checkCompileErrors(GLuint shader, std::string type)
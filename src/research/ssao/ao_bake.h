@@ -0,0 +1,192 @@
+#ifndef AO_BAKE_H
+#define AO_BAKE_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+
+#include <learnopengl/model.h>
+
+#include "ao_raytracer.h"
+#include "parallel_for.h"
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// vertex attribute of the baked AO, after the bone attributes of Mesh (geometry.vs)
+const unsigned int AO_BAKE_ATTRIBUTE = 7;
+const uint32_t AO_BAKE_CACHE_VERSION = 1;
+
+// Self-occlusion of a static model: for every vertex the share of cosine weighted hemisphere rays around the vertex
+// normal not blocked by the model itself within settings.radius (model space), like the reference AO of a pixel.
+// Occlusion by other objects is left to the screen space AO.
+struct AOBake
+{
+    uint64_t sourceHash = 0;
+    int samples = 0;
+    float radius = 0.0f;
+    std::vector<std::vector<float>> meshes; // per vertex AO of every mesh, 1 unoccluded
+};
+
+// FNV-1a of the file contents, false if the file can't be read
+inline bool hashAOBakeSource(const std::string& path, uint64_t& hash)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    hash = 14695981039346656037ull;
+    char buffer[65536];
+    while (file.read(buffer, sizeof(buffer)) || file.gcount() > 0)
+    {
+        for (std::streamsize i = 0; i < file.gcount(); i++)
+            hash = (hash ^ (unsigned char)buffer[i]) * 1099511628211ull;
+    }
+    return true;
+}
+
+// {file name without extension}_{source hash}.aobake in the working directory
+inline std::string getAOBakeCachePath(const std::string& sourcePath, uint64_t sourceHash)
+{
+    std::string name = sourcePath.substr(sourcePath.find_last_of("/\\") + 1);
+    name = name.substr(0, name.find_last_of('.'));
+    char hash[17];
+    snprintf(hash, sizeof(hash), "%016llx", (unsigned long long)sourceHash);
+    return name + "_" + hash + ".aobake";
+}
+
+// vertices of all meshes are traced in parallel, each with the packets of the reference renderer
+inline AOBake bakeVertexAO(const Model& model, const AOReferenceSettings& settings)
+{
+    AOScene scene;
+    scene.addModel(model, glm::mat4(1.0f));
+    scene.build();
+    AOBake bake;
+    bake.samples = settings.samples;
+    bake.radius = settings.radius;
+    for (size_t m = 0; m < model.meshes.size(); m++)
+    {
+        const Mesh& mesh = model.meshes[m];
+        std::vector<float>& ao = bake.meshes.emplace_back(mesh.vertices.size(), 1.0f);
+        parallelFor((int)mesh.vertices.size(), [&](int i)
+        {
+            const Vertex& vertex = mesh.vertices[i];
+            float length = glm::length(vertex.Normal);
+            if (length == 0.0f)
+                return;
+            AOSurface surface;
+            surface.normal = vertex.Normal / length;
+            surface.origin = vertex.Position + surface.normal * 1e-4f;
+            surface.hit = true;
+            // vertex and mesh index seed the sample rotation like pixel coordinates
+            ao[i] = traceAOSamples(scene, surface, i, (int)m, settings);
+        });
+    }
+    return bake;
+}
+
+inline bool saveAOBake(const std::string& path, const AOBake& bake)
+{
+    std::ofstream file(path, std::ios::binary);
+    if (!file)
+    {
+        std::cout << "ERROR::AO_BAKE::FAILED_TO_WRITE: " << path << std::endl;
+        return false;
+    }
+    uint32_t meshCount = (uint32_t)bake.meshes.size();
+    file.write("AOBK", 4);
+    file.write((const char*)&AO_BAKE_CACHE_VERSION, sizeof(AO_BAKE_CACHE_VERSION));
+    file.write((const char*)&bake.sourceHash, sizeof(bake.sourceHash));
+    file.write((const char*)&bake.samples, sizeof(bake.samples));
+    file.write((const char*)&bake.radius, sizeof(bake.radius));
+    file.write((const char*)&meshCount, sizeof(meshCount));
+    for (const auto& ao : bake.meshes)
+    {
+        uint32_t vertexCount = (uint32_t)ao.size();
+        file.write((const char*)&vertexCount, sizeof(vertexCount));
+        file.write((const char*)ao.data(), ao.size() * sizeof(float));
+    }
+    return (bool)file;
+}
+
+// false if there is no cache file or it does not match the model and settings
+inline bool loadAOBake(const std::string& path, const Model& model, uint64_t sourceHash, const AOReferenceSettings& settings, AOBake& bake)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        return false;
+    char magic[4];
+    uint32_t version = 0, meshCount = 0;
+    file.read(magic, 4);
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&bake.sourceHash, sizeof(bake.sourceHash));
+    file.read((char*)&bake.samples, sizeof(bake.samples));
+    file.read((char*)&bake.radius, sizeof(bake.radius));
+    file.read((char*)&meshCount, sizeof(meshCount));
+    if (!file || std::string(magic, 4) != "AOBK" || version != AO_BAKE_CACHE_VERSION || bake.sourceHash != sourceHash ||
+        bake.samples != settings.samples || bake.radius != settings.radius || meshCount != model.meshes.size())
+        return false;
+    bake.meshes.resize(meshCount);
+    for (uint32_t m = 0; m < meshCount; m++)
+    {
+        uint32_t vertexCount = 0;
+        file.read((char*)&vertexCount, sizeof(vertexCount));
+        if (!file || vertexCount != model.meshes[m].vertices.size())
+            return false;
+        bake.meshes[m].resize(vertexCount);
+        file.read((char*)bake.meshes[m].data(), vertexCount * sizeof(float));
+    }
+    return (bool)file;
+}
+
+// bake of the model loaded from sourcePath, read from the cache when the file hash and settings match,
+// otherwise baked and written to the cache; false if the source can't be read
+inline bool loadOrBakeVertexAO(const std::string& sourcePath, const Model& model, const AOReferenceSettings& settings, AOBake& bake)
+{
+    uint64_t sourceHash;
+    if (!hashAOBakeSource(sourcePath, sourceHash))
+    {
+        std::cout << "ERROR::AO_BAKE::FAILED_TO_READ: " << sourcePath << std::endl;
+        return false;
+    }
+    std::string cachePath = getAOBakeCachePath(sourcePath, sourceHash);
+    if (loadAOBake(cachePath, model, sourceHash, settings, bake))
+    {
+        printf("ao bake: %s loaded\n", cachePath.c_str());
+        return true;
+    }
+    auto start = std::chrono::steady_clock::now();
+    bake = bakeVertexAO(model, settings);
+    bake.sourceHash = sourceHash;
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t vertexCount = 0;
+    for (const auto& ao : bake.meshes)
+        vertexCount += ao.size();
+    printf("ao bake: %zu vertices (%d samples, radius %.2f) in %.2f s, written to %s\n", vertexCount, settings.samples,
+        settings.radius, seconds, cachePath.c_str());
+    saveAOBake(cachePath, bake);
+    return true;
+}
+
+// uploads the bake into a buffer per mesh and binds it to AO_BAKE_ATTRIBUTE of the mesh VAO,
+// the buffer names are appended to buffers
+inline void uploadAOBake(const Model& model, const AOBake& bake, std::vector<unsigned int>& buffers)
+{
+    for (size_t m = 0; m < model.meshes.size() && m < bake.meshes.size(); m++)
+    {
+        unsigned int buffer;
+        glGenBuffers(1, &buffer);
+        glBindVertexArray(model.meshes[m].VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, buffer);
+        glBufferData(GL_ARRAY_BUFFER, bake.meshes[m].size() * sizeof(float), bake.meshes[m].data(), GL_STATIC_DRAW);
+        glEnableVertexAttribArray(AO_BAKE_ATTRIBUTE);
+        glVertexAttribPointer(AO_BAKE_ATTRIBUTE, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+        glBindVertexArray(0);
+        buffers.push_back(buffer);
+    }
+}
+
+#endif
@@ -0,0 +1,910 @@
+#ifndef AO_BVH_H
+#define AO_BVH_H
+
+#include <glm/glm.hpp>
+
+#include "parallel_for.h"
+#include "simd_float.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define AO_BVH_SSE
+#endif
+
+// centroid bins per axis of the SAH split search
+const int AO_BVH_BINS = 16;
+// nodes with more primitives than this bin their centroids on all threads
+const uint32_t AO_BVH_PARALLEL_BINNING_SIZE = 32768;
+// subtrees smaller than this are built by a single thread
+const uint32_t AO_BVH_MIN_SUBTREE_SIZE = 1024;
+// deeper nodes are split at the median, which bounds the traversal stack
+const uint32_t AO_BVH_MAX_SAH_DEPTH = 64;
+// rays traced together by the packet traversal
+const int AO_RAY_PACKET_SIZE = 8;
+// packets with fewer active rays than this finish the subtrees left on their stack ray by ray
+const int AO_RAY_PACKET_MIN_ACTIVE = 3;
+
+// ray with precomputed reciprocal direction for the box tests
+struct AORay
+{
+    glm::vec3 origin;
+    glm::vec3 direction;
+    glm::vec3 invDirection;
+
+    AORay() = default;
+
+    AORay(const glm::vec3& origin, const glm::vec3& direction) : origin(origin), direction(direction)
+    {
+        // zero components would turn into NaNs in the slab test (0 * inf)
+        for (int i = 0; i < 3; i++)
+            invDirection[i] = 1.0f / (fabsf(direction[i]) > 1e-20f ? direction[i] : 1e-20f);
+    }
+};
+
+// Up to AO_RAY_PACKET_SIZE rays in structure of arrays layout, for the box tests of a packet in vector lanes.
+// Bit i of active is set if ray i is traced; a ray only reports hits closer than its maxDistance.
+struct AORayPacket
+{
+    int count = 0;
+    uint32_t active = 0;
+    float origin[3][AO_RAY_PACKET_SIZE] = {};
+    float direction[3][AO_RAY_PACKET_SIZE] = {};
+    float invDirection[3][AO_RAY_PACKET_SIZE] = {};
+    float maxDistance[AO_RAY_PACKET_SIZE] = {};
+
+    void setRay(int i, const AORay& ray, float rayMaxDistance)
+    {
+        for (int k = 0; k < 3; k++)
+        {
+            origin[k][i] = ray.origin[k];
+            direction[k][i] = ray.direction[k];
+            invDirection[k][i] = ray.invDirection[k];
+        }
+        maxDistance[i] = rayMaxDistance;
+        active |= 1u << i;
+        count = std::max(count, i + 1);
+    }
+
+    void add(const AORay& ray, float rayMaxDistance)
+    {
+        setRay(count, ray, rayMaxDistance);
+    }
+
+    AORay getRay(int i) const
+    {
+        AORay ray;
+        ray.origin = glm::vec3(origin[0][i], origin[1][i], origin[2][i]);
+        ray.direction = glm::vec3(direction[0][i], direction[1][i], direction[2][i]);
+        ray.invDirection = glm::vec3(invDirection[0][i], invDirection[1][i], invDirection[2][i]);
+        return ray;
+    }
+};
+
+// number of rays set in a packet mask
+inline int countAORays(uint32_t mask)
+{
+    int count = 0;
+    for (; mask != 0; mask &= mask - 1)
+        count++;
+    return count;
+}
+
+// triangles per BVH leaf, tested together with one 4-wide SIMD test
+const int AO_BVH_BLOCK_SIZE = 4;
+
+// first vertex and two edges of four triangles, unused lanes have zero edges and are never hit
+struct alignas(16) AOTriangleBlock
+{
+    float v0[3][AO_BVH_BLOCK_SIZE];
+    float e1[3][AO_BVH_BLOCK_SIZE];
+    float e2[3][AO_BVH_BLOCK_SIZE];
+};
+
+// children of an inner node are stored next to each other at leftFirst, leaves (count > 0) point to their primitives
+struct AOBvhNode
+{
+    glm::vec3 boundsMin = glm::vec3(0.0f);
+    uint32_t leftFirst = 0;
+    glm::vec3 boundsMax = glm::vec3(0.0f);
+    uint32_t count = 0;
+};
+
+static_assert(sizeof(AOBvhNode) == 32, "two BVH nodes per cache line");
+
+// bounds of a primitive the BVH is built over (a triangle, or an instance for the top level of AOScene)
+struct AOBvhPrimitive
+{
+    glm::vec3 boundsMin, boundsMax, centroid;
+    uint32_t index;
+};
+
+// Binned SAH builder: every split takes the cheapest of AO_BVH_BINS - 1 planes per axis by surface area heuristic.
+// The top of the tree is split by the calling thread (binning large nodes on all threads) until there are enough
+// independent subtrees, which are then built in parallel and appended to the node array.
+// Leaves hold up to leafSize primitives; primitives are reordered so a leaf's primitives are contiguous at leftFirst.
+inline void buildAOBvh(std::vector<AOBvhPrimitive>& primitives, std::vector<AOBvhNode>& nodes, uint32_t leafSize, int threadCount = 0)
+{
+    struct Bin
+    {
+        glm::vec3 boundsMin = glm::vec3(INFINITY);
+        glm::vec3 boundsMax = glm::vec3(-INFINITY);
+        uint32_t count = 0;
+
+        void grow(const AOBvhPrimitive& primitive)
+        {
+            boundsMin = glm::min(boundsMin, primitive.boundsMin);
+            boundsMax = glm::max(boundsMax, primitive.boundsMax);
+            count++;
+        }
+
+        void grow(const Bin& bin)
+        {
+            boundsMin = glm::min(boundsMin, bin.boundsMin);
+            boundsMax = glm::max(boundsMax, bin.boundsMax);
+            count += bin.count;
+        }
+
+        float getArea() const
+        {
+            glm::vec3 extent = boundsMax - boundsMin;
+            return count > 0 ? extent.x * extent.y + extent.y * extent.z + extent.z * extent.x : 0.0f;
+        }
+    };
+
+    struct Task
+    {
+        uint32_t node, first, count, depth;
+    };
+
+    if (threadCount <= 0)
+        threadCount = getHardwareThreadCount();
+
+    // bounds of the node, then either a leaf or the children as two new tasks; chunks > 1 bins on that many threads
+    auto splitNode = [&](std::vector<AOBvhNode>& nodeArray, const Task& task, int chunks, Task* children) -> bool
+    {
+        AOBvhPrimitive* begin = primitives.data() + task.first;
+        uint32_t count = task.count;
+        chunks = std::max(1, std::min(chunks, (int)(count / 4096)));
+        uint32_t chunkSize = (count + chunks - 1) / chunks;
+
+        std::vector<Bin> chunkBounds(chunks), chunkCentroids(chunks);
+        auto boundChunk = [&](int chunk)
+        {
+            for (uint32_t i = chunk * chunkSize; i < std::min(count, (chunk + 1) * chunkSize); i++)
+            {
+                chunkBounds[chunk].grow(begin[i]);
+                chunkCentroids[chunk].boundsMin = glm::min(chunkCentroids[chunk].boundsMin, begin[i].centroid);
+                chunkCentroids[chunk].boundsMax = glm::max(chunkCentroids[chunk].boundsMax, begin[i].centroid);
+            }
+        };
+        if (chunks > 1)
+            parallelFor(chunks, boundChunk, chunks);
+        else
+            boundChunk(0);
+        Bin bounds, centroids;
+        for (int chunk = 0; chunk < chunks; chunk++)
+        {
+            bounds.grow(chunkBounds[chunk]);
+            centroids.grow(chunkCentroids[chunk]);
+        }
+        AOBvhNode& node = nodeArray[task.node];
+        node.boundsMin = bounds.boundsMin;
+        node.boundsMax = bounds.boundsMax;
+        if (count <= leafSize)
+        {
+            node.leftFirst = task.first;
+            node.count = count;
+            return false;
+        }
+
+        glm::vec3 extent = centroids.boundsMax - centroids.boundsMin;
+        glm::vec3 scale = glm::vec3((float)AO_BVH_BINS) / glm::max(extent, glm::vec3(1e-30f));
+        auto getBin = [&](const AOBvhPrimitive& primitive, int axis)
+        {
+            int bin = (int)((primitive.centroid[axis] - centroids.boundsMin[axis]) * scale[axis]);
+            return std::min(std::max(bin, 0), AO_BVH_BINS - 1);
+        };
+        std::vector<Bin> chunkBins((size_t)chunks * 3 * AO_BVH_BINS);
+        auto binChunk = [&](int chunk)
+        {
+            Bin* bins = chunkBins.data() + (size_t)chunk * 3 * AO_BVH_BINS;
+            for (uint32_t i = chunk * chunkSize; i < std::min(count, (chunk + 1) * chunkSize); i++)
+            {
+                for (int axis = 0; axis < 3; axis++)
+                    bins[axis * AO_BVH_BINS + getBin(begin[i], axis)].grow(begin[i]);
+            }
+        };
+        if (chunks > 1)
+            parallelFor(chunks, binChunk, chunks);
+        else
+            binChunk(0);
+
+        // sweep every axis: cost of splitting after bin i is area * count of both sides
+        float bestCost = INFINITY;
+        int bestAxis = -1, bestSplit = 0;
+        for (int axis = 0; axis < 3; axis++)
+        {
+            if (extent[axis] <= 0.0f)
+                continue;
+            Bin bins[AO_BVH_BINS];
+            for (int chunk = 0; chunk < chunks; chunk++)
+            {
+                for (int i = 0; i < AO_BVH_BINS; i++)
+                    bins[i].grow(chunkBins[((size_t)chunk * 3 + axis) * AO_BVH_BINS + i]);
+            }
+            float leftCost[AO_BVH_BINS];
+            Bin left, right;
+            for (int i = 0; i < AO_BVH_BINS - 1; i++)
+            {
+                left.grow(bins[i]);
+                leftCost[i] = left.getArea() * left.count;
+            }
+            for (int i = AO_BVH_BINS - 1; i > 0; i--)
+            {
+                right.grow(bins[i]);
+                float cost = leftCost[i - 1] + right.getArea() * right.count;
+                if (cost < bestCost)
+                {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestSplit = i;
+                }
+            }
+        }
+
+        uint32_t leftCount = 0;
+        if (bestAxis >= 0 && task.depth < AO_BVH_MAX_SAH_DEPTH)
+        {
+            AOBvhPrimitive* middle = std::partition(begin, begin + count, [&](const AOBvhPrimitive& primitive)
+            {
+                return getBin(primitive, bestAxis) < bestSplit;
+            });
+            leftCount = (uint32_t)(middle - begin);
+        }
+        // too deep or all centroids in one place: median split along the longest axis of the centroids
+        if (leftCount == 0 || leftCount == count)
+        {
+            int axis = extent.x > extent.y ? (extent.x > extent.z ? 0 : 2) : (extent.y > extent.z ? 1 : 2);
+            leftCount = count / 2;
+            std::nth_element(begin, begin + leftCount, begin + count, [axis](const AOBvhPrimitive& a, const AOBvhPrimitive& b)
+            {
+                return a.centroid[axis] < b.centroid[axis];
+            });
+        }
+
+        node.leftFirst = (uint32_t)nodeArray.size();
+        node.count = 0;
+        children[0] = { node.leftFirst, task.first, leftCount, task.depth + 1 };
+        children[1] = { node.leftFirst + 1, task.first + leftCount, count - leftCount, task.depth + 1 };
+        nodeArray.push_back(AOBvhNode());
+        nodeArray.push_back(AOBvhNode());
+        return true;
+    };
+
+    nodes.clear();
+    nodes.reserve(2 * primitives.size() / std::max(leafSize, 1u) + 1);
+    nodes.push_back(AOBvhNode());
+    if (primitives.empty())
+        return;
+
+    // top of the tree, breadth first until the open nodes are small enough to be built independently
+    uint32_t subtreeSize = std::max(AO_BVH_MIN_SUBTREE_SIZE, (uint32_t)(primitives.size() / ((size_t)threadCount * 8)));
+    if (threadCount == 1)
+        subtreeSize = (uint32_t)primitives.size();
+    std::vector<Task> subtrees;
+    std::deque<Task> open(1, Task{ 0, 0, (uint32_t)primitives.size(), 0 });
+    while (!open.empty())
+    {
+        Task task = open.front();
+        open.pop_front();
+        if (task.count <= subtreeSize)
+        {
+            subtrees.push_back(task);
+            continue;
+        }
+        Task children[2];
+        if (splitNode(nodes, task, task.count > AO_BVH_PARALLEL_BINNING_SIZE ? threadCount : 1, children))
+        {
+            open.push_back(children[0]);
+            open.push_back(children[1]);
+        }
+    }
+
+    // subtrees into their own node arrays, the root of a subtree goes to its placeholder node
+    std::vector<std::vector<AOBvhNode>> subtreeNodes(subtrees.size());
+    parallelFor((int)subtrees.size(), [&](int i)
+    {
+        std::vector<AOBvhNode>& local = subtreeNodes[i];
+        local.push_back(AOBvhNode());
+        std::vector<Task> stack(1, Task{ 0, subtrees[i].first, subtrees[i].count, subtrees[i].depth });
+        while (!stack.empty())
+        {
+            Task task = stack.back();
+            stack.pop_back();
+            Task children[2];
+            if (splitNode(local, task, 1, children))
+            {
+                stack.push_back(children[1]);
+                stack.push_back(children[0]);
+            }
+        }
+    }, threadCount);
+    for (size_t i = 0; i < subtrees.size(); i++)
+    {
+        std::vector<AOBvhNode>& local = subtreeNodes[i];
+        uint32_t offset = (uint32_t)nodes.size() - 1; // local node k > 0 goes to offset + k
+        for (auto& node : local)
+        {
+            if (node.count == 0)
+                node.leftFirst += offset;
+        }
+        nodes[subtrees[i].node] = local[0];
+        nodes.insert(nodes.end(), local.begin() + 1, local.end());
+    }
+}
+
+// closest or any hit of a ray, block and lane identify the triangle
+struct AOBvhHit
+{
+    float distance = INFINITY;
+    uint32_t block = 0;
+    int lane = 0;
+};
+
+// Triangle soup with a BVH over it. Leaves hold up to four triangles in a single SoA block,
+// so a leaf is tested against a ray with one 4-wide SIMD test.
+class AOBvh
+{
+public:
+    void addTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm::vec3& v2)
+    {
+        triangles.push_back({ v0, v1, v2 });
+    }
+
+    size_t getTriangleCount() const
+    {
+        return triangles.size();
+    }
+
+    size_t getNodeCount() const
+    {
+        return nodes.size();
+    }
+
+    const AOBvhNode& getRoot() const
+    {
+        return nodes[0];
+    }
+
+    const std::vector<AOBvhNode>& getNodes() const
+    {
+        return nodes;
+    }
+
+    const std::vector<AOTriangleBlock>& getBlocks() const
+    {
+        return blocks;
+    }
+
+    // builds the BVH on threadCount threads (all hardware threads by default), has to be called after all triangles were added
+    void build(int threadCount = 0)
+    {
+        std::vector<AOBvhPrimitive> primitives(triangles.size());
+        for (size_t i = 0; i < triangles.size(); i++)
+        {
+            AOBvhPrimitive& primitive = primitives[i];
+            primitive.index = (uint32_t)i;
+            primitive.boundsMin = glm::min(triangles[i].v0, glm::min(triangles[i].v1, triangles[i].v2));
+            primitive.boundsMax = glm::max(triangles[i].v0, glm::max(triangles[i].v1, triangles[i].v2));
+            primitive.centroid = (primitive.boundsMin + primitive.boundsMax) * 0.5f;
+        }
+        buildAOBvh(primitives, nodes, AO_BVH_BLOCK_SIZE, threadCount);
+        blocks.clear();
+        if (triangles.empty())
+            return;
+        for (auto& node : nodes)
+        {
+            if (node.count > 0)
+            {
+                blocks.push_back(makeBlock(primitives.data() + node.leftFirst, node.count));
+                node.leftFirst = (uint32_t)blocks.size() - 1;
+            }
+        }
+    }
+
+    // any hit (anyHit) or the closest hit closer than maxDistance
+    bool traverse(const AORay& ray, float maxDistance, bool anyHit, AOBvhHit& hit) const
+    {
+        if (blocks.empty() || intersectBox(nodes[0], ray, maxDistance) == INFINITY)
+            return false;
+        bool found = false;
+        uint32_t stack[MAX_DEPTH];
+        int stackSize = 0;
+        uint32_t nodeIndex = 0;
+        while (true)
+        {
+            const AOBvhNode& node = nodes[nodeIndex];
+            if (node.count > 0)
+            {
+                float distance;
+                int lane = intersectBlock(blocks[node.leftFirst], ray, maxDistance, distance);
+                if (lane >= 0)
+                {
+                    found = true;
+                    hit = { distance, node.leftFirst, lane };
+                    if (anyHit)
+                        return true;
+                    maxDistance = distance;
+                }
+            }
+            else
+            {
+                // closer child first, the other one is visited later if it is still in range
+                uint32_t near = node.leftFirst, far = node.leftFirst + 1;
+                float nearDistance = intersectBox(nodes[near], ray, maxDistance);
+                float farDistance = intersectBox(nodes[far], ray, maxDistance);
+                if (farDistance < nearDistance)
+                {
+                    std::swap(near, far);
+                    std::swap(nearDistance, farDistance);
+                }
+                if (nearDistance != INFINITY)
+                {
+                    if (farDistance != INFINITY)
+                        stack[stackSize++] = far;
+                    nodeIndex = near;
+                    continue;
+                }
+            }
+            if (stackSize == 0)
+                break;
+            nodeIndex = stack[--stackSize];
+        }
+        return found;
+    }
+
+    // geometric normal of the hit triangle, not normalized
+    glm::vec3 getNormal(const AOBvhHit& hit) const
+    {
+        const AOTriangleBlock& block = blocks[hit.block];
+        glm::vec3 e1(block.e1[0][hit.lane], block.e1[1][hit.lane], block.e1[2][hit.lane]);
+        glm::vec3 e2(block.e2[0][hit.lane], block.e2[1][hit.lane], block.e2[2][hit.lane]);
+        return glm::cross(e1, e2);
+    }
+
+    // slab test, entry distance of the box or INFINITY if the box is missed
+    static float intersectBox(const AOBvhNode& node, const AORay& ray, float maxDistance)
+    {
+        glm::vec3 t0 = (node.boundsMin - ray.origin) * ray.invDirection;
+        glm::vec3 t1 = (node.boundsMax - ray.origin) * ray.invDirection;
+        glm::vec3 tNear = glm::min(t0, t1);
+        glm::vec3 tFar = glm::max(t0, t1);
+        float entry = std::max(std::max(tNear.x, tNear.y), std::max(tNear.z, 0.0f));
+        float exit = std::min(std::min(tFar.x, tFar.y), std::min(tFar.z, maxDistance));
+        return entry <= exit ? entry : INFINITY;
+    }
+
+    // AO_BVH_MAX_SAH_DEPTH plus the middle splits below it
+    static const int MAX_DEPTH = AO_BVH_MAX_SAH_DEPTH + 32;
+
+    // Moller-Trumbore against the four triangles of a block, returns the closest lane hit before maxDistance or -1
+    static int intersectBlock(const AOTriangleBlock& block, const AORay& ray, float maxDistance, float& distance)
+    {
+        const int BLOCK_SIZE = AO_BVH_BLOCK_SIZE;
+        float t[BLOCK_SIZE];
+        int mask = 0;
+#ifdef AO_BVH_SSE
+        __m128 zero = _mm_setzero_ps();
+        __m128 one = _mm_set1_ps(1.0f);
+        __m128 dx = _mm_set1_ps(ray.direction.x), dy = _mm_set1_ps(ray.direction.y), dz = _mm_set1_ps(ray.direction.z);
+        __m128 e1x = _mm_load_ps(block.e1[0]), e1y = _mm_load_ps(block.e1[1]), e1z = _mm_load_ps(block.e1[2]);
+        __m128 e2x = _mm_load_ps(block.e2[0]), e2y = _mm_load_ps(block.e2[1]), e2z = _mm_load_ps(block.e2[2]);
+        // p = d x e2, det = e1 . p
+        __m128 px = _mm_sub_ps(_mm_mul_ps(dy, e2z), _mm_mul_ps(dz, e2y));
+        __m128 py = _mm_sub_ps(_mm_mul_ps(dz, e2x), _mm_mul_ps(dx, e2z));
+        __m128 pz = _mm_sub_ps(_mm_mul_ps(dx, e2y), _mm_mul_ps(dy, e2x));
+        __m128 det = _mm_add_ps(_mm_add_ps(_mm_mul_ps(e1x, px), _mm_mul_ps(e1y, py)), _mm_mul_ps(e1z, pz));
+        __m128 invDet = _mm_div_ps(one, det);
+        // s = o - v0, u = (s . p) / det
+        __m128 sx = _mm_sub_ps(_mm_set1_ps(ray.origin.x), _mm_load_ps(block.v0[0]));
+        __m128 sy = _mm_sub_ps(_mm_set1_ps(ray.origin.y), _mm_load_ps(block.v0[1]));
+        __m128 sz = _mm_sub_ps(_mm_set1_ps(ray.origin.z), _mm_load_ps(block.v0[2]));
+        __m128 u = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, px), _mm_mul_ps(sy, py)), _mm_mul_ps(sz, pz)), invDet);
+        // q = s x e1, v = (d . q) / det, t = (e2 . q) / det
+        __m128 qx = _mm_sub_ps(_mm_mul_ps(sy, e1z), _mm_mul_ps(sz, e1y));
+        __m128 qy = _mm_sub_ps(_mm_mul_ps(sz, e1x), _mm_mul_ps(sx, e1z));
+        __m128 qz = _mm_sub_ps(_mm_mul_ps(sx, e1y), _mm_mul_ps(sy, e1x));
+        __m128 v = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, qx), _mm_mul_ps(dy, qy)), _mm_mul_ps(dz, qz)), invDet);
+        __m128 tHit = _mm_mul_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(e2x, qx), _mm_mul_ps(e2y, qy)), _mm_mul_ps(e2z, qz)), invDet);
+        __m128 hit = _mm_cmpneq_ps(det, zero);
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(u, zero));
+        hit = _mm_and_ps(hit, _mm_cmpge_ps(v, zero));
+        hit = _mm_and_ps(hit, _mm_cmple_ps(_mm_add_ps(u, v), one));
+        hit = _mm_and_ps(hit, _mm_cmpgt_ps(tHit, zero));
+        hit = _mm_and_ps(hit, _mm_cmplt_ps(tHit, _mm_set1_ps(maxDistance)));
+        mask = _mm_movemask_ps(hit);
+        _mm_storeu_ps(t, tHit);
+#else
+        for (int lane = 0; lane < BLOCK_SIZE; lane++)
+        {
+            glm::vec3 e1(block.e1[0][lane], block.e1[1][lane], block.e1[2][lane]);
+            glm::vec3 e2(block.e2[0][lane], block.e2[1][lane], block.e2[2][lane]);
+            glm::vec3 p = glm::cross(ray.direction, e2);
+            float det = glm::dot(e1, p);
+            if (det == 0.0f)
+                continue;
+            float invDet = 1.0f / det;
+            glm::vec3 s = ray.origin - glm::vec3(block.v0[0][lane], block.v0[1][lane], block.v0[2][lane]);
+            float u = glm::dot(s, p) * invDet;
+            glm::vec3 q = glm::cross(s, e1);
+            float v = glm::dot(ray.direction, q) * invDet;
+            t[lane] = glm::dot(e2, q) * invDet;
+            if (u >= 0.0f && v >= 0.0f && u + v <= 1.0f && t[lane] > 0.0f && t[lane] < maxDistance)
+                mask |= 1 << lane;
+        }
+#endif
+        int closest = -1;
+        for (int lane = 0; lane < BLOCK_SIZE; lane++)
+        {
+            if ((mask & (1 << lane)) && (closest < 0 || t[lane] < t[closest]))
+                closest = lane;
+        }
+        if (closest >= 0)
+            distance = t[closest];
+        return closest;
+    }
+
+private:
+    struct Triangle
+    {
+        glm::vec3 v0, v1, v2;
+    };
+
+    std::vector<Triangle> triangles;
+    std::vector<AOBvhNode> nodes;
+    std::vector<AOTriangleBlock> blocks;
+
+    AOTriangleBlock makeBlock(const AOBvhPrimitive* begin, uint32_t count) const
+    {
+        AOTriangleBlock block = {};
+        for (uint32_t lane = 0; lane < count; lane++)
+        {
+            const Triangle& triangle = triangles[begin[lane].index];
+            glm::vec3 e1 = triangle.v1 - triangle.v0;
+            glm::vec3 e2 = triangle.v2 - triangle.v0;
+            for (int k = 0; k < 3; k++)
+            {
+                block.v0[k][lane] = triangle.v0[k];
+                block.e1[k][lane] = e1[k];
+                block.e2[k][lane] = e2[k];
+            }
+        }
+        return block;
+    }
+};
+
+namespace SIMD_FLOAT_NAMESPACE
+{
+// N-wide BVH collapsed from the binary AOBvh: every node keeps the boxes of up to N children in structure of arrays
+// layout, so one ray is tested against all of them with N / Float::WIDTH vector slab tests, and a packet is tested
+// against one child box with its rays in the vector lanes. Leaves are the triangle blocks of the AOBvh, which has to
+// outlive the wide BVH.
+template <typename Float, int N>
+class AOWideBvh
+{
+    static_assert(N % Float::WIDTH == 0, "node width has to be a multiple of the vector width");
+    static_assert(AO_RAY_PACKET_SIZE % Float::WIDTH == 0, "packet size has to be a multiple of the vector width");
+
+public:
+    AOWideBvh() = default;
+
+    explicit AOWideBvh(const AOBvh& bvh) : bvh(&bvh)
+    {
+        if (!bvh.getBlocks().empty())
+            collapse(bvh.getNodes(), 0);
+    }
+
+    size_t getNodeCount() const
+    {
+        return nodes.size();
+    }
+
+    static size_t getNodeSize()
+    {
+        return sizeof(Node);
+    }
+
+    // closest hit before maxDistance, or any hit if anyHit is set
+    bool traverse(const AORay& ray, float maxDistance, bool anyHit, AOBvhHit& hit) const
+    {
+        return !nodes.empty() && traverse(0, ray, maxDistance, anyHit, hit);
+    }
+
+    // Rays of the packet are traced together while at least AO_RAY_PACKET_MIN_ACTIVE of them are active: a child is
+    // visited if any active ray enters its box. Rays stop after an any-hit, the rest of the packet continues ray by
+    // ray once too few are left. Returns the rays that hit, hits[i] is set for them.
+    uint32_t traverse(const AORayPacket& packet, bool anyHit, AOBvhHit* hits) const
+    {
+        const int W = Float::WIDTH;
+        const int V = AO_RAY_PACKET_SIZE / W;
+        uint32_t active = packet.active;
+        if (nodes.empty() || active == 0)
+            return 0;
+        uint32_t hitMask = 0;
+        AORay rays[AO_RAY_PACKET_SIZE];
+        // finished and unused rays get a negative cutoff, which no box is entered before
+        float limits[AO_RAY_PACKET_SIZE];
+        for (int i = 0; i < AO_RAY_PACKET_SIZE; i++)
+        {
+            rays[i] = packet.getRay(i);
+            limits[i] = (active & (1u << i)) ? packet.maxDistance[i] : -INFINITY;
+        }
+        Float origin[3][V], invDirection[3][V];
+        for (int v = 0; v < V; v++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                origin[k][v] = Float::load(packet.origin[k] + v * W);
+                invDirection[k][v] = Float::load(packet.invDirection[k] + v * W);
+            }
+        }
+        auto report = [&](int i, const AOBvhHit& hit)
+        {
+            hits[i] = hit;
+            hitMask |= 1u << i;
+            if (anyHit)
+            {
+                active &= ~(1u << i);
+                limits[i] = -INFINITY;
+            }
+            else
+            {
+                limits[i] = hit.distance;
+            }
+        };
+
+        int32_t stack[N * AOBvh::MAX_DEPTH];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0 && active != 0)
+        {
+            int32_t code = stack[--stackSize];
+            if (countAORays(active) < AO_RAY_PACKET_MIN_ACTIVE)
+            {
+                for (int i = 0; i < AO_RAY_PACKET_SIZE; i++)
+                {
+                    AOBvhHit hit;
+                    if ((active & (1u << i)) && traverse(code, rays[i], limits[i], anyHit, hit))
+                        report(i, hit);
+                }
+                continue;
+            }
+            if (code < 0)
+            {
+                const AOTriangleBlock& block = bvh->getBlocks()[~code];
+                for (int i = 0; i < AO_RAY_PACKET_SIZE; i++)
+                {
+                    float distance;
+                    int lane = (active & (1u << i)) ? AOBvh::intersectBlock(block, rays[i], limits[i], distance) : -1;
+                    if (lane >= 0)
+                        report(i, { distance, (uint32_t)~code, lane });
+                }
+                continue;
+            }
+
+            const Node& node = nodes[code];
+            Float limit[V];
+            for (int v = 0; v < V; v++)
+                limit[v] = Float::load(limits + v * W);
+            int32_t children[N];
+            float entries[N];
+            int childCount = 0;
+            for (int c = 0; c < node.count; c++)
+            {
+                // closest entry of the rays entering the box orders the children
+                Float closest(INFINITY);
+                int mask = 0;
+                for (int v = 0; v < V; v++)
+                {
+                    Float tNear[3], tFar[3];
+                    for (int k = 0; k < 3; k++)
+                    {
+                        Float t0 = (Float(node.boundsMin[k][c]) - origin[k][v]) * invDirection[k][v];
+                        Float t1 = (Float(node.boundsMax[k][c]) - origin[k][v]) * invDirection[k][v];
+                        tNear[k] = min(t0, t1);
+                        tFar[k] = max(t0, t1);
+                    }
+                    Float tEntry = max(max(tNear[0], tNear[1]), max(tNear[2], Float(0.0f)));
+                    Float tExit = min(min(tFar[0], tFar[1]), min(tFar[2], limit[v]));
+                    Float entered = tEntry <= tExit;
+                    mask |= horizontalMask(entered);
+                    closest = min(closest, select(entered, tEntry, Float(INFINITY)));
+                }
+                if (mask == 0)
+                    continue;
+                float lanes[W];
+                closest.store(lanes);
+                float entry = lanes[0];
+                for (int lane = 1; lane < W; lane++)
+                    entry = std::min(entry, lanes[lane]);
+                insertChild(children, entries, childCount, node.children[c], entry);
+            }
+            for (int c = 0; c < childCount; c++)
+                stack[stackSize++] = children[c];
+        }
+        return hitMask;
+    }
+
+private:
+    // children[i] is the index of an inner node or ~block for a leaf, unused children have inverted bounds
+    struct Node
+    {
+        float boundsMin[3][N];
+        float boundsMax[3][N];
+        int32_t children[N];
+        int count;
+    };
+
+    const AOBvh* bvh = nullptr;
+    std::vector<Node> nodes;
+
+    static float getArea(const AOBvhNode& node)
+    {
+        glm::vec3 extent = node.boundsMax - node.boundsMin;
+        return extent.x * extent.y + extent.y * extent.z + extent.z * extent.x;
+    }
+
+    // keeps children sorted by decreasing entry distance, so the nearest one is popped first
+    static void insertChild(int32_t* children, float* entries, int& count, int32_t child, float entry)
+    {
+        int i = count++;
+        for (; i > 0 && entries[i - 1] < entry; i--)
+        {
+            children[i] = children[i - 1];
+            entries[i] = entries[i - 1];
+        }
+        children[i] = child;
+        entries[i] = entry;
+    }
+
+    // pulls the largest inner nodes below a binary node up until it has N children
+    int32_t collapse(const std::vector<AOBvhNode>& binary, uint32_t index)
+    {
+        uint32_t slots[N];
+        int count = 0;
+        if (binary[index].count > 0)
+        {
+            slots[count++] = index;
+        }
+        else
+        {
+            slots[count++] = binary[index].leftFirst;
+            slots[count++] = binary[index].leftFirst + 1;
+        }
+        while (count < N)
+        {
+            int largest = -1;
+            for (int i = 0; i < count; i++)
+            {
+                if (binary[slots[i]].count == 0 && (largest < 0 || getArea(binary[slots[i]]) > getArea(binary[slots[largest]])))
+                    largest = i;
+            }
+            if (largest < 0)
+                break;
+            uint32_t first = binary[slots[largest]].leftFirst;
+            slots[largest] = first;
+            slots[count++] = first + 1;
+        }
+
+        int32_t nodeIndex = (int32_t)nodes.size();
+        nodes.emplace_back();
+        int32_t children[N];
+        for (int i = 0; i < count; i++)
+        {
+            const AOBvhNode& child = binary[slots[i]];
+            children[i] = child.count > 0 ? ~(int32_t)child.leftFirst : collapse(binary, slots[i]);
+        }
+        // the recursion reallocates nodes, the node is only filled in afterwards
+        Node& node = nodes[nodeIndex];
+        node.count = count;
+        for (int i = 0; i < N; i++)
+        {
+            for (int k = 0; k < 3; k++)
+            {
+                node.boundsMin[k][i] = i < count ? binary[slots[i]].boundsMin[k] : INFINITY;
+                node.boundsMax[k][i] = i < count ? binary[slots[i]].boundsMax[k] : -INFINITY;
+            }
+            node.children[i] = i < count ? children[i] : 0;
+        }
+        return nodeIndex;
+    }
+
+    // single ray traversal of the subtree of a node index or ~block
+    bool traverse(int32_t code, const AORay& ray, float maxDistance, bool anyHit, AOBvhHit& hit) const
+    {
+        const int W = Float::WIDTH;
+        // near and far planes picked by the direction sign: inverted unused boxes have entry > exit and are missed
+        int nearSide[3], farSide[3];
+        for (int k = 0; k < 3; k++)
+        {
+            nearSide[k] = ray.invDirection[k] >= 0.0f ? 0 : 1;
+            farSide[k] = 1 - nearSide[k];
+        }
+        Float origin[3], invDirection[3];
+        for (int k = 0; k < 3; k++)
+        {
+            origin[k] = Float(ray.origin[k]);
+            invDirection[k] = Float(ray.invDirection[k]);
+        }
+
+        bool found = false;
+        int32_t stack[N * AOBvh::MAX_DEPTH];
+        float stackEntries[N * AOBvh::MAX_DEPTH];
+        int stackSize = 0;
+        stack[stackSize] = code;
+        stackEntries[stackSize++] = 0.0f;
+        while (stackSize > 0)
+        {
+            stackSize--;
+            code = stack[stackSize];
+            // a closer hit found meanwhile can put the box out of range
+            if (stackEntries[stackSize] >= maxDistance)
+                continue;
+            if (code < 0)
+            {
+                float distance;
+                int lane = AOBvh::intersectBlock(bvh->getBlocks()[~code], ray, maxDistance, distance);
+                if (lane >= 0)
+                {
+                    found = true;
+                    hit = { distance, (uint32_t)~code, lane };
+                    if (anyHit)
+                        return true;
+                    maxDistance = distance;
+                }
+                continue;
+            }
+
+            const Node& node = nodes[code];
+            const float* bounds[2][3] = { { node.boundsMin[0], node.boundsMin[1], node.boundsMin[2] },
+                                          { node.boundsMax[0], node.boundsMax[1], node.boundsMax[2] } };
+            Float limit(maxDistance);
+            float entries[N];
+            int mask = 0;
+            for (int c = 0; c < N; c += W)
+            {
+                Float tEntry(0.0f), tExit = limit;
+                for (int k = 0; k < 3; k++)
+                {
+                    tEntry = max(tEntry, (Float::load(bounds[nearSide[k]][k] + c) - origin[k]) * invDirection[k]);
+                    tExit = min(tExit, (Float::load(bounds[farSide[k]][k] + c) - origin[k]) * invDirection[k]);
+                }
+                mask |= horizontalMask(tEntry <= tExit) << c;
+                tEntry.store(entries + c);
+            }
+            int32_t children[N];
+            float childEntries[N];
+            int childCount = 0;
+            for (int c = 0; c < N; c++)
+            {
+                if (mask & (1 << c))
+                    insertChild(children, childEntries, childCount, node.children[c], entries[c]);
+            }
+            for (int c = 0; c < childCount; c++)
+            {
+                stack[stackSize] = children[c];
+                stackEntries[stackSize++] = childEntries[c];
+            }
+        }
+        return found;
+    }
+};
+}
+
+#endif
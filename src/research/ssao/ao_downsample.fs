@@ -0,0 +1,23 @@
+#version 330 core
+
+// G-buffer at 1 / scale resolution for the AO passes: every low resolution pixel takes depth and normal of the
+// pixel at the center of its scale x scale block, the depth linearized (view depth - near) / (far - near). Depth is not filtered,
+// averaging across an edge would create surfaces that don't exist; a min/max checkerboard keeps both sides of edges
+// but turns slopes into a zigzag HBAO and SSAO see as occluders.
+layout (location = 0) out float linearDepth;
+layout (location = 1) out vec3 aoNormal;
+
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+
+uniform vec2 LinMAD;
+uniform vec2 clipPlanes;
+uniform int scale;
+
+void main()
+{
+    ivec2 coord = min(ivec2(gl_FragCoord.xy) * scale + scale / 2, textureSize(gDepth, 0) - 1);
+    float d = texelFetch(gDepth, coord, 0).r * 2.0 - 1.0;
+    linearDepth = (1.0 / (LinMAD.x * d + LinMAD.y) - clipPlanes.x) / (clipPlanes.y - clipPlanes.x);
+    aoNormal = texelFetch(gNormal, coord, 0).rgb;
+}
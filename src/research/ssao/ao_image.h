@@ -0,0 +1,174 @@
+#ifndef AO_IMAGE_H
+#define AO_IMAGE_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Single channel float image of ambient occlusion (1 - unoccluded, 0 - fully occluded).
+// Rows are stored bottom to top, as read back from OpenGL and as stored in PFM files.
+struct AOImage
+{
+    int width = 0;
+    int height = 0;
+    std::vector<float> pixels;
+
+    // zero filled, defined in cpu_ao.cpp
+    void resize(int imageWidth, int imageHeight);
+
+    float at(int x, int y) const
+    {
+        return pixels[(size_t)y * width + x];
+    }
+
+    // grayscale Portable Float Map ("Pf"), little endian
+    bool savePfm(const std::string& path) const
+    {
+        std::ofstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::AO_IMAGE::FAILED_TO_WRITE: " << path << std::endl;
+            return false;
+        }
+        file << "Pf\n" << width << " " << height << "\n-1.0\n";
+        file.write((const char*)pixels.data(), pixels.size() * sizeof(float));
+        return true;
+    }
+
+    bool loadPfm(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file)
+        {
+            std::cout << "ERROR::AO_IMAGE::FAILED_TO_READ: " << path << std::endl;
+            return false;
+        }
+        std::string type;
+        float scale = 0.0f;
+        file >> type >> width >> height >> scale;
+        file.get(); // single whitespace before the data
+        // only grayscale little endian files, which is what savePfm writes on every supported platform
+        if (type != "Pf" || width <= 0 || height <= 0 || scale >= 0.0f)
+        {
+            std::cout << "ERROR::AO_IMAGE::UNSUPPORTED_FORMAT: " << path << std::endl;
+            return false;
+        }
+        pixels.resize((size_t)width * height);
+        file.read((char*)pixels.data(), pixels.size() * sizeof(float));
+        if (!file)
+        {
+            std::cout << "ERROR::AO_IMAGE::TRUNCATED: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+};
+
+// image quality of an AO image against a reference of the same size, values are clamped to [0, 1]
+struct AOImageQuality
+{
+    double rmse = 0.0;
+    double psnr = 0.0; // dB, peak value 1
+    double ssim = 0.0; // mean SSIM, 11x11 gaussian window (sigma 1.5)
+
+    static AOImageQuality compute(const AOImage& image, const AOImage& reference)
+    {
+        AOImageQuality quality;
+        size_t count = image.pixels.size();
+        double squaredError = 0.0;
+        for (size_t i = 0; i < count; i++)
+        {
+            double d = clamp01(image.pixels[i]) - clamp01(reference.pixels[i]);
+            squaredError += d * d;
+        }
+        quality.rmse = sqrt(squaredError / count);
+        quality.psnr = quality.rmse > 0.0 ? 20.0 * log10(1.0 / quality.rmse) : INFINITY;
+        quality.ssim = computeSSIM(image, reference);
+        return quality;
+    }
+
+private:
+    static double clamp01(float value)
+    {
+        return std::min(std::max((double)value, 0.0), 1.0);
+    }
+
+    // Wang et al. 2004: local statistics with a separable gaussian window, C1 = (0.01 L)^2, C2 = (0.03 L)^2 with L = 1
+    static double computeSSIM(const AOImage& a, const AOImage& b)
+    {
+        const int RADIUS = 5;
+        const double SIGMA = 1.5;
+        const double C1 = 0.01 * 0.01;
+        const double C2 = 0.03 * 0.03;
+
+        double weights[2 * RADIUS + 1];
+        double weightSum = 0.0;
+        for (int i = -RADIUS; i <= RADIUS; i++)
+        {
+            weights[i + RADIUS] = exp(-0.5 * i * i / (SIGMA * SIGMA));
+            weightSum += weights[i + RADIUS];
+        }
+        for (double& weight : weights)
+            weight /= weightSum;
+
+        int width = a.width, height = a.height;
+        size_t count = a.pixels.size();
+        // x, y, x^2, y^2, xy filtered horizontally then vertically (clamped to the edge)
+        std::vector<double> moments[5], filtered[5];
+        for (int m = 0; m < 5; m++)
+        {
+            moments[m].resize(count);
+            filtered[m].resize(count);
+        }
+        for (size_t i = 0; i < count; i++)
+        {
+            double x = clamp01(a.pixels[i]), y = clamp01(b.pixels[i]);
+            moments[0][i] = x;
+            moments[1][i] = y;
+            moments[2][i] = x * x;
+            moments[3][i] = y * y;
+            moments[4][i] = x * y;
+        }
+        for (int m = 0; m < 5; m++)
+        {
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    double sum = 0.0;
+                    for (int k = -RADIUS; k <= RADIUS; k++)
+                        sum += weights[k + RADIUS] * moments[m][(size_t)y * width + std::min(std::max(x + k, 0), width - 1)];
+                    filtered[m][(size_t)y * width + x] = sum;
+                }
+            }
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    double sum = 0.0;
+                    for (int k = -RADIUS; k <= RADIUS; k++)
+                        sum += weights[k + RADIUS] * filtered[m][(size_t)std::min(std::max(y + k, 0), height - 1) * width + x];
+                    moments[m][(size_t)y * width + x] = sum;
+                }
+            }
+        }
+
+        double ssim = 0.0;
+        for (size_t i = 0; i < count; i++)
+        {
+            double muX = moments[0][i], muY = moments[1][i];
+            double varianceX = moments[2][i] - muX * muX;
+            double varianceY = moments[3][i] - muY * muY;
+            double covariance = moments[4][i] - muX * muY;
+            ssim += ((2.0 * muX * muY + C1) * (2.0 * covariance + C2)) /
+                    ((muX * muX + muY * muY + C1) * (varianceX + varianceY + C2));
+        }
+        return ssim / count;
+    }
+};
+
+#endif
@@ -0,0 +1,572 @@
+#ifndef AO_RAYTRACER_H
+#define AO_RAYTRACER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/model.h>
+
+#include "ao_bvh.h"
+#include "ao_image.h"
+#include "parallel_for.h"
+#include "simd_float.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+// node layouts the mesh BVHs are traversed with: the binary AOBvh or AOWideBvh nodes collapsed from it
+enum class AOBvhLayout
+{
+    BINARY,
+    WIDE4,
+    WIDE8
+};
+
+const AOBvhLayout AO_BVH_LAYOUTS[] = { AOBvhLayout::BINARY, AOBvhLayout::WIDE4, AOBvhLayout::WIDE8 };
+
+inline std::string getAOBvhLayoutName(AOBvhLayout layout)
+{
+    switch (layout)
+    {
+    case AOBvhLayout::BINARY:
+        return "binary";
+    case AOBvhLayout::WIDE4:
+        return "wide4";
+    case AOBvhLayout::WIDE8:
+        return "wide8";
+    }
+    return "unknown";
+}
+
+// vector of the wide node tests, the baseline of the target (8-wide nodes take two tests per ray)
+#if defined(SIMD_FLOAT_SSE2) || defined(SIMD_FLOAT_NEON)
+typedef SIMD_FLOAT_NAMESPACE::Float4 AOBvhFloat;
+#else
+typedef SIMD_FLOAT_NAMESPACE::FloatScalar AOBvhFloat;
+#endif
+
+// Meshes with a BVH each in object space, instanced with model matrices (the getRoomTransform / getModelTransform
+// of the geometry pass, or an Entity's transform). A top level BVH over the world space bounds of the instances
+// finds the instances a ray passes, the ray is then traced through the mesh BVH in the object space of the instance.
+// Its direction is not renormalized there, so distances are the ray parameter t, the same in both spaces, not lengths.
+// Rays are traced alone or in packets of AO_RAY_PACKET_SIZE; a packet shares the top level and mesh traversal while
+// enough of its rays are active. Every ray stops at its maxDistance: AO rays have unit world space directions, so
+// that is the world space radius of the AO (SSAO_SAMPLE_RADIUS, HBAO_SAMPLE_RADIUS), and like the d2 < R2 test of
+// hbao.fs a hit exactly at the radius does not count.
+class AOScene
+{
+public:
+    // returns the index of the mesh for addInstance
+    size_t addMesh(AOBvh mesh)
+    {
+        meshes.push_back(std::move(mesh));
+        return meshes.size() - 1;
+    }
+
+    void addInstance(size_t mesh, const glm::mat4& transform)
+    {
+        instances.push_back({ (uint32_t)mesh, glm::inverse(transform) });
+    }
+
+    // all instances of a model share one mesh
+    void addModel(const Model& model, const glm::mat4& transform)
+    {
+        auto known = std::find_if(modelMeshes.begin(), modelMeshes.end(), [&](const std::pair<const Model*, size_t>& entry)
+        {
+            return entry.first == &model;
+        });
+        if (known != modelMeshes.end())
+        {
+            addInstance(known->second, transform);
+            return;
+        }
+        AOBvh mesh;
+        for (const Mesh& modelMesh : model.meshes)
+        {
+            for (size_t i = 0; i + 2 < modelMesh.indices.size(); i += 3)
+            {
+                mesh.addTriangle(modelMesh.vertices[modelMesh.indices[i]].Position, modelMesh.vertices[modelMesh.indices[i + 1]].Position,
+                    modelMesh.vertices[modelMesh.indices[i + 2]].Position);
+            }
+        }
+        modelMeshes.push_back({ &model, addMesh(std::move(mesh)) });
+        addInstance(modelMeshes.back().second, transform);
+    }
+
+    // [-1, 1] cube, same geometry as renderCube
+    void addCube(const glm::mat4& transform)
+    {
+        if (cubeMesh == NO_MESH)
+        {
+            AOBvh mesh;
+            glm::vec3 corners[8];
+            for (int i = 0; i < 8; i++)
+                corners[i] = glm::vec3(i & 1 ? 1.0f : -1.0f, i & 2 ? 1.0f : -1.0f, i & 4 ? 1.0f : -1.0f);
+            const int faces[6][4] = { { 0, 2, 3, 1 }, { 4, 5, 7, 6 }, { 0, 1, 5, 4 }, { 2, 6, 7, 3 }, { 0, 4, 6, 2 }, { 1, 3, 7, 5 } };
+            for (const auto& face : faces)
+            {
+                mesh.addTriangle(corners[face[0]], corners[face[1]], corners[face[2]]);
+                mesh.addTriangle(corners[face[0]], corners[face[2]], corners[face[3]]);
+            }
+            cubeMesh = addMesh(std::move(mesh));
+        }
+        addInstance(cubeMesh, transform);
+    }
+
+    // triangles of all instances
+    size_t getTriangleCount() const
+    {
+        size_t count = 0;
+        for (const auto& instance : instances)
+            count += meshes[instance.mesh].getTriangleCount();
+        return count;
+    }
+
+    // triangles stored in the mesh BVHs
+    size_t getMeshTriangleCount() const
+    {
+        size_t count = 0;
+        for (const auto& mesh : meshes)
+            count += mesh.getTriangleCount();
+        return count;
+    }
+
+    // top level nodes plus the mesh nodes of a layout
+    size_t getNodeCount(AOBvhLayout nodeLayout = AOBvhLayout::BINARY) const
+    {
+        size_t count = nodes.size();
+        for (size_t i = 0; i < meshes.size(); i++)
+        {
+            if (nodeLayout == AOBvhLayout::WIDE4 && i < wideMeshes4.size())
+                count += wideMeshes4[i].getNodeCount();
+            else if (nodeLayout == AOBvhLayout::WIDE8 && i < wideMeshes8.size())
+                count += wideMeshes8[i].getNodeCount();
+            else
+                count += meshes[i].getNodeCount();
+        }
+        return count;
+    }
+
+    static size_t getNodeSize(AOBvhLayout nodeLayout)
+    {
+        switch (nodeLayout)
+        {
+        case AOBvhLayout::WIDE4:
+            return SIMD_FLOAT_NAMESPACE::AOWideBvh<AOBvhFloat, 4>::getNodeSize();
+        case AOBvhLayout::WIDE8:
+            return SIMD_FLOAT_NAMESPACE::AOWideBvh<AOBvhFloat, 8>::getNodeSize();
+        default:
+            return sizeof(AOBvhNode);
+        }
+    }
+
+    // layout the mesh BVHs are traversed with, wide layouts are available after build
+    void setLayout(AOBvhLayout nodeLayout)
+    {
+        layout = nodeLayout;
+    }
+
+    AOBvhLayout getLayout() const
+    {
+        return layout;
+    }
+
+    // builds the mesh BVHs and the top level on threadCount threads (all hardware threads by default),
+    // has to be called after all meshes and instances were added
+    void build(int threadCount = 0)
+    {
+        for (auto& mesh : meshes)
+            mesh.build(threadCount);
+        // the wide BVHs point into meshes, which does not change until the next build
+        wideMeshes4.clear();
+        wideMeshes8.clear();
+        for (const auto& mesh : meshes)
+        {
+            wideMeshes4.emplace_back(mesh);
+            wideMeshes8.emplace_back(mesh);
+        }
+        std::vector<AOBvhPrimitive> primitives;
+        for (size_t i = 0; i < instances.size(); i++)
+        {
+            const AOBvh& mesh = meshes[instances[i].mesh];
+            if (mesh.getTriangleCount() == 0)
+                continue;
+            // world space box around the transformed corners of the mesh bounds
+            glm::mat4 transform = glm::inverse(instances[i].invTransform);
+            const AOBvhNode& root = mesh.getRoot();
+            AOBvhPrimitive primitive;
+            primitive.boundsMin = glm::vec3(INFINITY);
+            primitive.boundsMax = glm::vec3(-INFINITY);
+            for (int corner = 0; corner < 8; corner++)
+            {
+                glm::vec3 local(corner & 1 ? root.boundsMax.x : root.boundsMin.x, corner & 2 ? root.boundsMax.y : root.boundsMin.y,
+                    corner & 4 ? root.boundsMax.z : root.boundsMin.z);
+                glm::vec3 world = glm::vec3(transform * glm::vec4(local, 1.0f));
+                primitive.boundsMin = glm::min(primitive.boundsMin, world);
+                primitive.boundsMax = glm::max(primitive.boundsMax, world);
+            }
+            primitive.centroid = (primitive.boundsMin + primitive.boundsMax) * 0.5f;
+            primitive.index = (uint32_t)i;
+            primitives.push_back(primitive);
+        }
+        buildAOBvh(primitives, nodes, 1, threadCount);
+        instanceOrder.resize(primitives.size());
+        for (size_t i = 0; i < primitives.size(); i++)
+            instanceOrder[i] = primitives[i].index;
+    }
+
+    // any hit closer than maxDistance
+    bool occluded(const AORay& ray, float maxDistance) const
+    {
+        Hit hit;
+        return traverse(ray, maxDistance, true, hit);
+    }
+
+    // closest hit, normal is the geometric normal facing the ray origin
+    bool intersect(const AORay& ray, float maxDistance, float& distance, glm::vec3& normal) const
+    {
+        Hit hit;
+        if (!traverse(ray, maxDistance, false, hit))
+            return false;
+        normal = getNormal(hit, ray.direction);
+        distance = hit.meshHit.distance;
+        return true;
+    }
+
+    // bit i is set if ray i of the packet has any hit closer than its maxDistance
+    uint32_t occluded(const AORayPacket& packet) const
+    {
+        Hit hits[AO_RAY_PACKET_SIZE];
+        return traverse(packet, true, hits);
+    }
+
+    // closest hits of the packet, distances[i] and normals[i] are set for the rays with bit i set
+    uint32_t intersect(const AORayPacket& packet, float* distances, glm::vec3* normals) const
+    {
+        Hit hits[AO_RAY_PACKET_SIZE];
+        uint32_t hitMask = traverse(packet, false, hits);
+        for (int i = 0; i < packet.count; i++)
+        {
+            if (hitMask & (1u << i))
+            {
+                normals[i] = getNormal(hits[i], packet.getRay(i).direction);
+                distances[i] = hits[i].meshHit.distance;
+            }
+        }
+        return hitMask;
+    }
+
+private:
+    static const size_t NO_MESH = (size_t)-1;
+
+    struct Instance
+    {
+        uint32_t mesh;
+        glm::mat4 invTransform;
+    };
+
+    struct Hit
+    {
+        AOBvhHit meshHit;
+        uint32_t instance = 0;
+    };
+
+    std::vector<AOBvh> meshes;
+    std::vector<SIMD_FLOAT_NAMESPACE::AOWideBvh<AOBvhFloat, 4>> wideMeshes4;
+    std::vector<SIMD_FLOAT_NAMESPACE::AOWideBvh<AOBvhFloat, 8>> wideMeshes8;
+    AOBvhLayout layout = AOBvhLayout::WIDE4;
+    std::vector<Instance> instances;
+    std::vector<std::pair<const Model*, size_t>> modelMeshes;
+    size_t cubeMesh = NO_MESH;
+    std::vector<AOBvhNode> nodes;        // top level, leaves hold one instance
+    std::vector<uint32_t> instanceOrder; // instance of every top level leaf primitive
+
+    // world space normal facing against direction
+    glm::vec3 getNormal(const Hit& hit, const glm::vec3& direction) const
+    {
+        const Instance& instance = instances[hit.instance];
+        glm::vec3 normal = glm::normalize(glm::transpose(glm::mat3(instance.invTransform)) * meshes[instance.mesh].getNormal(hit.meshHit));
+        return glm::dot(normal, direction) > 0.0f ? -normal : normal;
+    }
+
+    static AORay toObjectSpace(const Instance& instance, const AORay& ray)
+    {
+        return AORay(glm::vec3(instance.invTransform * glm::vec4(ray.origin, 1.0f)), glm::mat3(instance.invTransform) * ray.direction);
+    }
+
+    bool traverseMesh(uint32_t mesh, const AORay& ray, float maxDistance, bool anyHit, AOBvhHit& hit) const
+    {
+        switch (layout)
+        {
+        case AOBvhLayout::WIDE4:
+            return wideMeshes4[mesh].traverse(ray, maxDistance, anyHit, hit);
+        case AOBvhLayout::WIDE8:
+            return wideMeshes8[mesh].traverse(ray, maxDistance, anyHit, hit);
+        default:
+            return meshes[mesh].traverse(ray, maxDistance, anyHit, hit);
+        }
+    }
+
+    uint32_t traverseMesh(uint32_t mesh, const AORayPacket& packet, bool anyHit, AOBvhHit* hits) const
+    {
+        switch (layout)
+        {
+        case AOBvhLayout::WIDE4:
+            return wideMeshes4[mesh].traverse(packet, anyHit, hits);
+        case AOBvhLayout::WIDE8:
+            return wideMeshes8[mesh].traverse(packet, anyHit, hits);
+        default:
+            break;
+        }
+        // the binary BVH traces the rays of a packet one by one
+        uint32_t hitMask = 0;
+        for (int i = 0; i < packet.count; i++)
+        {
+            if ((packet.active & (1u << i)) && meshes[mesh].traverse(packet.getRay(i), packet.maxDistance[i], anyHit, hits[i]))
+                hitMask |= 1u << i;
+        }
+        return hitMask;
+    }
+
+    // the top level has a node per few instances, its boxes are tested ray by ray; every instance the packet enters
+    // gets the object space packet of the rays still active
+    uint32_t traverse(const AORayPacket& packet, bool anyHit, Hit* hits) const
+    {
+        if (instanceOrder.empty())
+            return 0;
+        AORay rays[AO_RAY_PACKET_SIZE];
+        for (int i = 0; i < packet.count; i++)
+            rays[i] = packet.getRay(i);
+        AORayPacket local = packet;
+        uint32_t hitMask = 0;
+        uint32_t stack[AOBvh::MAX_DEPTH + 1];
+        int stackSize = 0;
+        stack[stackSize++] = 0;
+        while (stackSize > 0 && local.active != 0)
+        {
+            const AOBvhNode& node = nodes[stack[--stackSize]];
+            bool entered = false;
+            for (int i = 0; i < packet.count && !entered; i++)
+                entered = (local.active & (1u << i)) && AOBvh::intersectBox(node, rays[i], local.maxDistance[i]) != INFINITY;
+            if (!entered)
+                continue;
+            if (node.count == 0)
+            {
+                stack[stackSize++] = node.leftFirst + 1;
+                stack[stackSize++] = node.leftFirst;
+                continue;
+            }
+            for (uint32_t leaf = node.leftFirst; leaf < node.leftFirst + node.count && local.active != 0; leaf++)
+            {
+                const Instance& instance = instances[instanceOrder[leaf]];
+                for (int i = 0; i < packet.count; i++)
+                {
+                    if (local.active & (1u << i))
+                        local.setRay(i, toObjectSpace(instance, rays[i]), local.maxDistance[i]);
+                }
+                AOBvhHit meshHits[AO_RAY_PACKET_SIZE];
+                uint32_t meshHitMask = traverseMesh(instance.mesh, local, anyHit, meshHits);
+                for (int i = 0; i < packet.count; i++)
+                {
+                    if (!(meshHitMask & (1u << i)))
+                        continue;
+                    hits[i] = { meshHits[i], instanceOrder[leaf] };
+                    hitMask |= 1u << i;
+                    if (anyHit)
+                        local.active &= ~(1u << i);
+                    else
+                        local.maxDistance[i] = meshHits[i].distance;
+                }
+            }
+        }
+        return hitMask;
+    }
+
+    // distances are ray parameters t: toObjectSpace does not renormalize the direction, so a hit has the same t in
+    // both spaces, while object space lengths differ by the scale of the instance
+    bool traverse(const AORay& ray, float maxDistance, bool anyHit, Hit& hit) const
+    {
+        if (instanceOrder.empty() || AOBvh::intersectBox(nodes[0], ray, maxDistance) == INFINITY)
+            return false;
+        bool found = false;
+        uint32_t stack[AOBvh::MAX_DEPTH];
+        int stackSize = 0;
+        uint32_t nodeIndex = 0;
+        while (true)
+        {
+            const AOBvhNode& node = nodes[nodeIndex];
+            if (node.count > 0)
+            {
+                for (uint32_t i = node.leftFirst; i < node.leftFirst + node.count; i++)
+                {
+                    const Instance& instance = instances[instanceOrder[i]];
+                    if (traverseMesh(instance.mesh, toObjectSpace(instance, ray), maxDistance, anyHit, hit.meshHit))
+                    {
+                        found = true;
+                        hit.instance = instanceOrder[i];
+                        if (anyHit)
+                            return true;
+                        maxDistance = hit.meshHit.distance;
+                    }
+                }
+            }
+            else
+            {
+                uint32_t near = node.leftFirst, far = node.leftFirst + 1;
+                float nearDistance = AOBvh::intersectBox(nodes[near], ray, maxDistance);
+                float farDistance = AOBvh::intersectBox(nodes[far], ray, maxDistance);
+                if (farDistance < nearDistance)
+                {
+                    std::swap(near, far);
+                    std::swap(nearDistance, farDistance);
+                }
+                if (nearDistance != INFINITY)
+                {
+                    if (farDistance != INFINITY)
+                        stack[stackSize++] = far;
+                    nodeIndex = near;
+                    continue;
+                }
+            }
+            if (stackSize == 0)
+                break;
+            nodeIndex = stack[--stackSize];
+        }
+        return found;
+    }
+};
+
+// Ground truth AO: for the surface seen through every pixel the fraction of cosine weighted hemisphere
+// rays that are not blocked within radius (1 - unoccluded, 0 - fully occluded), pixels without geometry are 1.
+struct AOReferenceSettings
+{
+    int samples = 64;
+    float radius = 0.5f;
+    bool packets = true; // trace AO_RAY_PACKET_SIZE rays together, primary rays of neighbouring pixels and AO rays of a pixel
+};
+
+// surface seen through a pixel, AO rays start at origin (slightly above the surface) in the hemisphere around normal
+struct AOSurface
+{
+    glm::vec3 origin = glm::vec3(0.0f);
+    glm::vec3 normal = glm::vec3(0.0f);
+    bool hit = false;
+};
+
+// primary ray through the pixel center, same pixel as the rasterized G-buffer
+inline AORay getAOPrimaryRay(const glm::mat4& invViewProjection, const glm::vec3& eye, int x, int y, int width, int height)
+{
+    glm::vec2 ndc((x + 0.5f) / width * 2.0f - 1.0f, (y + 0.5f) / height * 2.0f - 1.0f);
+    glm::vec4 farPoint = invViewProjection * glm::vec4(ndc, 1.0f, 1.0f);
+    return AORay(eye, glm::normalize(glm::vec3(farPoint) / farPoint.w - eye));
+}
+
+inline AOSurface makeAOSurface(const AORay& primary, float distance, const glm::vec3& normal)
+{
+    AOSurface surface;
+    glm::vec3 position = primary.origin + primary.direction * distance;
+    surface.normal = normal;
+    surface.origin = position + normal * (1e-4f * std::max(1.0f, distance));
+    surface.hit = true;
+    return surface;
+}
+
+inline AOSurface traceAOSurface(const AOScene& scene, const glm::mat4& invViewProjection, const glm::vec3& eye, int x, int y, int width, int height)
+{
+    AORay primary = getAOPrimaryRay(invViewProjection, eye, x, y, width, height);
+    float distance;
+    glm::vec3 normal;
+    if (!scene.intersect(primary, INFINITY, distance, normal))
+        return AOSurface();
+    return makeAOSurface(primary, distance, normal);
+}
+
+// surfaces of the pixels of row y, with packets the primary rays of AO_RAY_PACKET_SIZE neighbouring pixels are traced together
+inline void traceAOSurfaceRow(const AOScene& scene, const glm::mat4& invViewProjection, const glm::vec3& eye, int y, int width, int height,
+    bool packets, AOSurface* surfaces)
+{
+    if (!packets)
+    {
+        for (int x = 0; x < width; x++)
+            surfaces[x] = traceAOSurface(scene, invViewProjection, eye, x, y, width, height);
+        return;
+    }
+    for (int x0 = 0; x0 < width; x0 += AO_RAY_PACKET_SIZE)
+    {
+        AORayPacket packet;
+        for (int x = x0; x < std::min(x0 + AO_RAY_PACKET_SIZE, width); x++)
+            packet.add(getAOPrimaryRay(invViewProjection, eye, x, y, width, height), INFINITY);
+        float distances[AO_RAY_PACKET_SIZE];
+        glm::vec3 normals[AO_RAY_PACKET_SIZE];
+        uint32_t hitMask = scene.intersect(packet, distances, normals);
+        for (int i = 0; i < packet.count; i++)
+            surfaces[x0 + i] = (hitMask & (1u << i)) ? makeAOSurface(packet.getRay(i), distances[i], normals[i]) : AOSurface();
+    }
+}
+
+// share of the AO rays of pixel (x, y) that are not blocked within settings.radius
+inline float traceAOSamples(const AOScene& scene, const AOSurface& surface, int x, int y, const AOReferenceSettings& settings)
+{
+    const float GOLDEN_RATIO_FRACTION = 0.618033989f;
+    const float PI = 3.14159265f;
+    const glm::vec3& normal = surface.normal;
+    glm::vec3 tangent = glm::normalize(glm::cross(fabsf(normal.x) > 0.5f ? glm::vec3(0.0f, 1.0f, 0.0f) : glm::vec3(1.0f, 0.0f, 0.0f), normal));
+    glm::vec3 bitangent = glm::cross(normal, tangent);
+
+    // stratified cosine weighted directions, randomly rotated per pixel (Cranley-Patterson) to trade banding for noise
+    uint32_t hash = (uint32_t)x * 1973u + (uint32_t)y * 9277u + 26699u;
+    hash = (hash ^ (hash >> 16)) * 0x7feb352du;
+    hash = (hash ^ (hash >> 15)) * 0x846ca68bu;
+    hash ^= hash >> 16;
+    float offset0 = (hash & 0xffff) / 65536.0f;
+    float offset1 = (hash >> 16) / 65536.0f;
+    int unoccluded = 0;
+    AORayPacket packet;
+    for (int s = 0; s < settings.samples; s++)
+    {
+        float u0 = (s + offset0) / settings.samples;
+        float u1 = s * GOLDEN_RATIO_FRACTION + offset1;
+        u1 -= floorf(u1);
+        float r = sqrtf(u0);
+        float phi = 2.0f * PI * u1;
+        glm::vec3 direction = tangent * (r * cosf(phi)) + bitangent * (r * sinf(phi)) + normal * sqrtf(std::max(0.0f, 1.0f - u0));
+        AORay ray(surface.origin, direction);
+        if (!settings.packets)
+        {
+            if (!scene.occluded(ray, settings.radius))
+                unoccluded++;
+            continue;
+        }
+        packet.add(ray, settings.radius);
+        if (packet.count == AO_RAY_PACKET_SIZE || s + 1 == settings.samples)
+        {
+            unoccluded += packet.count - countAORays(scene.occluded(packet));
+            packet = AORayPacket();
+        }
+    }
+    return (float)unoccluded / settings.samples;
+}
+
+// renders the AO image of the scene as seen with the given camera matrices, image rows are traced in parallel
+inline AOImage renderReferenceAO(const AOScene& scene, const glm::mat4& view, const glm::mat4& projection,
+    int width, int height, const AOReferenceSettings& settings)
+{
+    AOImage image;
+    image.resize(width, height);
+    glm::mat4 invViewProjection = glm::inverse(projection * view);
+    glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+
+    parallelFor(height, [&](int y)
+    {
+        std::vector<AOSurface> surfaces(width);
+        traceAOSurfaceRow(scene, invViewProjection, eye, y, width, height, settings.packets, surfaces.data());
+        for (int x = 0; x < width; x++)
+            image.pixels[(size_t)y * width + x] = surfaces[x].hit ? traceAOSamples(scene, surfaces[x], x, y, settings) : 1.0f;
+    });
+    return image;
+}
+
+#endif
@@ -0,0 +1,63 @@
+#version 330 core
+
+// Joint bilateral upsampling of AO computed at 1 / scale resolution: the four low resolution pixels around
+// a pixel are weighted bilinearly and by how well their linear depth and normal match the full resolution G-buffer.
+out float FragColor;
+
+in vec2 TexCoord;
+
+uniform sampler2D aoInput;
+uniform sampler2D linearDepth;
+uniform sampler2D aoNormal;
+uniform sampler2D gDepth;
+uniform sampler2D gNormal;
+
+uniform vec2 LinMAD;
+uniform vec2 clipPlanes;
+uniform float scale;
+
+// relative depth difference with weight 1 / e, normal weight is dot(n, n')^NORMAL_POWER
+const float DEPTH_SIGMA = 0.02;
+const float NORMAL_POWER = 16.0;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    // the full resolution depth is only needed here, linearized per pixel like the AO passes do at aoScale 1
+    float d = texelFetch(gDepth, coord, 0).r * 2.0 - 1.0;
+    float depth = (1.0 / (LinMAD.x * d + LinMAD.y) - clipPlanes.x) / (clipPlanes.y - clipPlanes.x);
+    vec3 normal = normalize(texelFetch(gNormal, coord, 0).rgb);
+
+    // low resolution pixel i was taken from the render pixel i * scale + scale / 2 (ao_downsample.fs)
+    vec2 lowPosition = (vec2(coord) - floor(scale * 0.5)) / scale;
+    ivec2 lowBase = ivec2(floor(lowPosition));
+    vec2 lowFraction = lowPosition - vec2(lowBase);
+    ivec2 lowMax = textureSize(aoInput, 0) - 1;
+
+    float ao = 0.0;
+    float weightSum = 0.0;
+    float closestDifference = 1e30;
+    float closestAO = 1.0;
+    for (int i = 0; i < 4; i++)
+    {
+        ivec2 offset = ivec2(i & 1, i >> 1);
+        ivec2 lowCoord = clamp(lowBase + offset, ivec2(0), lowMax);
+        float lowAO = texelFetch(aoInput, lowCoord, 0).r;
+        float lowDepth = texelFetch(linearDepth, lowCoord, 0).r;
+        vec3 lowNormal = normalize(texelFetch(aoNormal, lowCoord, 0).rgb);
+
+        vec2 bilinear = mix(1.0 - lowFraction, lowFraction, vec2(offset));
+        float depthDifference = abs(lowDepth - depth) / max(depth, 1e-6);
+        float weight = bilinear.x * bilinear.y * exp(-depthDifference / DEPTH_SIGMA) *
+            pow(max(dot(normal, lowNormal), 0.0), NORMAL_POWER);
+        ao += weight * lowAO;
+        weightSum += weight;
+        if (depthDifference < closestDifference)
+        {
+            closestDifference = depthDifference;
+            closestAO = lowAO;
+        }
+    }
+    // no low resolution pixel on the same surface (thin features): nearest in depth
+    FragColor = weightSum > 1e-4 ? ao / weightSum : closestAO;
+}
@@ -0,0 +1,372 @@
+#ifndef BENCHMARK_COMPARE_H
+#define BENCHMARK_COMPARE_H
+
+#include "benchmark_report.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+const double BENCHMARK_COMPARE_ALPHA = 0.01;
+const double BENCHMARK_COMPARE_THRESHOLD_PERCENT = 5.0;
+
+// timing summary of a pass, enough for a t-test
+struct PassSummary
+{
+    size_t count = 0; // 0 if unknown (e.g. old text reports), the average is then taken as an exact value
+    double average = 0.0;
+    double deviation = 0.0; // population deviation, as written by BenchmarkReport
+};
+
+// Recorded benchmark run loaded from any of the files the recorder writes:
+// record_{mode}.csv (per-frame timings), report_{mode}.json (summary) or the older report_{mode}.txt
+// (summary without frame count, e.g. the reference runs in experiments/).
+class BenchmarkRun
+{
+public:
+    std::string path;
+    std::string renderMode;
+    std::vector<std::pair<std::string, PassSummary>> passes;
+
+    bool load(const std::string& runPath)
+    {
+        path = runPath;
+        renderMode.clear();
+        passes.clear();
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::BENCHMARK_COMPARE::FAILED_TO_READ: " << path << std::endl;
+            return false;
+        }
+        std::stringstream stream;
+        stream << file.rdbuf();
+        std::string text = stream.str();
+
+        bool loaded = false;
+        if (endsWith(path, ".csv"))
+            loaded = loadCsv(text);
+        else if (endsWith(path, ".json"))
+            loaded = loadJson(text);
+        else
+            loaded = loadText(text);
+        if (!loaded || passes.empty())
+        {
+            std::cout << "ERROR::BENCHMARK_COMPARE::NO_PASSES: " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    const PassSummary* findPass(const std::string& name) const
+    {
+        for (const auto& pass : passes)
+        {
+            if (pass.first == name)
+                return &pass.second;
+        }
+        return nullptr;
+    }
+
+private:
+    static bool endsWith(const std::string& text, const std::string& suffix)
+    {
+        return text.size() >= suffix.size() && text.compare(text.size() - suffix.size(), suffix.size(), suffix) == 0;
+    }
+
+    // metadata comments, header "frame,<pass>_ms,..." and one row per frame
+    bool loadCsv(const std::string& text)
+    {
+        std::istringstream stream(text);
+        std::string line;
+        std::vector<std::string> names;
+        std::vector<std::vector<double>> samples;
+        while (std::getline(stream, line))
+        {
+            if (line.empty())
+                continue;
+            if (line[0] == '#')
+            {
+                const std::string key = "# render_mode: ";
+                if (line.compare(0, key.size(), key) == 0)
+                    renderMode = line.substr(key.size());
+                continue;
+            }
+            std::vector<std::string> cells;
+            std::istringstream row(line);
+            std::string cell;
+            while (std::getline(row, cell, ','))
+                cells.push_back(cell);
+            if (names.empty())
+            {
+                for (size_t i = 1; i < cells.size(); i++)
+                    names.push_back(endsWith(cells[i], "_ms") ? cells[i].substr(0, cells[i].size() - 3) : cells[i]);
+                samples.resize(names.size());
+                continue;
+            }
+            // empty cell: the pass was not measured in this frame
+            for (size_t i = 1; i < cells.size() && i <= names.size(); i++)
+            {
+                if (!cells[i].empty())
+                    samples[i - 1].push_back(atof(cells[i].c_str()));
+            }
+        }
+        for (size_t i = 0; i < names.size(); i++)
+        {
+            TimingStats stats = TimingStats::compute(samples[i]);
+            passes.push_back({ names[i], { stats.count, stats.average, stats.deviation } });
+        }
+        return true;
+    }
+
+    // only reads what BenchmarkReport::writeJson writes: metadata strings and per-pass numbers
+    bool loadJson(const std::string& text)
+    {
+        size_t pos = text.find("\"render_mode\"");
+        if (pos != std::string::npos)
+        {
+            size_t begin = text.find('"', text.find(':', pos)) + 1;
+            renderMode = text.substr(begin, text.find('"', begin) - begin);
+        }
+        pos = text.find("\"passes\"");
+        if (pos == std::string::npos)
+            return false;
+        pos = text.find('{', pos) + 1;
+        while (true)
+        {
+            size_t nameBegin = text.find('"', pos);
+            size_t passEnd = text.find('}', pos);
+            // end of the passes object
+            if (nameBegin == std::string::npos || passEnd < nameBegin)
+                break;
+            size_t nameEnd = text.find('"', nameBegin + 1);
+            size_t bodyBegin = text.find('{', nameEnd);
+            // pass body ends after its nested histogram object
+            size_t histogram = text.find("\"histogram\"", bodyBegin);
+            size_t bodyEnd = text.find('}', histogram == std::string::npos ? bodyBegin : text.find('}', histogram) + 1);
+            std::string body = text.substr(bodyBegin, bodyEnd - bodyBegin);
+            PassSummary summary;
+            summary.count = (size_t)readJsonNumber(body, "frames");
+            summary.average = readJsonNumber(body, "avg_ms");
+            summary.deviation = readJsonNumber(body, "dev_ms");
+            passes.push_back({ text.substr(nameBegin + 1, nameEnd - nameBegin - 1), summary });
+            pos = bodyEnd + 1;
+        }
+        return true;
+    }
+
+    static double readJsonNumber(const std::string& body, const std::string& key)
+    {
+        size_t pos = body.find("\"" + key + "\"");
+        if (pos == std::string::npos)
+            return 0.0;
+        return atof(body.c_str() + body.find(':', pos) + 1);
+    }
+
+    // "render mode: {mode}", then a "{pass}" line followed by "  avg time (ms): x" and "  dev time (ms): x"
+    bool loadText(const std::string& text)
+    {
+        std::istringstream stream(text);
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            size_t colon = line.find(':');
+            std::string key = line.substr(0, colon);
+            key.erase(0, key.find_first_not_of(' '));
+            key.erase(key.find_last_not_of(' ') + 1);
+            if (colon == std::string::npos)
+            {
+                if (!key.empty())
+                    passes.push_back({ key, PassSummary() });
+                continue;
+            }
+            double value = atof(line.c_str() + colon + 1);
+            if (key == "render mode")
+            {
+                renderMode = line.substr(colon + 1);
+                renderMode.erase(0, renderMode.find_first_not_of(' '));
+            }
+            else if (!passes.empty() && key == "avg time (ms)")
+                passes.back().second.average = value;
+            else if (!passes.empty() && key == "dev time (ms)")
+                passes.back().second.deviation = value;
+            else if (!passes.empty() && key == "frames")
+                passes.back().second.count = (size_t)value;
+        }
+        return true;
+    }
+};
+
+// difference of a pass between two runs (candidate - baseline) with its confidence interval
+struct PassComparison
+{
+    std::string name;
+    PassSummary baseline;
+    PassSummary candidate;
+    double delta = 0.0;
+    double deltaPercent = 0.0;
+    double confidenceLow = 0.0;
+    double confidenceHigh = 0.0;
+    double pValue = 1.0;
+    bool significant = false;
+    bool regression = false;
+
+    // Welch's t-test, a baseline without frame count is compared as an exact value (one-sample t-test)
+    static PassComparison compute(const std::string& name, const PassSummary& baseline, const PassSummary& candidate,
+        double alpha, double thresholdPercent)
+    {
+        PassComparison result;
+        result.name = name;
+        result.baseline = baseline;
+        result.candidate = candidate;
+        result.delta = candidate.average - baseline.average;
+        result.deltaPercent = baseline.average > 0.0 ? 100.0 * result.delta / baseline.average : 0.0;
+
+        double variance = 0.0;
+        double degreesOfFreedom = 0.0;
+        double candidateTerm = sampleVariance(candidate) / std::max<size_t>(candidate.count, 1);
+        if (baseline.count > 1)
+        {
+            double baselineTerm = sampleVariance(baseline) / baseline.count;
+            variance = candidateTerm + baselineTerm;
+            double denominator = candidateTerm * candidateTerm / std::max<double>(candidate.count - 1.0, 1.0) +
+                                 baselineTerm * baselineTerm / (baseline.count - 1.0);
+            degreesOfFreedom = denominator > 0.0 ? variance * variance / denominator : candidate.count + baseline.count - 2.0;
+        }
+        else
+        {
+            variance = candidateTerm;
+            degreesOfFreedom = candidate.count - 1.0;
+        }
+
+        if (candidate.count < 2 || degreesOfFreedom < 1.0)
+            return result;
+        double standardError = sqrt(variance);
+        if (standardError > 0.0)
+        {
+            double t = result.delta / standardError;
+            result.pValue = 2.0 * (1.0 - studentTCdf(fabs(t), degreesOfFreedom));
+        }
+        else
+            result.pValue = result.delta == 0.0 ? 1.0 : 0.0;
+        double margin = studentTQuantile(1.0 - alpha / 2.0, degreesOfFreedom) * standardError;
+        result.confidenceLow = result.delta - margin;
+        result.confidenceHigh = result.delta + margin;
+        result.significant = result.pValue < alpha;
+        result.regression = result.significant && result.deltaPercent > thresholdPercent;
+        return result;
+    }
+
+    static double sampleVariance(const PassSummary& summary)
+    {
+        if (summary.count < 2)
+            return 0.0;
+        return summary.deviation * summary.deviation * summary.count / (summary.count - 1.0);
+    }
+
+    static double studentTCdf(double t, double degreesOfFreedom)
+    {
+        double x = degreesOfFreedom / (degreesOfFreedom + t * t);
+        double tail = 0.5 * incompleteBeta(0.5 * degreesOfFreedom, 0.5, x);
+        return t >= 0.0 ? 1.0 - tail : tail;
+    }
+
+    static double studentTQuantile(double p, double degreesOfFreedom)
+    {
+        double lo = 0.0, hi = 1000.0;
+        for (int i = 0; i < 100; i++)
+        {
+            double mid = 0.5 * (lo + hi);
+            if (studentTCdf(mid, degreesOfFreedom) < p)
+                lo = mid;
+            else
+                hi = mid;
+        }
+        return 0.5 * (lo + hi);
+    }
+
+    // regularized incomplete beta function I_x(a, b), continued fraction (Numerical Recipes, betacf)
+    static double incompleteBeta(double a, double b, double x)
+    {
+        if (x <= 0.0)
+            return 0.0;
+        if (x >= 1.0)
+            return 1.0;
+        if (x > (a + 1.0) / (a + b + 2.0))
+            return 1.0 - incompleteBeta(b, a, 1.0 - x);
+
+        const double EPSILON = 1e-14;
+        const double TINY = 1e-300;
+        double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1.0 - x)) / a;
+        double c = 1.0;
+        double d = 1.0 - (a + b) * x / (a + 1.0);
+        d = 1.0 / (fabs(d) < TINY ? TINY : d);
+        double h = d;
+        for (int m = 1; m <= 300; m++)
+        {
+            double numerator = m * (b - m) * x / ((a + 2.0 * m - 1.0) * (a + 2.0 * m));
+            d = 1.0 + numerator * d;
+            d = 1.0 / (fabs(d) < TINY ? TINY : d);
+            c = 1.0 + numerator / c;
+            c = fabs(c) < TINY ? TINY : c;
+            h *= d * c;
+            numerator = -(a + m) * (a + b + m) * x / ((a + 2.0 * m) * (a + 2.0 * m + 1.0));
+            d = 1.0 + numerator * d;
+            d = 1.0 / (fabs(d) < TINY ? TINY : d);
+            c = 1.0 + numerator / c;
+            c = fabs(c) < TINY ? TINY : c;
+            double delta = d * c;
+            h *= delta;
+            if (fabs(delta - 1.0) < EPSILON)
+                break;
+        }
+        return front * h;
+    }
+};
+
+// compares every pass present in both runs, prints a table and returns the number of significant regressions
+inline int compareBenchmarkRuns(const BenchmarkRun& baseline, const BenchmarkRun& candidate, double alpha, double thresholdPercent)
+{
+    std::cout << "baseline:  " << baseline.path << (baseline.renderMode.empty() ? "" : " (" + baseline.renderMode + ")") << "\n";
+    std::cout << "candidate: " << candidate.path << (candidate.renderMode.empty() ? "" : " (" + candidate.renderMode + ")") << "\n";
+    if (!baseline.renderMode.empty() && !candidate.renderMode.empty() && baseline.renderMode != candidate.renderMode)
+        std::cout << "warning: comparing different render modes\n";
+    printf("%-28s %12s %12s %10s %9s %25s %10s\n", "pass", "base (ms)", "cand (ms)", "delta", "delta %",
+        ("CI " + std::to_string((int)round(100.0 * (1.0 - alpha))) + "% (ms)").c_str(), "p");
+
+    int regressions = 0;
+    int compared = 0;
+    for (const auto& pass : baseline.passes)
+    {
+        const PassSummary* candidatePass = candidate.findPass(pass.first);
+        if (candidatePass == nullptr)
+            continue;
+        PassComparison comparison = PassComparison::compute(pass.first, pass.second, *candidatePass, alpha, thresholdPercent);
+        compared++;
+        char interval[64];
+        snprintf(interval, sizeof(interval), "[%+.4f, %+.4f]", comparison.confidenceLow, comparison.confidenceHigh);
+        const char* verdict = comparison.regression ? "REGRESSION" : (comparison.significant ? (comparison.delta < 0.0 ? "faster" : "slower") : "");
+        printf("%-28s %12.4f %12.4f %+10.4f %+8.2f%% %25s %10.2g  %s\n", pass.first.c_str(),
+            comparison.baseline.average, comparison.candidate.average, comparison.delta, comparison.deltaPercent,
+            interval, comparison.pValue, verdict);
+        if (comparison.regression)
+            regressions++;
+    }
+    if (compared == 0)
+        std::cout << "no common passes to compare\n";
+    else if (regressions > 0)
+        std::cout << regressions << " pass(es) significantly slower (p < " << alpha << ") by more than " << thresholdPercent << "%\n";
+    else
+        std::cout << "no significant regression beyond " << thresholdPercent << "%\n";
+    return regressions;
+}
+
+#endif
@@ -0,0 +1,232 @@
+#ifndef BENCHMARK_REPORT_H
+#define BENCHMARK_REPORT_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+const int BENCHMARK_HISTOGRAM_BINS = 20;
+
+// summary of a series of timings in milliseconds
+struct TimingStats
+{
+    size_t count = 0;
+    double average = 0.0;
+    double deviation = 0.0;
+    double min = 0.0;
+    double max = 0.0;
+    double p50 = 0.0;
+    double p90 = 0.0;
+    double p99 = 0.0;
+    // equal width bins between min and max
+    double histogramBinWidth = 0.0;
+    std::vector<int> histogram;
+
+    static TimingStats compute(std::vector<double> samples, int histogramBins = BENCHMARK_HISTOGRAM_BINS)
+    {
+        TimingStats stats;
+        stats.count = samples.size();
+        stats.histogram.assign(histogramBins, 0);
+        if (samples.empty())
+            return stats;
+
+        std::sort(samples.begin(), samples.end());
+        stats.min = samples.front();
+        stats.max = samples.back();
+        stats.p50 = percentile(samples, 0.50);
+        stats.p90 = percentile(samples, 0.90);
+        stats.p99 = percentile(samples, 0.99);
+
+        for (double s : samples)
+            stats.average += s;
+        stats.average /= samples.size();
+        for (double s : samples)
+            stats.deviation += (s - stats.average) * (s - stats.average);
+        stats.deviation = sqrt(stats.deviation / samples.size());
+
+        stats.histogramBinWidth = (stats.max - stats.min) / histogramBins;
+        for (double s : samples)
+        {
+            int bin = stats.histogramBinWidth > 0.0 ? (int)((s - stats.min) / stats.histogramBinWidth) : 0;
+            stats.histogram[std::min(bin, histogramBins - 1)]++;
+        }
+        return stats;
+    }
+
+    // linear interpolation between closest ranks, samples must be sorted
+    static double percentile(const std::vector<double>& sorted, double p)
+    {
+        double rank = p * (sorted.size() - 1);
+        size_t lo = (size_t)floor(rank);
+        size_t hi = std::min(lo + 1, sorted.size() - 1);
+        return sorted[lo] + (rank - lo) * (sorted[hi] - sorted[lo]);
+    }
+};
+
+// Machine-readable benchmark output: every recorded frame goes into a CSV file and the summary
+// (percentiles, histogram) into a JSON file. Both carry the same metadata describing the run.
+class BenchmarkReport
+{
+public:
+    void setMetadata(const std::string& key, const std::string& value)
+    {
+        for (auto& entry : metadata)
+        {
+            if (entry.first == key)
+            {
+                entry.second = value;
+                return;
+            }
+        }
+        metadata.push_back({ key, value });
+    }
+
+    void setMetadata(const std::string& key, double value)
+    {
+        setMetadata(key, formatNumber(value));
+    }
+
+    // per-frame timings of a pass; a pass measured in only some frames gives the frame of every sample,
+    // the summary then covers those frames only and the CSV leaves the other frames of the pass empty
+    void addPass(const std::string& name, std::vector<double> timesMs, std::vector<size_t> frames = {})
+    {
+        if (frames.empty())
+        {
+            for (size_t i = 0; i < timesMs.size(); i++)
+                frames.push_back(i);
+        }
+        passes.push_back({ name, std::move(timesMs), std::move(frames) });
+    }
+
+    // pass holding the whole frame time, summary of every pass then includes its share of the frame
+    void setFramePass(const std::string& name)
+    {
+        framePass = name;
+    }
+
+    // metadata as '# key: value' lines followed by one row per frame
+    bool writeCsv(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::BENCHMARK_REPORT::FAILED_TO_WRITE: " << path << std::endl;
+            return false;
+        }
+        for (const auto& entry : metadata)
+            file << "# " << entry.first << ": " << entry.second << "\n";
+        file << "frame";
+        for (const auto& pass : passes)
+            file << "," << pass.name << "_ms";
+        file << "\n";
+        size_t frameCount = 0;
+        for (const auto& pass : passes)
+        {
+            if (!pass.frames.empty())
+                frameCount = std::max(frameCount, pass.frames.back() + 1);
+        }
+        std::vector<size_t> next(passes.size(), 0);
+        for (size_t i = 0; i < frameCount; i++)
+        {
+            file << i;
+            for (size_t j = 0; j < passes.size(); j++)
+            {
+                file << ",";
+                if (next[j] < passes[j].frames.size() && passes[j].frames[next[j]] == i)
+                    file << formatNumber(passes[j].timesMs[next[j]++]);
+            }
+            file << "\n";
+        }
+        return true;
+    }
+
+    bool writeJson(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::BENCHMARK_REPORT::FAILED_TO_WRITE: " << path << std::endl;
+            return false;
+        }
+        file << "{\n  \"metadata\": {";
+        for (size_t i = 0; i < metadata.size(); i++)
+            file << (i ? "," : "") << "\n    " << quote(metadata[i].first) << ": " << quote(metadata[i].second);
+        file << "\n  },\n  \"passes\": {";
+        double frameAverage = 0.0;
+        for (const auto& pass : passes)
+        {
+            if (pass.name == framePass)
+                frameAverage = TimingStats::compute(pass.timesMs).average;
+        }
+        for (size_t i = 0; i < passes.size(); i++)
+        {
+            TimingStats stats = TimingStats::compute(passes[i].timesMs);
+            file << (i ? "," : "") << "\n    " << quote(passes[i].name) << ": {\n";
+            file << "      \"frames\": " << stats.count << ",\n";
+            file << "      \"avg_ms\": " << formatNumber(stats.average) << ",\n";
+            file << "      \"dev_ms\": " << formatNumber(stats.deviation) << ",\n";
+            file << "      \"min_ms\": " << formatNumber(stats.min) << ",\n";
+            file << "      \"max_ms\": " << formatNumber(stats.max) << ",\n";
+            file << "      \"p50_ms\": " << formatNumber(stats.p50) << ",\n";
+            file << "      \"p90_ms\": " << formatNumber(stats.p90) << ",\n";
+            file << "      \"p99_ms\": " << formatNumber(stats.p99) << ",\n";
+            if (frameAverage > 0.0)
+                file << "      \"frame_fraction\": " << formatNumber(stats.average / frameAverage) << ",\n";
+            file << "      \"histogram\": { \"min_ms\": " << formatNumber(stats.min)
+                 << ", \"bin_width_ms\": " << formatNumber(stats.histogramBinWidth) << ", \"counts\": [";
+            for (size_t j = 0; j < stats.histogram.size(); j++)
+                file << (j ? ", " : "") << stats.histogram[j];
+            file << "] }\n    }";
+        }
+        file << "\n  }\n}\n";
+        return true;
+    }
+
+private:
+    struct Pass
+    {
+        std::string name;
+        std::vector<double> timesMs;
+        std::vector<size_t> frames; // recorded frame of every sample, ascending
+    };
+
+    std::vector<std::pair<std::string, std::string>> metadata;
+    std::vector<Pass> passes;
+    std::string framePass;
+
+    static std::string formatNumber(double value)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), "%.6g", value);
+        return buffer;
+    }
+
+    static std::string quote(const std::string& value)
+    {
+        std::string result = "\"";
+        for (char c : value)
+        {
+            if (c == '"' || c == '\\')
+            {
+                result += '\\';
+                result += c;
+            }
+            else if ((unsigned char)c < 0x20)
+            {
+                char buffer[8];
+                snprintf(buffer, sizeof(buffer), "\\u%04x", c);
+                result += buffer;
+            }
+            else
+                result += c;
+        }
+        return result + "\"";
+    }
+};
+
+#endif
@@ -0,0 +1,66 @@
+// Compute shader version of bilateral_blur.fs: a work group blurs GROUP_SIZE pixels of a row (horizontal pass)
+// or a column (vertical pass), the line and KERNEL_RADIUS pixels on each side are read into shared memory once.
+
+#version 430 core
+
+// specialized by the application like bilateral_blur.fs, the group size with it
+#ifndef KERNEL_RADIUS
+#define KERNEL_RADIUS 2
+#endif
+#ifndef GROUP_SIZE
+#define GROUP_SIZE 64
+#endif
+
+layout (local_size_x = GROUP_SIZE) in;
+
+// blurred AO and the packed depth of the input
+layout (rg16f) uniform writeonly image2D aoOutput;
+
+uniform sampler2D ssaoInput;
+// (1, 0) for the horizontal pass, (0, 1) for the vertical one
+uniform vec2 direction;
+// weight of the depth difference relative to the center depth, independent of distance and depth packing
+uniform float sharpness = 32.0;
+
+// AO and packed depth of the line, clamped to the edge of the image
+shared vec2 line[GROUP_SIZE + 2 * KERNEL_RADIUS];
+
+// box of 2 * KERNEL_RADIUS pixels with the outer taps at half weight, so noise repeating every 2 * KERNEL_RADIUS
+// pixels (the 4x4 noise texture with the default radius) averages out like in a box blur of that size
+float BlurWeight(int r, float depth, float centerDepth)
+{
+    float depthDiff = (depth - centerDepth) / centerDepth * sharpness;
+    return (r == KERNEL_RADIUS ? 0.5 : 1.0) * exp(-depthDiff * depthDiff);
+}
+
+void main()
+{
+    // work group (x, y) covers pixels x * GROUP_SIZE onwards of row or column y
+    ivec2 size = textureSize(ssaoInput, 0);
+    ivec2 tapStep = ivec2(direction);
+    ivec2 lineStart = int(gl_WorkGroupID.x) * GROUP_SIZE * tapStep + int(gl_WorkGroupID.y) * (ivec2(1) - tapStep);
+    for (int i = int(gl_LocalInvocationIndex); i < GROUP_SIZE + 2 * KERNEL_RADIUS; i += GROUP_SIZE)
+        line[i] = texelFetch(ssaoInput, clamp(lineStart + (i - KERNEL_RADIUS) * tapStep, ivec2(0), size - 1), 0).rg;
+    barrier();
+
+    ivec2 pixel = lineStart + int(gl_LocalInvocationID.x) * tapStep;
+    if (any(greaterThanEqual(pixel, size)))
+        return;
+
+    int c = int(gl_LocalInvocationID.x) + KERNEL_RADIUS;
+    vec2 center = line[c];
+
+    float ao = center.x;
+    float totalWeight = 1.0;
+    for (int r = 1; r <= KERNEL_RADIUS; ++r)
+    {
+        vec2 s0 = line[c - r];
+        vec2 s1 = line[c + r];
+        float w0 = BlurWeight(r, s0.y, center.y);
+        float w1 = BlurWeight(r, s1.y, center.y);
+        ao += w0 * s0.x + w1 * s1.x;
+        totalWeight += w0 + w1;
+    }
+
+    imageStore(aoOutput, pixel, vec4(ao / totalWeight, center.y, 0.0, 0.0));
+}
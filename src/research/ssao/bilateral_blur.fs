@@ -0,0 +1,48 @@
+#version 330 core
+
+// Separable cross bilateral blur of the AO, one direction per pass. Taps are weighted by the difference of
+// their depth to the center one, so AO does not bleed across silhouettes. The depth is the one every AO pass
+// packs next to the AO (30 * view space z), the output keeps it for the next pass.
+out vec2 FragColor;
+
+uniform sampler2D ssaoInput;
+// (1, 0) for the horizontal pass, (0, 1) for the vertical one
+uniform vec2 direction;
+// weight of the depth difference relative to the center depth, independent of distance and depth packing
+uniform float sharpness = 32.0;
+
+// taps on each side of the center, specialized by the application (--blur-radius)
+#ifndef KERNEL_RADIUS
+#define KERNEL_RADIUS 2
+#endif
+
+// box of 2 * KERNEL_RADIUS pixels with the outer taps at half weight, so noise repeating every 2 * KERNEL_RADIUS
+// pixels (the 4x4 noise texture with the default radius) averages out like in a box blur of that size
+float BlurWeight(int r, float depth, float centerDepth)
+{
+    float depthDiff = (depth - centerDepth) / centerDepth * sharpness;
+    return (r == KERNEL_RADIUS ? 0.5 : 1.0) * exp(-depthDiff * depthDiff);
+}
+
+void main()
+{
+    ivec2 size = textureSize(ssaoInput, 0);
+    ivec2 pixel = ivec2(gl_FragCoord.xy);
+    ivec2 tapStep = ivec2(direction);
+    vec2 center = texelFetch(ssaoInput, pixel, 0).rg;
+
+    float ao = center.x;
+    float totalWeight = 1.0;
+    for (int r = 1; r <= KERNEL_RADIUS; ++r)
+    {
+        // clamp to edge
+        vec2 s0 = texelFetch(ssaoInput, clamp(pixel - r * tapStep, ivec2(0), size - 1), 0).rg;
+        vec2 s1 = texelFetch(ssaoInput, clamp(pixel + r * tapStep, ivec2(0), size - 1), 0).rg;
+        float w0 = BlurWeight(r, s0.y, center.y);
+        float w1 = BlurWeight(r, s1.y, center.y);
+        ao += w0 * s0.x + w1 * s1.x;
+        totalWeight += w0 + w1;
+    }
+
+    FragColor = vec2(ao / totalWeight, center.y);
+}
@@ -0,0 +1,127 @@
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/camera.h>
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <limits>
+
+// camera state of a single frame
+struct CameraPathFrame
+{
+    glm::vec3 position;
+    float yaw;
+    float pitch;
+    float zoom;
+};
+
+// Sequence of camera states, one per frame. Recorded from live input and replayed with a fixed
+// timestep, so different render modes can be measured over exactly the same pixels.
+// File format is plain text, one frame per line: "x y z yaw pitch zoom", lines starting with '#' are ignored.
+class CameraPath
+{
+public:
+    std::vector<CameraPathFrame> frames;
+
+    size_t size() const
+    {
+        return frames.size();
+    }
+
+    bool empty() const
+    {
+        return frames.empty();
+    }
+
+    void record(const Camera& camera)
+    {
+        frames.push_back({ camera.Position, camera.Yaw, camera.Pitch, camera.Zoom });
+    }
+
+    // sets camera state to the given frame, wraps around the end of the path
+    void apply(Camera& camera, size_t frame) const
+    {
+        const CameraPathFrame& f = frames[frame % frames.size()];
+        camera.Position = f.position;
+        camera.Yaw = f.yaw;
+        camera.Pitch = f.pitch;
+        camera.Zoom = f.zoom;
+        // no movement, only recalculates camera vectors from the new angles
+        camera.ProcessMouseMovement(0.0f, 0.0f, false);
+    }
+
+    bool save(const std::string& path) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::CAMERA_PATH::FAILED_TO_WRITE: " << path << std::endl;
+            return false;
+        }
+        // enough digits for every float to read back exactly, a replay then reproduces the recorded camera
+        file << std::setprecision(std::numeric_limits<float>::max_digits10);
+        file << "# x y z yaw pitch zoom\n";
+        for (const auto& f : frames)
+            file << f.position.x << " " << f.position.y << " " << f.position.z << " " << f.yaw << " " << f.pitch << " " << f.zoom << "\n";
+        return true;
+    }
+
+    bool load(const std::string& path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::CAMERA_PATH::FAILED_TO_READ: " << path << std::endl;
+            return false;
+        }
+        frames.clear();
+        std::string line;
+        while (std::getline(file, line))
+        {
+            if (line.empty() || line[0] == '#')
+                continue;
+            std::istringstream stream(line);
+            CameraPathFrame f;
+            if (stream >> f.position.x >> f.position.y >> f.position.z >> f.yaw >> f.pitch >> f.zoom)
+                frames.push_back(f);
+        }
+        if (frames.empty())
+            std::cout << "ERROR::CAMERA_PATH::NO_FRAMES: " << path << std::endl;
+        return !frames.empty();
+    }
+
+    // builds a path which holds each view for framesPerView frames and moves between consecutive views in as many frames
+    static CameraPath fromViews(const std::vector<CameraPathFrame>& views, int framesPerView)
+    {
+        CameraPath path;
+        for (size_t i = 0; i < views.size(); i++)
+        {
+            for (int j = 0; j < framesPerView; j++)
+                path.frames.push_back(views[i]);
+            if (i + 1 == views.size())
+                break;
+            const CameraPathFrame& a = views[i];
+            const CameraPathFrame& b = views[i + 1];
+            for (int j = 1; j < framesPerView; j++)
+            {
+                float t = float(j) / framesPerView;
+                path.frames.push_back({
+                    glm::mix(a.position, b.position, t),
+                    glm::mix(a.yaw, b.yaw, t),
+                    glm::mix(a.pitch, b.pitch, t),
+                    glm::mix(a.zoom, b.zoom, t)
+                });
+            }
+        }
+        return path;
+    }
+};
+
+#endif
@@ -0,0 +1,377 @@
+// Non-template code of the CPU AO engines and the software rasterizer. It is only compiled with the baseline
+// flags of the project: inline code used by ssao_kernels_*.cpp would get a copy built for their instruction set
+// there, and the linker could keep that copy for every caller (see cpu_dispatch.h).
+#include "ao_image.h"
+#include "cpu_ao.h"
+#include "cpu_rasterizer.h"
+#include "tile_scheduler.h"
+
+#include <algorithm>
+#include <chrono>
+
+void AOImage::resize(int imageWidth, int imageHeight)
+{
+    width = imageWidth;
+    height = imageHeight;
+    pixels.assign((size_t)width * height, 0.0f);
+}
+
+void CpuGBuffer::resize(int bufferWidth, int bufferHeight)
+{
+    width = bufferWidth;
+    height = bufferHeight;
+    linearDepth.assign((size_t)width * height, 1.0f);
+    normals.assign((size_t)width * height, glm::vec3(0.0f));
+}
+
+TileScheduler::TileScheduler(int threadCount)
+{
+    if (threadCount <= 0)
+        threadCount = getHardwareThreadCount();
+    for (int i = 0; i < threadCount; i++)
+        queues.emplace_back(new TileQueue());
+    stats.resize(threadCount);
+    for (int i = 1; i < threadCount; i++)
+        threads.emplace_back(&TileScheduler::workerLoop, this, i);
+}
+
+TileScheduler::~TileScheduler()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+void TileScheduler::run(int width, int height, int tileSize, TileFunction function, const void* body)
+{
+    auto start = std::chrono::steady_clock::now();
+    int tilesX = (width + tileSize - 1) / tileSize;
+    int tilesY = (height + tileSize - 1) / tileSize;
+    int tileCount = tilesX * tilesY;
+    int threadCount = getThreadCount();
+    for (int tile = 0; tile < tileCount; tile++)
+    {
+        int x0 = (tile % tilesX) * tileSize;
+        int y0 = (tile / tilesX) * tileSize;
+        queues[(size_t)tile * threadCount / tileCount]->tiles.push_back({ x0, y0, std::min(x0 + tileSize, width), std::min(y0 + tileSize, height) });
+    }
+    std::fill(stats.begin(), stats.end(), TileSchedulerThreadStats());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        jobFunction = function;
+        jobBody = body;
+        generation++;
+        runningWorkers = (int)threads.size();
+    }
+    wake.notify_all();
+    runTiles(0);
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        done.wait(lock, [&]() { return runningWorkers == 0; });
+        jobFunction = nullptr;
+        jobBody = nullptr;
+    }
+    wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void TileScheduler::workerLoop(int thread)
+{
+    unsigned int seenGeneration = 0;
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation != seenGeneration; });
+            if (stopping)
+                return;
+            seenGeneration = generation;
+        }
+        runTiles(thread);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--runningWorkers == 0)
+                done.notify_one();
+        }
+    }
+}
+
+void TileScheduler::runTiles(int thread)
+{
+    TileSchedulerThreadStats& threadStats = stats[thread];
+    Tile tile;
+    bool stolen;
+    while (takeTile(thread, tile, stolen))
+    {
+        auto start = std::chrono::steady_clock::now();
+        jobFunction(jobBody, tile.x0, tile.y0, tile.x1, tile.y1);
+        threadStats.busyMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        threadStats.tiles++;
+        if (stolen)
+            threadStats.steals++;
+    }
+}
+
+bool TileScheduler::takeTile(int thread, Tile& tile, bool& stolen)
+{
+    {
+        TileQueue& own = *queues[thread];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (!own.tiles.empty())
+        {
+            tile = own.tiles.front();
+            own.tiles.pop_front();
+            stolen = false;
+            return true;
+        }
+    }
+    int threadCount = getThreadCount();
+    for (int i = 1; i < threadCount; i++)
+    {
+        TileQueue& victim = *queues[(thread + i) % threadCount];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (!victim.tiles.empty())
+        {
+            tile = victim.tiles.back();
+            victim.tiles.pop_back();
+            stolen = true;
+            return true;
+        }
+    }
+    return false;
+}
+
+namespace
+{
+const int MAX_CLIP_VERTICES = 3 + 6;
+
+struct ClipVertex
+{
+    glm::vec4 position;
+    glm::vec3 normal;
+};
+
+// near, far and the guard band planes, a vertex is inside when dot(plane, position) >= 0
+float getClipDistance(const glm::vec4& p, int plane, float guardBand)
+{
+    switch (plane)
+    {
+    case 0:
+        return p.z + p.w;
+    case 1:
+        return p.w - p.z;
+    case 2:
+        return guardBand * p.w + p.x;
+    case 3:
+        return guardBand * p.w - p.x;
+    case 4:
+        return guardBand * p.w + p.y;
+    default:
+        return guardBand * p.w - p.y;
+    }
+}
+
+int getOutCode(const glm::vec4& p, float guardBand)
+{
+    int code = 0;
+    for (int plane = 0; plane < 6; plane++)
+    {
+        if (getClipDistance(p, plane, guardBand) < 0.0f)
+            code |= 1 << plane;
+    }
+    return code;
+}
+
+CpuRasterPlane getPlane(const CpuRasterPlane* edges, float area, float a0, float a1, float a2)
+{
+    CpuRasterPlane plane;
+    plane.a = (edges[0].a * a0 + edges[1].a * a1 + edges[2].a * a2) / area;
+    plane.b = (edges[0].b * a0 + edges[1].b * a1 + edges[2].b * a2) / area;
+    plane.c = a0;
+    return plane;
+}
+
+void setupTriangle(const CpuRasterView& view, const ClipVertex& c0, const ClipVertex& c1, const ClipVertex& c2, int tilesX,
+    std::vector<CpuRasterTriangle>& triangles, std::vector<std::vector<uint32_t>>& bins)
+{
+    const ClipVertex* clip[3] = { &c0, &c1, &c2 };
+    float x[3], y[3], z[3], invW[3];
+    for (int k = 0; k < 3; k++)
+    {
+        const glm::vec4& p = clip[k]->position;
+        invW[k] = 1.0f / p.w;
+        x[k] = roundf((p.x * invW[k] * 0.5f + 0.5f) * view.width * CPU_RASTER_SUBPIXELS) / CPU_RASTER_SUBPIXELS;
+        y[k] = roundf((p.y * invW[k] * 0.5f + 0.5f) * view.height * CPU_RASTER_SUBPIXELS) / CPU_RASTER_SUBPIXELS;
+        z[k] = p.z * invW[k] * 0.5f + 0.5f;
+    }
+    // no face culling in the geometry pass, clockwise triangles are flipped to counter-clockwise
+    float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+    if (area == 0.0f)
+        return;
+    if (area < 0.0f)
+    {
+        std::swap(clip[1], clip[2]);
+        std::swap(x[1], x[2]);
+        std::swap(y[1], y[2]);
+        std::swap(z[1], z[2]);
+        std::swap(invW[1], invW[2]);
+        area = -area;
+    }
+
+    CpuRasterTriangle triangle;
+    triangle.minX = std::max(0, (int)ceilf(std::min(x[0], std::min(x[1], x[2])) - 0.5f));
+    triangle.minY = std::max(0, (int)ceilf(std::min(y[0], std::min(y[1], y[2])) - 0.5f));
+    triangle.maxX = std::min(view.width - 1, (int)floorf(std::max(x[0], std::max(x[1], x[2])) - 0.5f));
+    triangle.maxY = std::min(view.height - 1, (int)floorf(std::max(y[0], std::max(y[1], y[2])) - 0.5f));
+    if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY)
+        return;
+
+    triangle.originX = x[0];
+    triangle.originY = y[0];
+    for (int i = 0; i < 3; i++)
+    {
+        int a = (i + 1) % 3, b = (i + 2) % 3;
+        float dx = x[b] - x[a], dy = y[b] - y[a];
+        CpuRasterPlane& edge = triangle.edges[i];
+        edge.a = -dy;
+        edge.b = dx;
+        edge.c = edge.a * (x[0] - x[a]) + edge.b * (y[0] - y[a]);
+        // with y up, left edges run downwards and top edges to the left
+        triangle.inclusive[i] = dy < 0.0f || (dy == 0.0f && dx < 0.0f);
+    }
+    triangle.depth = getPlane(triangle.edges, area, z[0], z[1], z[2]);
+    triangle.invW = getPlane(triangle.edges, area, invW[0], invW[1], invW[2]);
+    for (int c = 0; c < 3; c++)
+        triangle.normal[c] = getPlane(triangle.edges, area, clip[0]->normal[c] * invW[0], clip[1]->normal[c] * invW[1], clip[2]->normal[c] * invW[2]);
+    triangle.minDepth = std::min(z[0], std::min(z[1], z[2]));
+
+    uint32_t index = (uint32_t)triangles.size();
+    triangles.push_back(triangle);
+    for (int ty = triangle.minY / CPU_RASTER_TILE_SIZE; ty <= triangle.maxY / CPU_RASTER_TILE_SIZE; ty++)
+    {
+        for (int tx = triangle.minX / CPU_RASTER_TILE_SIZE; tx <= triangle.maxX / CPU_RASTER_TILE_SIZE; tx++)
+            bins[ty * tilesX + tx].push_back(index);
+    }
+}
+
+// Sutherland-Hodgman against the near and far planes and the guard band, the polygon is set up as a fan
+void clipTriangle(const CpuRasterView& view, const ClipVertex* vertices, int tilesX, std::vector<CpuRasterTriangle>& triangles,
+    std::vector<std::vector<uint32_t>>& bins)
+{
+    int frustumCodes[3], guardCodes[3];
+    for (int k = 0; k < 3; k++)
+    {
+        frustumCodes[k] = getOutCode(vertices[k].position, 1.0f);
+        guardCodes[k] = getOutCode(vertices[k].position, CPU_RASTER_GUARD_BAND);
+    }
+    if (frustumCodes[0] & frustumCodes[1] & frustumCodes[2])
+        return;
+    if ((guardCodes[0] | guardCodes[1] | guardCodes[2]) == 0)
+    {
+        setupTriangle(view, vertices[0], vertices[1], vertices[2], tilesX, triangles, bins);
+        return;
+    }
+
+    ClipVertex polygon[2][MAX_CLIP_VERTICES];
+    int count = 3;
+    std::copy(vertices, vertices + 3, polygon[0]);
+    int current = 0;
+    for (int plane = 0; plane < 6 && count >= 3; plane++)
+    {
+        const ClipVertex* in = polygon[current];
+        ClipVertex* out = polygon[current ^ 1];
+        int outCount = 0;
+        for (int i = 0; i < count; i++)
+        {
+            const ClipVertex& a = in[i];
+            const ClipVertex& b = in[(i + 1) % count];
+            float da = getClipDistance(a.position, plane, CPU_RASTER_GUARD_BAND);
+            float db = getClipDistance(b.position, plane, CPU_RASTER_GUARD_BAND);
+            if (da >= 0.0f)
+                out[outCount++] = a;
+            if ((da >= 0.0f) != (db >= 0.0f))
+            {
+                float t = da / (da - db);
+                out[outCount].position = a.position + (b.position - a.position) * t;
+                out[outCount].normal = a.normal + (b.normal - a.normal) * t;
+                outCount++;
+            }
+        }
+        count = outCount;
+        current ^= 1;
+    }
+    for (int i = 1; i + 1 < count; i++)
+        setupTriangle(view, polygon[current][0], polygon[current][i], polygon[current][i + 1], tilesX, triangles, bins);
+}
+}
+
+void CpuRasterScene::setup(const CpuRasterView& view, TileScheduler& scheduler)
+{
+    int tilesX = (view.width + CPU_RASTER_TILE_SIZE - 1) / CPU_RASTER_TILE_SIZE;
+    int tilesY = (view.height + CPU_RASTER_TILE_SIZE - 1) / CPU_RASTER_TILE_SIZE;
+    int tileCount = tilesX * tilesY;
+
+    std::vector<size_t> drawOffsets(1, 0); // first triangle of every draw
+    for (const auto& draw : draws)
+        drawOffsets.push_back(drawOffsets.back() + draw.indexCount / 3);
+    size_t triangleCount = drawOffsets.back();
+    int batchCount = (int)((triangleCount + CPU_RASTER_BATCH_SIZE - 1) / CPU_RASTER_BATCH_SIZE);
+    batches.resize(batchCount);
+    bins.resize(batchCount);
+    tileStats.assign(tileCount, CpuRasterStats());
+
+    // the batches are handed to the scheduler as a row of one pixel tiles
+    scheduler.forEachTile(batchCount, 1, 1, [&](int batch, int, int, int)
+    {
+        std::vector<CpuRasterTriangle>& triangles = batches[batch];
+        std::vector<std::vector<uint32_t>>& batchBins = bins[batch];
+        triangles.clear();
+        batchBins.resize(tileCount);
+        for (auto& bin : batchBins)
+            bin.clear();
+        size_t begin = (size_t)batch * CPU_RASTER_BATCH_SIZE;
+        size_t end = std::min(begin + CPU_RASTER_BATCH_SIZE, triangleCount);
+        size_t drawIndex = std::upper_bound(drawOffsets.begin(), drawOffsets.end(), begin) - drawOffsets.begin() - 1;
+        glm::mat4 mvp;
+        glm::mat3 normalMatrix;
+        size_t preparedDraw = (size_t)-1;
+        for (size_t triangle = begin; triangle < end; triangle++)
+        {
+            while (triangle >= drawOffsets[drawIndex + 1])
+                drawIndex++;
+            const CpuRasterDraw& draw = draws[drawIndex];
+            if (preparedDraw != drawIndex)
+            {
+                mvp = view.projection * view.view * draw.model;
+                normalMatrix = glm::transpose(glm::inverse(glm::mat3(draw.model)));
+                preparedDraw = drawIndex;
+            }
+            ClipVertex vertices[3];
+            for (int k = 0; k < 3; k++)
+            {
+                const Vertex& vertex = draw.vertices[draw.indices[(triangle - drawOffsets[drawIndex]) * 3 + k]];
+                vertices[k].position = mvp * glm::vec4(vertex.Position, 1.0f);
+                vertices[k].normal = glm::normalize(normalMatrix * (draw.invertedNormals ? -vertex.Normal : vertex.Normal));
+            }
+            clipTriangle(view, vertices, tilesX, triangles, batchBins);
+        }
+    });
+}
+
+void CpuRasterScene::sumTileStats()
+{
+    stats = CpuRasterStats();
+    for (const auto& triangles : batches)
+        stats.triangles += triangles.size();
+    for (const auto& tile : tileStats)
+    {
+        stats.binned += tile.binned;
+        stats.tileHiZRejects += tile.tileHiZRejects;
+        stats.blocks += tile.blocks;
+        stats.blockHiZRejects += tile.blockHiZRejects;
+    }
+}
@@ -0,0 +1,45 @@
+#ifndef CPU_AO_H
+#define CPU_AO_H
+
+#include <glm/glm.hpp>
+
+#include "tile_scheduler.h"
+
+#include <algorithm>
+#include <vector>
+
+// AO engines work on square screen tiles, small enough for the depth around a tile to stay in cache
+const int CPU_AO_TILE_SIZE = 32;
+
+// G-buffer of a frame read back from the GL path, the input of the CPU AO engines.
+// Rows are stored bottom to top like the GL textures, so pixel (x, y) has TexCoord ((x + 0.5) / width, (y + 0.5) / height).
+struct CpuGBuffer
+{
+    int width = 0;
+    int height = 0;
+    std::vector<float> linearDepth; // (view depth - near) / (far - near), gDepth linearized like the AO shaders do
+    std::vector<glm::vec3> normals; // gNormal
+
+    // fills the depth with the far plane and the normals with 0, defined in cpu_ao.cpp
+    void resize(int bufferWidth, int bufferHeight);
+
+    // texel index of a texture coordinate with GL_NEAREST filtering and GL_REPEAT wrapping (the defaults of the G-buffer textures)
+    static int wrap(int texel, int size)
+    {
+        if ((unsigned int)texel < (unsigned int)size)
+            return texel;
+        texel %= size;
+        return texel < 0 ? texel + size : texel;
+    }
+};
+
+// SIMD version of CpuGBuffer::wrap on whole float texel coordinates (exact below 2^24), NaN and
+// out of range lanes end up inside the texture so the result can always be gathered
+template <typename Float>
+Float wrapTexel(Float texel, Float size, Float invSize)
+{
+    Float wrapped = texel - floor((texel + Float(0.5f)) * invSize) * size;
+    return min(max(wrapped, Float(0.0f)), size - Float(1.0f));
+}
+
+#endif
@@ -0,0 +1,207 @@
+#ifndef CPU_DISPATCH_H
+#define CPU_DISPATCH_H
+
+#include "ao_image.h"
+#include "cpu_ao.h"
+#include "cpu_ssao.h"
+#include "cpu_hbao.h"
+#include "cpu_gtao.h"
+#include "cpu_rasterizer.h"
+#include "simd_float.h"
+#include "tile_scheduler.h"
+
+#include <string>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#endif
+
+// Instruction sets the CPU AO kernels are built for. The project is compiled for the baseline of the target
+// (SSE2 on x86-64, NEON on AArch64); ssao_kernels_sse42.cpp, ssao_kernels_avx2.cpp and ssao_kernels_avx512.cpp
+// are compiled with their own -m flags (CMakeLists.txt) and only run once cpuid reports the instruction set.
+// Inline functions outside SIMD_FLOAT_NAMESPACE that those files call would be compiled there with the wider
+// instruction set as well, and the linker keeps one copy of them for the whole program; so the kernels only call
+// such code when it is defined out of line in a baseline file (cpu_ao.cpp) or trivially inlined.
+enum class CpuISA
+{
+    SCALAR,
+    SSE2,
+    SSE42,
+    AVX2,
+    AVX512,
+    NEON
+};
+
+const CpuISA CPU_ISAS[] = { CpuISA::SCALAR, CpuISA::SSE2, CpuISA::SSE42, CpuISA::AVX2, CpuISA::AVX512, CpuISA::NEON };
+
+inline std::string getCpuISAName(CpuISA isa)
+{
+    switch (isa)
+    {
+    case CpuISA::SCALAR:
+        return "scalar";
+    case CpuISA::SSE2:
+        return "sse2";
+    case CpuISA::SSE42:
+        return "sse4.2";
+    case CpuISA::AVX2:
+        return "avx2";
+    case CpuISA::AVX512:
+        return "avx512";
+    case CpuISA::NEON:
+        return "neon";
+    }
+    return "unknown";
+}
+
+inline bool parseCpuISA(const std::string& name, CpuISA& isa)
+{
+    for (CpuISA candidate : CPU_ISAS)
+    {
+        if (getCpuISAName(candidate) == name)
+        {
+            isa = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// SIMD render entry points of the CPU AO engines and the software rasterizer compiled for one instruction set
+struct CpuAOKernels
+{
+    CpuISA isa = CpuISA::SCALAR;
+    int width = 1; // lanes per vector
+    void (*renderSSAO)(const CpuSSAOSettings& settings, const CpuGBuffer& gBuffer, AOImage& image, TileScheduler& scheduler) = nullptr;
+    void (*renderHBAO)(const CpuHBAOSettings& settings, const CpuGBuffer& gBuffer, AOImage& image, TileScheduler& scheduler) = nullptr;
+    void (*renderGTAO)(const CpuGTAOSettings& settings, const CpuGBuffer& gBuffer, AOImage& image, TileScheduler& scheduler) = nullptr;
+    void (*rasterizeGBuffer)(const CpuRasterView& view, CpuRasterScene& scene, CpuGBuffer& gBuffer, TileScheduler& scheduler) = nullptr;
+};
+
+namespace SIMD_FLOAT_NAMESPACE
+{
+// kernels of the including translation unit's instruction set, vectorized with Float
+template <typename Float>
+CpuAOKernels makeCpuAOKernels(CpuISA isa)
+{
+    CpuAOKernels kernels;
+    kernels.isa = isa;
+    kernels.width = Float::WIDTH;
+    kernels.renderSSAO = [](const CpuSSAOSettings& settings, const CpuGBuffer& gBuffer, AOImage& image, TileScheduler& scheduler)
+    {
+        CpuSSAO(settings).render<Float>(gBuffer, image, scheduler);
+    };
+    kernels.renderHBAO = [](const CpuHBAOSettings& settings, const CpuGBuffer& gBuffer, AOImage& image, TileScheduler& scheduler)
+    {
+        CpuHBAO(settings).render<Float>(gBuffer, image, scheduler);
+    };
+    kernels.renderGTAO = [](const CpuGTAOSettings& settings, const CpuGBuffer& gBuffer, AOImage& image, TileScheduler& scheduler)
+    {
+        CpuGTAO(settings).render<Float>(gBuffer, image, scheduler);
+    };
+    kernels.rasterizeGBuffer = [](const CpuRasterView& view, CpuRasterScene& scene, CpuGBuffer& gBuffer, TileScheduler& scheduler)
+    {
+        CpuRasterizer(view).render<Float>(scene, gBuffer, scheduler);
+    };
+    return kernels;
+}
+}
+
+// defined in ssao_kernels_*.cpp, nullptr when the compiler did not target the instruction set
+const CpuAOKernels* getCpuAOKernelsSSE42();
+const CpuAOKernels* getCpuAOKernelsAVX2();
+const CpuAOKernels* getCpuAOKernelsAVX512();
+
+// cpuid check, including OS support for the wider registers
+inline bool isCpuISASupported(CpuISA isa)
+{
+    if (isa == CpuISA::SCALAR)
+        return true;
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+    __builtin_cpu_init();
+    switch (isa)
+    {
+    case CpuISA::SSE2:
+        return __builtin_cpu_supports("sse2");
+    case CpuISA::SSE42:
+        return __builtin_cpu_supports("sse4.2");
+    case CpuISA::AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case CpuISA::AVX512:
+        return __builtin_cpu_supports("avx512f");
+    default:
+        return false;
+    }
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    int info[4];
+    __cpuid(info, 1);
+    bool sse42 = (info[2] & (1 << 20)) != 0;
+    bool fma = (info[2] & (1 << 12)) != 0;
+    bool osxsave = (info[2] & (1 << 27)) != 0;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    __cpuidex(info, 7, 0);
+    bool avx2 = (info[1] & (1 << 5)) != 0 && fma && (xcr0 & 0x6) == 0x6;
+    bool avx512 = (info[1] & (1 << 16)) != 0 && (xcr0 & 0xe6) == 0xe6;
+    switch (isa)
+    {
+    case CpuISA::SSE2:
+        return true;
+    case CpuISA::SSE42:
+        return sse42;
+    case CpuISA::AVX2:
+        return avx2;
+    case CpuISA::AVX512:
+        return avx512;
+    default:
+        return false;
+    }
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    return isa == CpuISA::NEON;
+#else
+    return false;
+#endif
+}
+
+// kernels of an instruction set, nullptr if they were not built or the CPU does not support them
+inline const CpuAOKernels* getCpuAOKernels(CpuISA isa)
+{
+    static const CpuAOKernels scalar = SIMD_FLOAT_NAMESPACE::makeCpuAOKernels<SIMD_FLOAT_NAMESPACE::FloatScalar>(CpuISA::SCALAR);
+#if defined(SIMD_FLOAT_SSE2) && !defined(SIMD_FLOAT_AVX2)
+    static const CpuAOKernels baseline = SIMD_FLOAT_NAMESPACE::makeCpuAOKernels<SIMD_FLOAT_NAMESPACE::Float4>(CpuISA::SSE2);
+#elif defined(SIMD_FLOAT_NEON)
+    static const CpuAOKernels baseline = SIMD_FLOAT_NAMESPACE::makeCpuAOKernels<SIMD_FLOAT_NAMESPACE::Float4>(CpuISA::NEON);
+#else
+    static const CpuAOKernels baseline = scalar;
+#endif
+    if (!isCpuISASupported(isa))
+        return nullptr;
+    switch (isa)
+    {
+    case CpuISA::SCALAR:
+        return &scalar;
+    case CpuISA::SSE2:
+    case CpuISA::NEON:
+        return baseline.isa == isa ? &baseline : nullptr;
+    case CpuISA::SSE42:
+        return getCpuAOKernelsSSE42();
+    case CpuISA::AVX2:
+        return getCpuAOKernelsAVX2();
+    case CpuISA::AVX512:
+        return getCpuAOKernelsAVX512();
+    }
+    return nullptr;
+}
+
+// widest kernels the CPU runs
+inline const CpuAOKernels* getBestCpuAOKernels()
+{
+    const CpuISA preference[] = { CpuISA::AVX512, CpuISA::AVX2, CpuISA::SSE42, CpuISA::SSE2, CpuISA::NEON };
+    for (CpuISA isa : preference)
+    {
+        if (const CpuAOKernels* kernels = getCpuAOKernels(isa))
+            return kernels;
+    }
+    return getCpuAOKernels(CpuISA::SCALAR);
+}
+
+#endif
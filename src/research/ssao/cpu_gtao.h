@@ -0,0 +1,335 @@
+#ifndef CPU_GTAO_H
+#define CPU_GTAO_H
+
+#include <glm/glm.hpp>
+
+#include "ao_image.h"
+#include "cpu_ao.h"
+#include "simd_float.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// tiles copy their depth with a halo of up to this many pixels, pixels reaching further read the whole depth buffer
+const int CPU_GTAO_MAX_HALO = 64;
+
+// uniforms and loop counts of gtao.fs
+struct CpuGTAOSettings
+{
+    glm::vec4 projInfo = glm::vec4(0.0f);
+    glm::vec4 clipInfo = glm::vec4(0.0f);
+    glm::mat4 invView = glm::mat4(1.0f);
+    glm::vec2 params = glm::vec2(0.0f); // GTAO_ROTATIONS / 360, GTAO_OFFSETS of the frame (gtao.fs only uses the offset)
+    int numDirections = 8;
+    int numSteps = 4;
+    float radius = 0.2f;
+    std::vector<glm::vec2> noise; // noiseSize x noiseSize, texNoise (direction noise, step offset) as the shader reads it
+    int noiseSize = 4;
+};
+
+namespace SIMD_FLOAT_NAMESPACE
+{
+// CPU port of gtao.fs working on the same linear depth (CpuGBuffer::linearDepth) as the shader.
+// renderNaive follows the shader pixel by pixel; render copies the depth of a screen tile and a halo sized to
+// the projected RADIUS of its nearest pixel into a compact per-thread block, so the horizon search of the whole
+// tile reads memory that stays in L2, then runs Float::WIDTH neighbouring pixels of a row in the lanes of a vector
+// with vectorized acos / cos for the horizon integration.
+class CpuGTAO
+{
+public:
+    explicit CpuGTAO(const CpuGTAOSettings& settings) : settings(settings)
+    {
+    }
+
+    void renderNaive(const CpuGBuffer& gBuffer, AOImage& image) const
+    {
+        image.resize(gBuffer.width, gBuffer.height);
+        glm::mat3 invView(settings.invView);
+        for (int y = 0; y < gBuffer.height; y++)
+        {
+            for (int x = 0; x < gBuffer.width; x++)
+            {
+                glm::vec2 fragCoord(x + 0.5f, y + 0.5f);
+                glm::vec4 vpos = getViewPosition(gBuffer, fragCoord);
+                size_t index = (size_t)y * gBuffer.width + x;
+                if (vpos.w == 1.0f)
+                {
+                    image.pixels[index] = 1.0f;
+                    continue;
+                }
+
+                glm::vec3 vdir = glm::normalize(-glm::vec3(vpos));
+                // calculation uses left handed system
+                glm::vec3 vnorm = gBuffer.normals[index] * invView;
+                vnorm.z = -vnorm.z;
+                glm::vec2 noises = getNoise(x, y);
+
+                float radius = std::max((float)settings.numSteps, settings.radius * settings.clipInfo.z / vpos.z);
+                float stepsize = radius / settings.numSteps;
+                float division = noises.y * stepsize;
+                float ao = 0.0f;
+                for (int k = 0; k < settings.numDirections; k++)
+                {
+                    float phi = k * (PI / settings.numDirections);
+                    float currstep = 1.0f + division + 0.25f * stepsize * settings.params.y;
+                    glm::vec3 dir(cosf(phi), sinf(phi), 0.0f);
+                    glm::vec2 horizons(-1.0f);
+                    for (int j = 0; j < settings.numSteps; j++)
+                    {
+                        glm::vec2 offset = glm::floor(glm::vec2(dir) * currstep + 0.5f);
+                        horizons.x = std::max(horizons.x, horizonCosine(gBuffer, fragCoord + offset, vpos, vdir));
+                        horizons.y = std::max(horizons.y, horizonCosine(gBuffer, fragCoord - offset, vpos, vdir));
+                        currstep += stepsize;
+                    }
+                    horizons = glm::acos(horizons);
+
+                    // calculate gamma
+                    glm::vec3 bitangent = glm::normalize(glm::cross(dir, vdir));
+                    glm::vec3 tangent = glm::cross(vdir, bitangent);
+                    glm::vec3 nx = vnorm - bitangent * glm::dot(vnorm, bitangent);
+                    float nnx = glm::length(nx);
+                    float invnnx = 1.0f / (nnx + 1e-6f);
+                    float cosxi = glm::dot(nx, tangent) * invnnx;
+                    float gamma = acosf(cosxi) - HALF_PI;
+                    float cosgamma = glm::dot(nx, vdir) * invnnx;
+                    float singamma2 = -2.0f * cosxi;
+
+                    // clamp to normal hemisphere
+                    horizons.x = gamma + std::max(-horizons.x - gamma, -HALF_PI);
+                    horizons.y = gamma + std::min(horizons.y - gamma, HALF_PI);
+
+                    ao += nnx * 0.25f * (
+                        (horizons.x * singamma2 + cosgamma - cosf(2.0f * horizons.x - gamma)) +
+                        (horizons.y * singamma2 + cosgamma - cosf(2.0f * horizons.y - gamma)));
+                }
+                image.pixels[index] = ao / settings.numDirections;
+            }
+        }
+    }
+
+    template <typename Float>
+    void render(const CpuGBuffer& gBuffer, AOImage& image, TileScheduler& scheduler) const
+    {
+        image.resize(gBuffer.width, gBuffer.height);
+        scheduler.forEachTile(gBuffer.width, gBuffer.height, CPU_AO_TILE_SIZE, [&](int x0, int y0, int x1, int y1)
+        {
+            thread_local DepthBlock block;
+            int halo = 0;
+            for (int y = y0; y < y1; y++)
+            {
+                for (int x = x0; x < x1; x++)
+                    halo = std::max(halo, getReach(gBuffer.linearDepth[(size_t)y * gBuffer.width + x]));
+            }
+            block.load(gBuffer, x0, y0, x1, y1, std::min(halo, CPU_GTAO_MAX_HALO));
+            for (int y = y0; y < y1; y++)
+            {
+                for (int x = x0; x < x1; x += Float::WIDTH)
+                    computePixels<Float>(gBuffer, block, x, std::min(x + Float::WIDTH, x1), y, image);
+            }
+        });
+    }
+
+private:
+    static constexpr float PI = 3.14159265f;
+    static constexpr float HALF_PI = 1.57079633f;
+    static constexpr float FALLOFF_START2 = 0.01f;
+    static constexpr float FALLOFF_END2 = 0.5f;
+
+    // linear depth of a tile and its halo, rows wrapped like the GL_REPEAT texture
+    struct DepthBlock
+    {
+        int originX = 0;
+        int originY = 0;
+        int width = 0;
+        int height = 0;
+        int halo = 0;
+        float depth[(CPU_AO_TILE_SIZE + 2 * CPU_GTAO_MAX_HALO) * (CPU_AO_TILE_SIZE + 2 * CPU_GTAO_MAX_HALO)];
+
+        void load(const CpuGBuffer& gBuffer, int x0, int y0, int x1, int y1, int tileHalo)
+        {
+            halo = tileHalo;
+            originX = x0 - halo;
+            originY = y0 - halo;
+            width = x1 - x0 + 2 * halo;
+            height = y1 - y0 + 2 * halo;
+            for (int y = 0; y < height; y++)
+            {
+                const float* row = &gBuffer.linearDepth[(size_t)CpuGBuffer::wrap(originY + y, gBuffer.height) * gBuffer.width];
+                float* blockRow = &depth[(size_t)y * width];
+                if (originX >= 0 && originX + width <= gBuffer.width)
+                    std::copy(row + originX, row + originX + width, blockRow);
+                else
+                {
+                    for (int x = 0; x < width; x++)
+                        blockRow[x] = row[CpuGBuffer::wrap(originX + x, gBuffer.width)];
+                }
+            }
+        }
+    };
+
+    // referenced, not copied: engines only live for one render call
+    const CpuGTAOSettings& settings;
+
+    glm::vec4 getViewPosition(const CpuGBuffer& gBuffer, const glm::vec2& uv) const
+    {
+        int x = CpuGBuffer::wrap((int)floorf(uv.x), gBuffer.width);
+        int y = CpuGBuffer::wrap((int)floorf(uv.y), gBuffer.height);
+        float d = gBuffer.linearDepth[(size_t)y * gBuffer.width + x];
+        float z = settings.clipInfo.x + d * (settings.clipInfo.y - settings.clipInfo.x);
+        glm::vec2 xy = (uv * glm::vec2(settings.projInfo) + glm::vec2(settings.projInfo.z, settings.projInfo.w)) * z;
+        return glm::vec4(xy, z, d);
+    }
+
+    glm::vec2 getNoise(int x, int y) const
+    {
+        return settings.noise[(y % settings.noiseSize) * settings.noiseSize + x % settings.noiseSize];
+    }
+
+    // cos of the horizon angle of one sample minus its falloff
+    float horizonCosine(const CpuGBuffer& gBuffer, const glm::vec2& uv, const glm::vec4& vpos, const glm::vec3& vdir) const
+    {
+        glm::vec3 ws = glm::vec3(getViewPosition(gBuffer, uv)) - glm::vec3(vpos);
+        float dist2 = glm::dot(ws, ws);
+        float cosh = glm::dot(ws, vdir) / sqrtf(dist2);
+        float falloff = 2.0f * glm::clamp((dist2 - FALLOFF_START2) / (FALLOFF_END2 - FALLOFF_START2), 0.0f, 1.0f);
+        return cosh - falloff;
+    }
+
+    // farthest texel offset (in pixels, either axis) the horizon search of a pixel at linear depth d can reach
+    int getReach(float d) const
+    {
+        float z = settings.clipInfo.x + d * (settings.clipInfo.y - settings.clipInfo.x);
+        float radius = std::max((float)settings.numSteps, settings.radius * settings.clipInfo.z / z);
+        float stepsize = radius / settings.numSteps;
+        // currstep of the last step with the largest noise, rounded up
+        float reach = 1.0f + stepsize * (settings.numSteps + 0.25f * settings.params.y) + 0.5f;
+        return reach < (float)(1 << 20) ? (int)reach + 1 : (1 << 20);
+    }
+
+    // view space position of the texels (texelX, texelY), the texels are inside the block or wrapped into the whole buffer
+    template <typename Float>
+    void getViewPosition(const CpuGBuffer& gBuffer, const DepthBlock& block, bool inBlock, Float texelX, Float texelY,
+        Float& outX, Float& outY, Float& outZ) const
+    {
+        Float d;
+        if (inBlock)
+            d = Float::gather(block.depth, (texelY - Float((float)block.originY)) * Float((float)block.width) + texelX - Float((float)block.originX));
+        else
+        {
+            Float width((float)gBuffer.width), height((float)gBuffer.height);
+            Float wrappedX = wrapTexel(texelX, width, Float(1.0f / gBuffer.width));
+            Float wrappedY = wrapTexel(texelY, height, Float(1.0f / gBuffer.height));
+            d = Float::gather(gBuffer.linearDepth.data(), wrappedY * width + wrappedX);
+        }
+        Float half(0.5f);
+        outZ = Float(settings.clipInfo.x) + d * Float(settings.clipInfo.y - settings.clipInfo.x);
+        outX = ((texelX + half) * Float(settings.projInfo.x) + Float(settings.projInfo.z)) * outZ;
+        outY = ((texelY + half) * Float(settings.projInfo.y) + Float(settings.projInfo.w)) * outZ;
+    }
+
+    // pixels x0..x1-1 of row y, lanes past x1 repeat the last pixel and are not stored
+    template <typename Float>
+    void computePixels(const CpuGBuffer& gBuffer, const DepthBlock& block, int x0, int x1, int y, AOImage& image) const
+    {
+        const int W = Float::WIDTH;
+        glm::mat3 invView(settings.invView);
+        float laneX[W], normalX[W], normalY[W], normalZ[W], noiseY[W];
+        int reach = 0;
+        for (int l = 0; l < W; l++)
+        {
+            int x = std::min(x0 + l, x1 - 1);
+            size_t index = (size_t)y * gBuffer.width + x;
+            // calculation uses left handed system
+            glm::vec3 vnorm = gBuffer.normals[index] * invView;
+            laneX[l] = (float)x;
+            normalX[l] = vnorm.x;
+            normalY[l] = vnorm.y;
+            normalZ[l] = -vnorm.z;
+            noiseY[l] = getNoise(x, y).y;
+            reach = std::max(reach, getReach(gBuffer.linearDepth[index]));
+        }
+        bool inBlock = reach <= block.halo;
+
+        Float zero(0.0f), one(1.0f), half(0.5f), halfPi(HALF_PI);
+        Float pixelX = Float::load(laneX), pixelY((float)y);
+        Float px, py, pz;
+        getViewPosition(gBuffer, block, true, pixelX, pixelY, px, py, pz);
+        Float d = Float::gather(block.depth, (pixelY - Float((float)block.originY)) * Float((float)block.width) + pixelX - Float((float)block.originX));
+        Float farPlane = (d >= one) & (d <= one);
+
+        Float invLength = one / sqrt(px * px + py * py + pz * pz);
+        Float vdirX = (zero - px) * invLength, vdirY = (zero - py) * invLength, vdirZ = (zero - pz) * invLength;
+        Float vnormX = Float::load(normalX), vnormY = Float::load(normalY), vnormZ = Float::load(normalZ);
+
+        Float numSteps((float)settings.numSteps);
+        Float radius = max(Float(settings.radius * settings.clipInfo.z) / pz, numSteps);
+        Float stepsize = radius / numSteps;
+        Float firstStep = one + Float::load(noiseY) * stepsize + Float(0.25f * settings.params.y) * stepsize;
+        Float falloffScale(2.0f / (FALLOFF_END2 - FALLOFF_START2)), falloffStart(FALLOFF_START2), two(2.0f);
+
+        // cos of the horizon angle of the sample at (pixel + offset) minus its falloff
+        auto horizonCosine = [&](Float offsetX, Float offsetY)
+        {
+            Float sx, sy, sz;
+            getViewPosition(gBuffer, block, inBlock, pixelX + offsetX, pixelY + offsetY, sx, sy, sz);
+            Float wsX = sx - px, wsY = sy - py, wsZ = sz - pz;
+            Float dist2 = wsX * wsX + wsY * wsY + wsZ * wsZ;
+            Float cosh = (wsX * vdirX + wsY * vdirY + wsZ * vdirZ) / sqrt(dist2);
+            Float falloff = min(max((dist2 - falloffStart) * falloffScale, zero), two);
+            return cosh - falloff;
+        };
+
+        Float ao(0.0f);
+        for (int k = 0; k < settings.numDirections; k++)
+        {
+            float phi = k * (PI / settings.numDirections);
+            Float dirX(cosf(phi)), dirY(sinf(phi));
+            Float currstep = firstStep;
+            Float horizonX(-1.0f), horizonY(-1.0f);
+            for (int j = 0; j < settings.numSteps; j++)
+            {
+                Float offsetX = floor(dirX * currstep + half), offsetY = floor(dirY * currstep + half);
+                // NaN lanes keep the current horizon
+                horizonX = max(horizonCosine(offsetX, offsetY), horizonX);
+                horizonY = max(horizonCosine(zero - offsetX, zero - offsetY), horizonY);
+                currstep = currstep + stepsize;
+            }
+            horizonX = acosApprox(horizonX);
+            horizonY = acosApprox(horizonY);
+
+            // calculate gamma, bitangent = normalize(cross(dir, vdir)) with dir.z = 0
+            Float bX = dirY * vdirZ, bY = zero - dirX * vdirZ, bZ = dirX * vdirY - dirY * vdirX;
+            Float invB = one / sqrt(bX * bX + bY * bY + bZ * bZ);
+            bX = bX * invB;
+            bY = bY * invB;
+            bZ = bZ * invB;
+            Float tX = vdirY * bZ - vdirZ * bY, tY = vdirZ * bX - vdirX * bZ, tZ = vdirX * bY - vdirY * bX;
+            Float nDotB = vnormX * bX + vnormY * bY + vnormZ * bZ;
+            Float nxX = vnormX - bX * nDotB, nxY = vnormY - bY * nDotB, nxZ = vnormZ - bZ * nDotB;
+            Float nnx = sqrt(nxX * nxX + nxY * nxY + nxZ * nxZ);
+            Float invnnx = one / (nnx + Float(1e-6f));
+            Float cosxi = (nxX * tX + nxY * tY + nxZ * tZ) * invnnx;
+            Float gamma = acosApprox(cosxi) - halfPi;
+            Float cosgamma = (nxX * vdirX + nxY * vdirY + nxZ * vdirZ) * invnnx;
+            Float singamma2 = Float(-2.0f) * cosxi;
+
+            // clamp to normal hemisphere
+            horizonX = gamma + max(zero - horizonX - gamma, zero - halfPi);
+            horizonY = gamma + min(horizonY - gamma, halfPi);
+
+            ao = ao + nnx * Float(0.25f) * (
+                (horizonX * singamma2 + cosgamma - cosApprox(two * horizonX - gamma)) +
+                (horizonY * singamma2 + cosgamma - cosApprox(two * horizonY - gamma)));
+        }
+        ao = select(farPlane, one, ao / Float((float)settings.numDirections));
+
+        float result[W];
+        ao.store(result);
+        for (int x = x0; x < x1; x++)
+            image.pixels[(size_t)y * gBuffer.width + x] = result[x - x0];
+    }
+};
+}
+
+#endif
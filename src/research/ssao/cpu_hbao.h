@@ -0,0 +1,304 @@
+#ifndef CPU_HBAO_H
+#define CPU_HBAO_H
+
+#include <glm/glm.hpp>
+
+#include "ao_image.h"
+#include "cpu_ao.h"
+#include "simd_float.h"
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+// uniforms and loop counts of hbao.fs
+struct CpuHBAOSettings
+{
+    glm::vec2 focalLen = glm::vec2(1.0f);
+    glm::vec2 uvToViewA = glm::vec2(0.0f);
+    glm::vec2 uvToViewB = glm::vec2(0.0f);
+    glm::vec2 clipPlanes = glm::vec2(0.1f, 50.0f); // near and far plane of the linear depth
+    float radius = 0.3f;
+    float maxRadiusPixels = 100.0f;
+    float strength = 1.9f;
+    float tanBias = tanf(30.0f * 3.14159265f / 180.0f);
+    int numDirections = 8;
+    int numSteps = 4;
+    std::vector<glm::vec4> noise; // noiseSize x noiseSize, texNoise (rotation cos/sin, step jitter)
+    int noiseSize = 4;
+};
+
+namespace SIMD_FLOAT_NAMESPACE
+{
+// CPU port of hbao.fs working on the same linear depth as the shader.
+// renderNaive follows the shader pixel by pixel; render runs Float::WIDTH neighbouring pixels of a row
+// in the lanes of a vector, every lane with its own step count (the horizon loop runs until the
+// longest lane is done, finished lanes are masked out), and spreads screen tiles over the threads of a TileScheduler.
+class CpuHBAO
+{
+public:
+    explicit CpuHBAO(const CpuHBAOSettings& settings) : settings(settings)
+    {
+    }
+
+    void renderNaive(const CpuGBuffer& gBuffer, AOImage& image) const
+    {
+        image.resize(gBuffer.width, gBuffer.height);
+        glm::vec2 aoRes(gBuffer.width, gBuffer.height);
+        glm::vec2 invAORes = 1.0f / aoRes;
+        float r2 = settings.radius * settings.radius;
+        float negInvR2 = -1.0f / r2;
+        for (int y = 0; y < gBuffer.height; y++)
+        {
+            for (int x = 0; x < gBuffer.width; x++)
+            {
+                glm::vec2 texCoord((x + 0.5f) / gBuffer.width, (y + 0.5f) / gBuffer.height);
+                glm::vec3 P = getViewPos(gBuffer, texCoord);
+                glm::vec3 Pr = getViewPos(gBuffer, texCoord + glm::vec2(invAORes.x, 0.0f));
+                glm::vec3 Pl = getViewPos(gBuffer, texCoord + glm::vec2(-invAORes.x, 0.0f));
+                glm::vec3 Pt = getViewPos(gBuffer, texCoord + glm::vec2(0.0f, invAORes.y));
+                glm::vec3 Pb = getViewPos(gBuffer, texCoord + glm::vec2(0.0f, -invAORes.y));
+                glm::vec3 dPdu = minDiff(P, Pr, Pl);
+                glm::vec3 dPdv = minDiff(P, Pt, Pb) * (aoRes.y * invAORes.x);
+                glm::vec4 random = getNoise(x, y);
+
+                float rayRadiusPix = 0.5f * settings.radius * settings.focalLen.x / -P.z * aoRes.x;
+                float ao = 1.0f;
+                if (rayRadiusPix > 1.0f)
+                {
+                    // ComputeSteps
+                    float numSteps = std::min((float)settings.numSteps, rayRadiusPix);
+                    float stepSizePix = rayRadiusPix / (numSteps + 1.0f);
+                    float maxNumSteps = settings.maxRadiusPixels / stepSizePix;
+                    if (maxNumSteps < numSteps)
+                    {
+                        numSteps = std::max(floorf(maxNumSteps + random.z), 1.0f);
+                        stepSizePix = settings.maxRadiusPixels / numSteps;
+                    }
+                    glm::vec2 stepSizeUV = stepSizePix * invAORes;
+
+                    ao = 0.0f;
+                    float alpha = 2.0f * PI / settings.numDirections;
+                    for (int d = 0; d < settings.numDirections; d++)
+                    {
+                        float theta = alpha * d;
+                        glm::vec2 dir(cosf(theta) * random.x - sinf(theta) * random.y, cosf(theta) * random.y + sinf(theta) * random.x);
+                        glm::vec2 deltaUV = dir * stepSizeUV;
+
+                        // HorizonOcclusion
+                        glm::vec2 uv = texCoord + snapUVOffset(random.z * deltaUV, aoRes, invAORes);
+                        deltaUV = snapUVOffset(deltaUV, aoRes, invAORes);
+                        glm::vec3 T = deltaUV.x * dPdu + deltaUV.y * dPdv;
+                        float tanH = T.z / sqrtf(glm::dot(glm::vec2(T), glm::vec2(T))) + settings.tanBias;
+                        float sinH = tanToSin(tanH);
+                        for (float s = 1.0f; s <= numSteps; ++s)
+                        {
+                            uv += deltaUV;
+                            glm::vec3 S = getViewPos(gBuffer, uv);
+                            glm::vec2 toSample = glm::vec2(S) - glm::vec2(P);
+                            float tanS = -(P.z - S.z) / sqrtf(glm::dot(toSample, toSample));
+                            float d2 = glm::dot(S - P, S - P);
+                            if (d2 < r2 && tanS > tanH)
+                            {
+                                float sinS = tanToSin(tanS);
+                                ao += (d2 * negInvR2 + 1.0f) * (sinS - sinH);
+                                tanH = tanS;
+                                sinH = sinS;
+                            }
+                        }
+                    }
+                    ao = 1.0f - ao / settings.numDirections * settings.strength;
+                }
+                image.pixels[(size_t)y * gBuffer.width + x] = ao;
+            }
+        }
+    }
+
+    template <typename Float>
+    void render(const CpuGBuffer& gBuffer, AOImage& image, TileScheduler& scheduler) const
+    {
+        image.resize(gBuffer.width, gBuffer.height);
+        scheduler.forEachTile(gBuffer.width, gBuffer.height, CPU_AO_TILE_SIZE, [&](int x0, int y0, int x1, int y1)
+        {
+            for (int y = y0; y < y1; y++)
+            {
+                for (int x = x0; x < x1; x += Float::WIDTH)
+                    computePixels<Float>(gBuffer, x, std::min(x + Float::WIDTH, x1), y, image);
+            }
+        });
+    }
+
+private:
+    static constexpr float PI = 3.14159265f;
+
+    // referenced, not copied: engines only live for one render call
+    const CpuHBAOSettings& settings;
+
+    float viewSpaceZ(float linearDepth) const
+    {
+        return -(settings.clipPlanes.x + linearDepth * (settings.clipPlanes.y - settings.clipPlanes.x));
+    }
+
+    glm::vec3 getViewPos(const CpuGBuffer& gBuffer, const glm::vec2& uv) const
+    {
+        int x = CpuGBuffer::wrap((int)floorf(uv.x * gBuffer.width), gBuffer.width);
+        int y = CpuGBuffer::wrap((int)floorf(uv.y * gBuffer.height), gBuffer.height);
+        float z = viewSpaceZ(gBuffer.linearDepth[(size_t)y * gBuffer.width + x]);
+        glm::vec2 viewUV = settings.uvToViewA * uv + settings.uvToViewB;
+        return glm::vec3(viewUV * z, z);
+    }
+
+    glm::vec4 getNoise(int x, int y) const
+    {
+        return settings.noise[(y % settings.noiseSize) * settings.noiseSize + x % settings.noiseSize];
+    }
+
+    static glm::vec3 minDiff(const glm::vec3& P, const glm::vec3& Pr, const glm::vec3& Pl)
+    {
+        glm::vec3 V1 = Pr - P;
+        glm::vec3 V2 = P - Pl;
+        return glm::dot(V1, V1) < glm::dot(V2, V2) ? V1 : V2;
+    }
+
+    static glm::vec2 snapUVOffset(const glm::vec2& uv, const glm::vec2& aoRes, const glm::vec2& invAORes)
+    {
+        return glm::floor(uv * aoRes + 0.5f) * invAORes;
+    }
+
+    static float tanToSin(float x)
+    {
+        return x / sqrtf(x * x + 1.0f);
+    }
+
+    // view space position of a vector of texture coordinates
+    template <typename Float>
+    void getViewPos(const CpuGBuffer& gBuffer, Float u, Float v, Float& outX, Float& outY, Float& outZ) const
+    {
+        Float width((float)gBuffer.width), height((float)gBuffer.height);
+        Float texelX = wrapTexel(floor(u * width), width, Float(1.0f / gBuffer.width));
+        Float texelY = wrapTexel(floor(v * height), height, Float(1.0f / gBuffer.height));
+        Float d = Float::gather(gBuffer.linearDepth.data(), texelY * width + texelX);
+        outZ = Float(-settings.clipPlanes.x) + d * Float(settings.clipPlanes.x - settings.clipPlanes.y);
+        outX = (Float(settings.uvToViewA.x) * u + Float(settings.uvToViewB.x)) * outZ;
+        outY = (Float(settings.uvToViewA.y) * v + Float(settings.uvToViewB.y)) * outZ;
+    }
+
+    template <typename Float>
+    static void minDiff(Float px, Float py, Float pz, Float rx, Float ry, Float rz, Float lx, Float ly, Float lz,
+        Float& outX, Float& outY, Float& outZ)
+    {
+        Float v1x = rx - px, v1y = ry - py, v1z = rz - pz;
+        Float v2x = px - lx, v2y = py - ly, v2z = pz - lz;
+        Float useV1 = v1x * v1x + v1y * v1y + v1z * v1z < v2x * v2x + v2y * v2y + v2z * v2z;
+        outX = select(useV1, v1x, v2x);
+        outY = select(useV1, v1y, v2y);
+        outZ = select(useV1, v1z, v2z);
+    }
+
+    template <typename Float>
+    static Float tanToSin(Float x)
+    {
+        return x / sqrt(x * x + Float(1.0f));
+    }
+
+    // pixels x0..x1-1 of row y, lanes past x1 repeat the last pixel and are not stored
+    template <typename Float>
+    void computePixels(const CpuGBuffer& gBuffer, int x0, int x1, int y, AOImage& image) const
+    {
+        const int W = Float::WIDTH;
+        float laneX[W], noiseX[W], noiseY[W], noiseZ[W];
+        for (int l = 0; l < W; l++)
+        {
+            int x = std::min(x0 + l, x1 - 1);
+            glm::vec4 random = getNoise(x, y);
+            laneX[l] = (float)x;
+            noiseX[l] = random.x;
+            noiseY[l] = random.y;
+            noiseZ[l] = random.z;
+        }
+        Float one(1.0f), zero(0.0f), half(0.5f);
+        Float aoResX((float)gBuffer.width), aoResY((float)gBuffer.height);
+        Float invAOResX(1.0f / gBuffer.width), invAOResY(1.0f / gBuffer.height);
+        Float r2(settings.radius * settings.radius), negInvR2(-1.0f / (settings.radius * settings.radius));
+        Float randomX = Float::load(noiseX), randomY = Float::load(noiseY), randomZ = Float::load(noiseZ);
+
+        Float u = (Float::load(laneX) + half) / aoResX;
+        Float v((y + 0.5f) / gBuffer.height);
+        Float px, py, pz, rx, ry, rz, lx, ly, lz, tx, ty, tz, bx, by, bz;
+        getViewPos(gBuffer, u, v, px, py, pz);
+        getViewPos(gBuffer, u + invAOResX, v, rx, ry, rz);
+        getViewPos(gBuffer, u - invAOResX, v, lx, ly, lz);
+        getViewPos(gBuffer, u, v + invAOResY, tx, ty, tz);
+        getViewPos(gBuffer, u, v - invAOResY, bx, by, bz);
+        Float dPduX, dPduY, dPduZ, dPdvX, dPdvY, dPdvZ;
+        minDiff(px, py, pz, rx, ry, rz, lx, ly, lz, dPduX, dPduY, dPduZ);
+        minDiff(px, py, pz, tx, ty, tz, bx, by, bz, dPdvX, dPdvY, dPdvZ);
+        Float aspect(gBuffer.height * (1.0f / gBuffer.width));
+        dPdvX = dPdvX * aspect;
+        dPdvY = dPdvY * aspect;
+        dPdvZ = dPdvZ * aspect;
+
+        // ComputeSteps, per lane
+        Float rayRadiusPix = Float(0.5f * settings.radius * settings.focalLen.x) / (zero - pz) * aoResX;
+        Float maxRadiusPixels(settings.maxRadiusPixels);
+        Float numSteps = min(Float((float)settings.numSteps), rayRadiusPix);
+        Float stepSizePix = rayRadiusPix / (numSteps + one);
+        Float maxNumSteps = maxRadiusPixels / stepSizePix;
+        Float clampSteps = maxNumSteps < numSteps;
+        numSteps = select(clampSteps, max(floor(maxNumSteps + randomZ), one), numSteps);
+        stepSizePix = select(clampSteps, maxRadiusPixels / numSteps, stepSizePix);
+        Float stepSizeU = stepSizePix * invAOResX, stepSizeV = stepSizePix * invAOResY;
+        // lanes with a hemisphere smaller than a pixel keep ao = 1 and take no steps
+        Float covered = rayRadiusPix > one;
+        numSteps = ifThen(covered, numSteps);
+        float laneSteps[W];
+        numSteps.store(laneSteps);
+        float maxSteps = *std::max_element(laneSteps, laneSteps + W);
+
+        Float ao(0.0f);
+        Float tanBias(settings.tanBias);
+        float alpha = 2.0f * PI / settings.numDirections;
+        for (int d = 0; d < settings.numDirections; d++)
+        {
+            float theta = alpha * d;
+            Float cosTheta(cosf(theta)), sinTheta(sinf(theta));
+            Float deltaU = (cosTheta * randomX - sinTheta * randomY) * stepSizeU;
+            Float deltaV = (cosTheta * randomY + sinTheta * randomX) * stepSizeV;
+
+            // HorizonOcclusion
+            Float sampleU = u + floor(randomZ * deltaU * aoResX + half) * invAOResX;
+            Float sampleV = v + floor(randomZ * deltaV * aoResY + half) * invAOResY;
+            deltaU = floor(deltaU * aoResX + half) * invAOResX;
+            deltaV = floor(deltaV * aoResY + half) * invAOResY;
+            Float tX = deltaU * dPduX + deltaV * dPdvX;
+            Float tY = deltaU * dPduY + deltaV * dPdvY;
+            Float tZ = deltaU * dPduZ + deltaV * dPdvZ;
+            Float tanH = tZ / sqrt(tX * tX + tY * tY) + tanBias;
+            Float sinH = tanToSin(tanH);
+            for (float s = 1.0f; s <= maxSteps; ++s)
+            {
+                sampleU = sampleU + deltaU;
+                sampleV = sampleV + deltaV;
+                Float sx, sy, sz;
+                getViewPos(gBuffer, sampleU, sampleV, sx, sy, sz);
+                Float toSampleX = sx - px, toSampleY = sy - py, toSampleZ = sz - pz;
+                Float tanS = (zero - (pz - sz)) / sqrt(toSampleX * toSampleX + toSampleY * toSampleY);
+                Float d2 = toSampleX * toSampleX + toSampleY * toSampleY + toSampleZ * toSampleZ;
+                Float higher = (Float(s) <= numSteps) & (d2 < r2) & (tanS > tanH);
+                Float sinS = tanToSin(tanS);
+                ao = ao + ifThen(higher, (d2 * negInvR2 + one) * (sinS - sinH));
+                tanH = select(higher, tanS, tanH);
+                sinH = select(higher, sinS, sinH);
+            }
+        }
+        ao = select(covered, one - ao / Float((float)settings.numDirections) * Float(settings.strength), one);
+
+        float result[W];
+        ao.store(result);
+        for (int x = x0; x < x1; x++)
+            image.pixels[(size_t)y * gBuffer.width + x] = result[x - x0];
+    }
+};
+}
+
+#endif
@@ -0,0 +1,345 @@
+#ifndef CPU_RASTERIZER_H
+#define CPU_RASTERIZER_H
+
+#include <glm/glm.hpp>
+
+#include <learnopengl/mesh.h>
+
+#include "cpu_ao.h"
+#include "simd_float.h"
+#include "tile_scheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// triangles are binned into screen tiles of this size, a tile is rasterized by one thread
+const int CPU_RASTER_TILE_SIZE = 64;
+// hierarchical-Z blocks inside a tile, the block width is a multiple of every vector width
+const int CPU_RASTER_BLOCK_WIDTH = 16;
+const int CPU_RASTER_BLOCK_HEIGHT = 8;
+// triangles set up and binned by one thread, batches keep the draw order when the tiles replay them
+const int CPU_RASTER_BATCH_SIZE = 4096;
+// x and y clip planes at this multiple of w, triangles crossing only the frustum sides are not clipped
+const float CPU_RASTER_GUARD_BAND = 2.0f;
+// vertices are snapped to 1/256 pixel, as GL rasterizers do with 8 bits of subpixel precision
+const float CPU_RASTER_SUBPIXELS = 256.0f;
+
+// one renderModel / renderCube call of the geometry pass
+struct CpuRasterDraw
+{
+    const Vertex* vertices = nullptr;
+    const unsigned int* indices = nullptr;
+    size_t indexCount = 0;
+    glm::mat4 model = glm::mat4(1.0f);
+    bool invertedNormals = false;
+};
+
+// camera of the geometry pass and the size of the G-buffer
+struct CpuRasterView
+{
+    glm::mat4 view = glm::mat4(1.0f);
+    glm::mat4 projection = glm::mat4(1.0f);
+    float nearPlane = 0.1f;
+    float farPlane = 50.0f;
+    int width = 0;
+    int height = 0;
+};
+
+// counters of the last frame
+struct CpuRasterStats
+{
+    size_t triangles = 0;       // set up after clipping and culling of degenerate / off screen triangles
+    size_t binned = 0;          // triangle-tile pairs
+    size_t tileHiZRejects = 0;  // triangle-tile pairs behind everything drawn into the tile so far
+    size_t blocks = 0;          // triangle-block pairs touched by the edge functions
+    size_t blockHiZRejects = 0; // triangle-block pairs behind everything drawn into the block so far
+};
+
+// value = a * x + b * y + c, x and y relative to the first vertex of the triangle
+struct CpuRasterPlane
+{
+    float a, b, c;
+};
+
+// screen space triangle: edge functions (positive inside) and the attribute planes of geometry.fs
+struct CpuRasterTriangle
+{
+    CpuRasterPlane edges[3];
+    CpuRasterPlane depth;     // window depth
+    CpuRasterPlane invW;      // 1 / w, for perspective correct attributes
+    CpuRasterPlane normal[3]; // world space normal / w
+    bool inclusive[3];        // top-left fill rule, pixel centers on the edge are covered
+    float originX, originY;   // first vertex, snapped
+    float minDepth;           // nearest point, for the hierarchical-Z reject
+    int minX, minY, maxX, maxY;
+};
+
+// Meshes of the geometry pass with their transforms. The vertex and index vectors are referenced, not copied,
+// so they have to outlive the scene. The scene also keeps the triangles and tile bins of the last frame to reuse their memory.
+class CpuRasterScene
+{
+public:
+    void addMesh(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices, const glm::mat4& model, bool invertedNormals)
+    {
+        CpuRasterDraw draw;
+        draw.vertices = vertices.data();
+        draw.indices = indices.data();
+        draw.indexCount = indices.size() - indices.size() % 3;
+        draw.model = model;
+        draw.invertedNormals = invertedNormals;
+        draws.push_back(draw);
+    }
+
+    size_t getTriangleCount() const
+    {
+        size_t count = 0;
+        for (const auto& draw : draws)
+            count += draw.indexCount / 3;
+        return count;
+    }
+
+    const CpuRasterStats& getStats() const { return stats; }
+
+    // transforms, clips and sets up the triangles of CPU_RASTER_BATCH_SIZE batches in parallel and bins them into
+    // screen tiles; scalar code, defined in cpu_ao.cpp so it is only compiled for the baseline instruction set
+    void setup(const CpuRasterView& view, TileScheduler& scheduler);
+    // adds the counters of the tiles up into stats
+    void sumTileStats();
+
+    std::vector<CpuRasterDraw> draws;
+
+    // per frame state of the rasterizer
+    std::vector<std::vector<CpuRasterTriangle>> batches;     // triangles of every batch
+    std::vector<std::vector<std::vector<uint32_t>>> bins;    // [batch][tile], indices into the batch's triangles
+    std::vector<CpuRasterStats> tileStats;
+    CpuRasterStats stats;
+};
+
+namespace SIMD_FLOAT_NAMESPACE
+{
+// Tile-binned software rasterizer producing the gNormal target of geometry.vs / geometry.fs and the linear depth
+// the AO passes derive from its depth buffer (interpolated directly, the window depth stays in the tile).
+// CpuRasterScene::setup bins the triangles into screen tiles; every tile then replays its bins in draw order on
+// its own thread, in a tile sized depth and attribute buffer.
+// Edge functions and attributes are evaluated for Float::WIDTH pixels of a row at once, and blocks of the tile
+// whose farthest depth is nearer than the triangle are skipped without touching the edge functions (hierarchical Z).
+class CpuRasterizer
+{
+public:
+    explicit CpuRasterizer(const CpuRasterView& view) : view(view)
+    {
+    }
+
+    template <typename Float>
+    void render(CpuRasterScene& scene, CpuGBuffer& gBuffer, TileScheduler& scheduler) const
+    {
+        if (gBuffer.width != view.width || gBuffer.height != view.height)
+            gBuffer.resize(view.width, view.height);
+        scene.setup(view, scheduler);
+
+        int tilesX = (view.width + CPU_RASTER_TILE_SIZE - 1) / CPU_RASTER_TILE_SIZE;
+        scheduler.forEachTile(view.width, view.height, CPU_RASTER_TILE_SIZE, [&](int x0, int y0, int x1, int y1)
+        {
+            int tile = (y0 / CPU_RASTER_TILE_SIZE) * tilesX + x0 / CPU_RASTER_TILE_SIZE;
+            rasterizeTile<Float>(scene, tile, x0, y0, x1, y1, gBuffer, scene.tileStats[tile]);
+        });
+        scene.sumTileStats();
+    }
+
+private:
+    static const int BLOCKS_X = CPU_RASTER_TILE_SIZE / CPU_RASTER_BLOCK_WIDTH;
+    static const int BLOCKS_Y = CPU_RASTER_TILE_SIZE / CPU_RASTER_BLOCK_HEIGHT;
+
+    // depth and attributes of one tile, rows bottom to top like the G-buffer
+    struct TileBuffer
+    {
+        float depth[CPU_RASTER_TILE_SIZE * CPU_RASTER_TILE_SIZE];
+        float linearDepth[CPU_RASTER_TILE_SIZE * CPU_RASTER_TILE_SIZE];
+        float normal[3][CPU_RASTER_TILE_SIZE * CPU_RASTER_TILE_SIZE];
+        float blockMaxDepth[BLOCKS_X * BLOCKS_Y];
+        bool blockDirty[BLOCKS_X * BLOCKS_Y]; // written since blockMaxDepth was computed
+    };
+
+    CpuRasterView view;
+
+    template <typename Float>
+    static float getBlockMaxDepth(const TileBuffer& buffer, int block)
+    {
+        const int W = Float::WIDTH;
+        int bx = (block % BLOCKS_X) * CPU_RASTER_BLOCK_WIDTH, by = (block / BLOCKS_X) * CPU_RASTER_BLOCK_HEIGHT;
+        Float maxDepth(0.0f);
+        for (int y = by; y < by + CPU_RASTER_BLOCK_HEIGHT; y++)
+        {
+            for (int x = bx; x < bx + CPU_RASTER_BLOCK_WIDTH; x += W)
+                maxDepth = max(maxDepth, Float::load(buffer.depth + y * CPU_RASTER_TILE_SIZE + x));
+        }
+        float lanes[W];
+        maxDepth.store(lanes);
+        return *std::max_element(lanes, lanes + W);
+    }
+
+    // value of a plane at the center of the tile's bottom left pixel
+    static float getTilePlaneBase(const CpuRasterPlane& plane, const CpuRasterTriangle& triangle, int x0, int y0)
+    {
+        return plane.a * (x0 + 0.5f - triangle.originX) + plane.b * (y0 + 0.5f - triangle.originY) + plane.c;
+    }
+
+    template <typename Float>
+    void rasterizeTile(const CpuRasterScene& scene, int tile, int x0, int y0, int x1, int y1, CpuGBuffer& gBuffer, CpuRasterStats& stats) const
+    {
+        const int W = Float::WIDTH;
+        const int T = CPU_RASTER_TILE_SIZE;
+        thread_local TileBuffer buffer;
+        std::fill(std::begin(buffer.depth), std::end(buffer.depth), 1.0f);
+        std::fill(std::begin(buffer.linearDepth), std::end(buffer.linearDepth), 1.0f);
+        for (auto& channel : buffer.normal)
+            std::fill(std::begin(channel), std::end(channel), 0.0f);
+        std::fill(std::begin(buffer.blockMaxDepth), std::end(buffer.blockMaxDepth), 1.0f);
+        std::fill(std::begin(buffer.blockDirty), std::end(buffer.blockDirty), false);
+        float tileMaxDepth = 1.0f;
+        bool tileDirty = false;
+
+        float laneOffsets[W];
+        for (int l = 0; l < W; l++)
+            laneOffsets[l] = (float)l;
+        Float laneX = Float::load(laneOffsets), zero(0.0f), one(1.0f);
+        Float nearPlane(view.nearPlane), invDepthRange(1.0f / (view.farPlane - view.nearPlane));
+
+        for (size_t batch = 0; batch < scene.batches.size(); batch++)
+        {
+            const std::vector<CpuRasterTriangle>& triangles = scene.batches[batch];
+            for (uint32_t index : scene.bins[batch][tile])
+            {
+                const CpuRasterTriangle& triangle = triangles[index];
+                stats.binned++;
+                if (tileDirty)
+                {
+                    tileMaxDepth = 0.0f;
+                    for (int block = 0; block < BLOCKS_X * BLOCKS_Y; block++)
+                    {
+                        if (buffer.blockDirty[block])
+                        {
+                            buffer.blockMaxDepth[block] = getBlockMaxDepth<Float>(buffer, block);
+                            buffer.blockDirty[block] = false;
+                        }
+                        tileMaxDepth = std::max(tileMaxDepth, buffer.blockMaxDepth[block]);
+                    }
+                    tileDirty = false;
+                }
+                if (triangle.minDepth >= tileMaxDepth)
+                {
+                    stats.tileHiZRejects++;
+                    continue;
+                }
+
+                // tile relative bounds and plane values at the tile origin
+                int minX = std::max(triangle.minX, x0) - x0, maxX = std::min(triangle.maxX, x1 - 1) - x0;
+                int minY = std::max(triangle.minY, y0) - y0, maxY = std::min(triangle.maxY, y1 - 1) - y0;
+                Float edgeA[3], edgeB[3];
+                float edgeC[3];
+                for (int i = 0; i < 3; i++)
+                {
+                    edgeA[i] = Float(triangle.edges[i].a);
+                    edgeB[i] = Float(triangle.edges[i].b);
+                    edgeC[i] = getTilePlaneBase(triangle.edges[i], triangle, x0, y0);
+                }
+                const CpuRasterPlane* planes[5] = { &triangle.depth, &triangle.invW, &triangle.normal[0], &triangle.normal[1], &triangle.normal[2] };
+                Float planeA[5], planeB[5], planeC[5];
+                for (int i = 0; i < 5; i++)
+                {
+                    planeA[i] = Float(planes[i]->a);
+                    planeB[i] = Float(planes[i]->b);
+                    planeC[i] = Float(getTilePlaneBase(*planes[i], triangle, x0, y0));
+                }
+
+                for (int blockY = minY / CPU_RASTER_BLOCK_HEIGHT; blockY <= maxY / CPU_RASTER_BLOCK_HEIGHT; blockY++)
+                {
+                    for (int blockX = minX / CPU_RASTER_BLOCK_WIDTH; blockX <= maxX / CPU_RASTER_BLOCK_WIDTH; blockX++)
+                    {
+                        int block = blockY * BLOCKS_X + blockX;
+                        int bx = blockX * CPU_RASTER_BLOCK_WIDTH, by = blockY * CPU_RASTER_BLOCK_HEIGHT;
+                        if (buffer.blockDirty[block])
+                        {
+                            buffer.blockMaxDepth[block] = getBlockMaxDepth<Float>(buffer, block);
+                            buffer.blockDirty[block] = false;
+                        }
+                        if (triangle.minDepth >= buffer.blockMaxDepth[block])
+                        {
+                            stats.blockHiZRejects++;
+                            continue;
+                        }
+                        // skip blocks outside one of the edges, the edge functions peak at a corner
+                        bool outside = false;
+                        for (int i = 0; i < 3 && !outside; i++)
+                        {
+                            const CpuRasterPlane& edge = triangle.edges[i];
+                            float peak = edgeC[i] + edge.a * (edge.a > 0.0f ? bx + CPU_RASTER_BLOCK_WIDTH - 1 : bx)
+                                + edge.b * (edge.b > 0.0f ? by + CPU_RASTER_BLOCK_HEIGHT - 1 : by);
+                            outside = peak < 0.0f;
+                        }
+                        if (outside)
+                            continue;
+                        stats.blocks++;
+
+                        bool written = false;
+                        int rowBegin = std::max(by, minY), rowEnd = std::min(by + CPU_RASTER_BLOCK_HEIGHT - 1, maxY);
+                        int columnBegin = std::max(bx, minX), columnEnd = std::min(bx + CPU_RASTER_BLOCK_WIDTH - 1, maxX);
+                        for (int y = rowBegin; y <= rowEnd; y++)
+                        {
+                            Float py((float)y);
+                            for (int x = bx; x < bx + CPU_RASTER_BLOCK_WIDTH; x += W)
+                            {
+                                if (x + W - 1 < columnBegin || x > columnEnd)
+                                    continue;
+                                Float px = laneX + Float((float)x);
+                                Float inside[3];
+                                for (int i = 0; i < 3; i++)
+                                {
+                                    Float e = edgeA[i] * px + edgeB[i] * py + Float(edgeC[i]);
+                                    inside[i] = triangle.inclusive[i] ? e >= zero : e > zero;
+                                }
+                                Float covered = inside[0] & inside[1] & inside[2];
+                                if (!horizontalAny(covered))
+                                    continue;
+                                int offset = y * T + x;
+                                Float oldDepth = Float::load(buffer.depth + offset);
+                                Float depth = planeA[0] * px + planeB[0] * py + planeC[0];
+                                Float pass = covered & (depth < oldDepth);
+                                if (!horizontalAny(pass))
+                                    continue;
+                                Float w = one / (planeA[1] * px + planeB[1] * py + planeC[1]);
+                                select(pass, depth, oldDepth).store(buffer.depth + offset);
+                                select(pass, (w - nearPlane) * invDepthRange, Float::load(buffer.linearDepth + offset)).store(buffer.linearDepth + offset);
+                                for (int c = 0; c < 3; c++)
+                                {
+                                    Float normal = (planeA[2 + c] * px + planeB[2 + c] * py + planeC[2 + c]) * w;
+                                    select(pass, normal, Float::load(buffer.normal[c] + offset)).store(buffer.normal[c] + offset);
+                                }
+                                written = true;
+                            }
+                        }
+                        if (written)
+                        {
+                            buffer.blockDirty[block] = true;
+                            tileDirty = true;
+                        }
+                    }
+                }
+            }
+        }
+
+        for (int y = y0; y < y1; y++)
+        {
+            size_t row = (size_t)y * gBuffer.width;
+            int local = (y - y0) * T;
+            std::copy(buffer.linearDepth + local, buffer.linearDepth + local + (x1 - x0), gBuffer.linearDepth.begin() + row + x0);
+            for (int x = x0; x < x1; x++)
+                gBuffer.normals[row + x] = glm::vec3(buffer.normal[0][local + x - x0], buffer.normal[1][local + x - x0], buffer.normal[2][local + x - x0]);
+        }
+    }
+};
+}
+
+#endif
@@ -0,0 +1,206 @@
+#ifndef CPU_SSAO_H
+#define CPU_SSAO_H
+
+#include <glm/glm.hpp>
+
+#include "ao_image.h"
+#include "cpu_ao.h"
+#include "simd_float.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+// uniforms of ssao.fs
+struct CpuSSAOSettings
+{
+    std::vector<glm::vec3> kernel;
+    std::vector<glm::vec3> noise; // noiseSize x noiseSize rotation vectors, texNoise
+    int noiseSize = 4;
+    float radius = 0.5f;
+    float bias = 0.025f;
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::vec2 uvToViewA = glm::vec2(0.0f);
+    glm::vec2 uvToViewB = glm::vec2(0.0f);
+    glm::vec2 clipPlanes = glm::vec2(0.1f, 50.0f); // near and far plane of the linear depth
+};
+
+namespace SIMD_FLOAT_NAMESPACE
+{
+// CPU port of ssao.fs, including its quirks (normals decoded with 2n - 1),
+// so its output can be compared with the shader pixel by pixel.
+// renderNaive is the straightforward one pixel, one sample at a time port; render runs Float::WIDTH
+// neighbouring pixels of a row in the lanes of a vector, so the position, TBN and normal fetch are set up once
+// per vector instead of once per pixel and no horizontal sum is needed, and spreads screen tiles over the
+// threads of a TileScheduler.
+class CpuSSAO
+{
+public:
+    explicit CpuSSAO(const CpuSSAOSettings& settings) : settings(settings), kernelSize((int)settings.kernel.size())
+    {
+    }
+
+    void renderNaive(const CpuGBuffer& gBuffer, AOImage& image) const
+    {
+        image.resize(gBuffer.width, gBuffer.height);
+        for (int y = 0; y < gBuffer.height; y++)
+        {
+            for (int x = 0; x < gBuffer.width; x++)
+            {
+                glm::vec2 texCoord((x + 0.5f) / gBuffer.width, (y + 0.5f) / gBuffer.height);
+                size_t index = (size_t)y * gBuffer.width + x;
+                glm::vec3 fragPos = reconstructPosition(gBuffer.linearDepth[index], texCoord);
+                glm::mat3 TBN = computeTBN(gBuffer.normals[index], x, y);
+
+                float occlusion = 0.0f;
+                for (int i = 0; i < kernelSize; i++)
+                {
+                    glm::vec3 samplePos = TBN * settings.kernel[i];
+                    samplePos = fragPos + samplePos * settings.radius;
+
+                    glm::vec4 offset = settings.projection * glm::vec4(samplePos, 1.0f);
+                    offset = glm::vec4(glm::vec3(offset) / offset.w, offset.w);
+                    glm::vec2 sampleCoord = glm::vec2(offset) * 0.5f + 0.5f;
+
+                    float sampleZ = viewSpaceZ(sampleNearest(gBuffer, sampleCoord));
+
+                    glm::vec3 d = samplePos - fragPos;
+                    float rangeCheck = glm::dot(d, d) / DEPTH_RANGE_MAX >= 1.0f ? 1.0f : 0.0f;
+                    occlusion += (sampleZ >= fragPos.z + settings.bias ? 1.0f : 0.0f) * rangeCheck;
+                }
+                image.pixels[index] = 1.0f - occlusion / kernelSize;
+            }
+        }
+    }
+
+    template <typename Float>
+    void render(const CpuGBuffer& gBuffer, AOImage& image, TileScheduler& scheduler) const
+    {
+        image.resize(gBuffer.width, gBuffer.height);
+        scheduler.forEachTile(gBuffer.width, gBuffer.height, CPU_AO_TILE_SIZE, [&](int x0, int y0, int x1, int y1)
+        {
+            for (int y = y0; y < y1; y++)
+            {
+                for (int x = x0; x < x1; x += Float::WIDTH)
+                    computePixels<Float>(gBuffer, x, std::min(x + Float::WIDTH, x1), y, image);
+            }
+        });
+    }
+
+private:
+    static constexpr float DEPTH_RANGE_MAX = 0.02f;
+
+    // referenced, not copied: engines only live for one render call
+    const CpuSSAOSettings& settings;
+    int kernelSize = 0;
+
+    float viewSpaceZ(float linearDepth) const
+    {
+        return -(settings.clipPlanes.x + linearDepth * (settings.clipPlanes.y - settings.clipPlanes.x));
+    }
+
+    glm::vec3 reconstructPosition(float linearDepth, const glm::vec2& texCoord) const
+    {
+        float z = viewSpaceZ(linearDepth);
+        return glm::vec3((settings.uvToViewA * texCoord + settings.uvToViewB) * z, z);
+    }
+
+    glm::mat3 computeTBN(const glm::vec3& encodedNormal, int x, int y) const
+    {
+        glm::vec3 normal = 2.0f * encodedNormal - 1.0f;
+        glm::vec3 randomVec = settings.noise[(y % settings.noiseSize) * settings.noiseSize + x % settings.noiseSize];
+        glm::vec3 tangent = glm::cross(randomVec, normal);
+        glm::vec3 bitangent = glm::cross(normal, tangent);
+        return glm::mat3(tangent, bitangent, normal);
+    }
+
+    static float sampleNearest(const CpuGBuffer& gBuffer, const glm::vec2& texCoord)
+    {
+        int x = CpuGBuffer::wrap((int)floorf(texCoord.x * gBuffer.width), gBuffer.width);
+        int y = CpuGBuffer::wrap((int)floorf(texCoord.y * gBuffer.height), gBuffer.height);
+        return gBuffer.linearDepth[(size_t)y * gBuffer.width + x];
+    }
+
+    // pixels x0..x1-1 of row y, lanes past x1 repeat the last pixel and are not stored
+    template <typename Float>
+    void computePixels(const CpuGBuffer& gBuffer, int x0, int x1, int y, AOImage& image) const
+    {
+        const int W = Float::WIDTH;
+        const glm::mat4& P = settings.projection;
+        float laneU[W], laneDepth[W], laneNormal[3][W], laneNoise[3][W];
+        for (int l = 0; l < W; l++)
+        {
+            int x = std::min(x0 + l, x1 - 1);
+            size_t index = (size_t)y * gBuffer.width + x;
+            const glm::vec3& normal = gBuffer.normals[index];
+            const glm::vec3& random = settings.noise[(y % settings.noiseSize) * settings.noiseSize + x % settings.noiseSize];
+            laneU[l] = (x + 0.5f) / gBuffer.width;
+            laneDepth[l] = gBuffer.linearDepth[index];
+            for (int c = 0; c < 3; c++)
+            {
+                laneNormal[c][l] = normal[c];
+                laneNoise[c][l] = random[c];
+            }
+        }
+        Float half(0.5f), one(1.0f), two(2.0f), invRangeMax(1.0f / DEPTH_RANGE_MAX);
+        // view space z = -(near + d * (far - near)), negated terms round the same way
+        Float negNear(-settings.clipPlanes.x), negDepthRange(settings.clipPlanes.x - settings.clipPlanes.y);
+        Float width((float)gBuffer.width), height((float)gBuffer.height);
+        Float invWidth(1.0f / gBuffer.width), invHeight(1.0f / gBuffer.height);
+
+        // reconstructPosition
+        Float u = Float::load(laneU), v((y + 0.5f) / gBuffer.height);
+        Float fragZ = negNear + Float::load(laneDepth) * negDepthRange;
+        Float fragX = (Float(settings.uvToViewA.x) * u + Float(settings.uvToViewB.x)) * fragZ;
+        Float fragY = (Float(settings.uvToViewA.y) * v + Float(settings.uvToViewB.y)) * fragZ;
+        Float fragZBiased = fragZ + Float(settings.bias);
+
+        // computeTBN: tangent = cross(randomVec, normal), bitangent = cross(normal, tangent)
+        Float nx = two * Float::load(laneNormal[0]) - one;
+        Float ny = two * Float::load(laneNormal[1]) - one;
+        Float nz = two * Float::load(laneNormal[2]) - one;
+        Float rx = Float::load(laneNoise[0]), ry = Float::load(laneNoise[1]), rz = Float::load(laneNoise[2]);
+        Float tx = ry * nz - ny * rz, ty = rz * nx - nz * rx, tz = rx * ny - nx * ry;
+        Float bx = ny * tz - ty * nz, by = nz * tx - tz * nx, bz = nx * ty - tx * ny;
+
+        Float radius(settings.radius);
+        Float occlusion(0.0f);
+        for (int i = 0; i < kernelSize; i++)
+        {
+            // samplePos = fragPos + TBN * sample * radius, the sample is the same in every lane
+            const glm::vec3& sample = settings.kernel[i];
+            Float kx(sample.x), ky(sample.y), kz(sample.z);
+            Float dx = (tx * kx + bx * ky + nx * kz) * radius;
+            Float dy = (ty * kx + by * ky + ny * kz) * radius;
+            Float dz = (tz * kx + bz * ky + nz * kz) * radius;
+            Float px = fragX + dx, py = fragY + dy, pz = fragZ + dz;
+
+            // projectPosition, only xy and w are needed
+            Float clipX = Float(P[0].x) * px + Float(P[1].x) * py + Float(P[2].x) * pz + Float(P[3].x);
+            Float clipY = Float(P[0].y) * px + Float(P[1].y) * py + Float(P[2].y) * pz + Float(P[3].y);
+            Float clipW = Float(P[0].w) * px + Float(P[1].w) * py + Float(P[2].w) * pz + Float(P[3].w);
+            Float invClipW = one / clipW;
+            Float sampleU = clipX * invClipW * half + half;
+            Float sampleV = clipY * invClipW * half + half;
+
+            // nearest depth fetch
+            Float texelX = wrapTexel(floor(sampleU * width), width, invWidth);
+            Float texelY = wrapTexel(floor(sampleV * height), height, invHeight);
+            Float sampleDepth = Float::gather(gBuffer.linearDepth.data(), texelY * width + texelX);
+            Float sampleZ = negNear + sampleDepth * negDepthRange;
+
+            Float offsetX = px - fragX, offsetY = py - fragY, offsetZ = pz - fragZ;
+            Float rangeCheck = (offsetX * offsetX + offsetY * offsetY + offsetZ * offsetZ) * invRangeMax >= one;
+            occlusion = occlusion + ifThen((sampleZ >= fragZBiased) & rangeCheck, one);
+        }
+        Float ao = one - occlusion / Float((float)kernelSize);
+
+        float result[W];
+        ao.store(result);
+        for (int x = x0; x < x1; x++)
+            image.pixels[(size_t)y * gBuffer.width + x] = result[x - x0];
+    }
+};
+}
+
+#endif
@@ -0,0 +1,55 @@
+#version 330 core
+
+// Splits the linear depth (ao_downsample.fs, or the G-buffer depth with HARDWARE_DEPTH) into 4x4 layers of view space depth, one pass writes the 8 layers of two rows:
+// output i is the layer of pixel (i % 4, firstRow + i / 4) of every 4x4 block.
+layout (location = 0) out float layer0;
+layout (location = 1) out float layer1;
+layout (location = 2) out float layer2;
+layout (location = 3) out float layer3;
+layout (location = 4) out float layer4;
+layout (location = 5) out float layer5;
+layout (location = 6) out float layer6;
+layout (location = 7) out float layer7;
+
+uniform sampler2D linearDepth;
+
+uniform vec2 clipPlanes;
+uniform int firstRow;
+
+#ifdef HARDWARE_DEPTH
+// the input is the G-buffer's depth buffer (AO at the render resolution), linearized like ao_downsample.fs does
+uniform vec2 LinMAD;
+
+float LinearizeDepth(float depth)
+{
+    if (depth == 1.0)
+        return 1.0; // far plane, nothing rendered
+    return (1.0 / (LinMAD.x * (depth * 2.0 - 1.0) + LinMAD.y) - clipPlanes.x) / (clipPlanes.y - clipPlanes.x);
+}
+#else
+float LinearizeDepth(float depth)
+{
+    return depth;
+}
+#endif
+
+float ViewSpaceZ(ivec2 coord)
+{
+    // pixels of the last layer column / row beyond the AO resolution repeat the edge
+    coord = min(coord, textureSize(linearDepth, 0) - 1);
+    float d = LinearizeDepth(texelFetch(linearDepth, coord, 0).r);
+    return -(clipPlanes.x + d * (clipPlanes.y - clipPlanes.x));
+}
+
+void main()
+{
+    ivec2 base = ivec2(gl_FragCoord.xy) * 4 + ivec2(0, firstRow);
+    layer0 = ViewSpaceZ(base + ivec2(0, 0));
+    layer1 = ViewSpaceZ(base + ivec2(1, 0));
+    layer2 = ViewSpaceZ(base + ivec2(2, 0));
+    layer3 = ViewSpaceZ(base + ivec2(3, 0));
+    layer4 = ViewSpaceZ(base + ivec2(0, 1));
+    layer5 = ViewSpaceZ(base + ivec2(1, 1));
+    layer6 = ViewSpaceZ(base + ivec2(2, 1));
+    layer7 = ViewSpaceZ(base + ivec2(3, 1));
+}
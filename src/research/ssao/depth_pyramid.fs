@@ -0,0 +1,38 @@
+#version 330 core
+
+// One level of the linear depth pyramid: level 0 copies the linear depth (ao_downsample.fs) or linearizes the G-buffer depth
+// (HARDWARE_DEPTH), every further level keeps one texel of each 2x2 block of the previous one, alternating on a rotated grid.
+// Depth is not averaged, a mean of both sides of an edge is a surface AO would see as an occluder.
+out float FragColor;
+
+// depth for level 0, the previous level of the pyramid otherwise (as its base level)
+uniform sampler2D depthInput;
+uniform int level;
+// near and far plane of the linear depth
+uniform vec2 clipPlanes;
+
+#ifdef HARDWARE_DEPTH
+// the input is the G-buffer's depth buffer (AO at the render resolution), linearized like ao_downsample.fs does
+uniform vec2 LinMAD;
+
+float LinearizeDepth(float depth)
+{
+    if (depth == 1.0)
+        return 1.0; // far plane, nothing rendered
+    return (1.0 / (LinMAD.x * (depth * 2.0 - 1.0) + LinMAD.y) - clipPlanes.x) / (clipPlanes.y - clipPlanes.x);
+}
+#else
+float LinearizeDepth(float depth)
+{
+    return depth;
+}
+#endif
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    if (level > 0)
+        coord = min(coord * 2 + ivec2(coord.y & 1, coord.x & 1), textureSize(depthInput, 0) - 1);
+    float d = texelFetch(depthInput, coord, 0).r;
+    FragColor = level == 0 ? LinearizeDepth(d) : d;
+}
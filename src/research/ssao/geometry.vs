@@ -1,10 +1,11 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNormal;
+layout (location = 7) in float aBakedAO; // ao_bake.h, 1 for meshes without a bake
 
 out vec2 TexCoord;
 out vec3 Normal;
-out vec3 Position;
+out float BakedAO;
 
 uniform bool invertedNormals;
 
@@ -19,6 +20,6 @@ void main()
     mat3 normalMatrix = transpose(inverse(mat3(model)));
     Normal = normalize(normalMatrix * (invertedNormals ? -aNormal : aNormal));
     
-    Position = viewPos.xyz;
+    BakedAO = aBakedAO;
     gl_Position = projection * viewPos;
 }
\ No newline at end of file
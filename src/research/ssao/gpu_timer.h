@@ -0,0 +1,117 @@
+#ifndef GPU_TIMER_H
+#define GPU_TIMER_H
+
+#include <glad/glad.h>
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+const int GPU_TIMER_FRAMES_IN_FLIGHT = 8;
+
+// Ring of timestamp queries spread over several frames in flight. Every frame writes up to
+// maxTimestampsPerFrame timestamps into its own slot and results are collected only after
+// GL_QUERY_RESULT_AVAILABLE reports them, so every frame can be timed without stalling the pipeline.
+// FrameInfo is stored with each frame to describe the state it was rendered with, as results arrive
+// a few frames later.
+template <typename FrameInfo>
+class GpuTimerRing
+{
+public:
+    GpuTimerRing(int maxTimestampsPerFrame, int framesInFlight = GPU_TIMER_FRAMES_IN_FLIGHT)
+        : maxTimestampsPerFrame(maxTimestampsPerFrame), framesInFlight(framesInFlight),
+          queries(maxTimestampsPerFrame * framesInFlight), counts(framesInFlight), infos(framesInFlight)
+    {
+        glGenQueries((GLsizei)queries.size(), queries.data());
+    }
+
+    void beginFrame(const FrameInfo& info)
+    {
+        // all slots are still waiting for the GPU: drop the oldest frame instead of blocking
+        if (pendingCount == framesInFlight)
+        {
+            head = (head + 1) % framesInFlight;
+            pendingCount--;
+            droppedFrames++;
+        }
+        current = (head + pendingCount) % framesInFlight;
+        counts[current] = 0;
+        infos[current] = info;
+    }
+
+    // info of the frame being recorded, can be extended until endFrame
+    FrameInfo& currentFrame()
+    {
+        return infos[current];
+    }
+
+    // writes the next timestamp of the frame, returns its index or -1 if the frame has no queries left
+    int timestamp()
+    {
+        if (counts[current] == maxTimestampsPerFrame)
+            return -1;
+        int index = counts[current]++;
+        glQueryCounter(queries[current * maxTimestampsPerFrame + index], GL_TIMESTAMP);
+        return index;
+    }
+
+    void endFrame()
+    {
+        pendingCount++;
+    }
+
+    // returns the oldest frame if all its timestamps are available, frames are returned in submission order
+    bool popFrame(FrameInfo& info, std::vector<uint64_t>& timestamps)
+    {
+        if (pendingCount == 0)
+            return false;
+
+        const unsigned int* frameQueries = &queries[head * maxTimestampsPerFrame];
+        int count = counts[head];
+        for (int i = 0; i < count; i++)
+        {
+            GLint available = 0;
+            glGetQueryObjectiv(frameQueries[i], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (!available)
+                return false;
+        }
+        timestamps.resize(count);
+        for (int i = 0; i < count; i++)
+            glGetQueryObjectui64v(frameQueries[i], GL_QUERY_RESULT, &timestamps[i]);
+
+        // swap instead of copy, so buffers inside FrameInfo are reused by later frames
+        std::swap(info, infos[head]);
+        head = (head + 1) % framesInFlight;
+        pendingCount--;
+        return true;
+    }
+
+    bool hasPendingFrames() const
+    {
+        return pendingCount > 0;
+    }
+
+    // frames lost because the GPU was more than framesInFlight frames behind
+    int getDroppedFrames() const
+    {
+        return droppedFrames;
+    }
+
+    int getMaxTimestampsPerFrame() const
+    {
+        return maxTimestampsPerFrame;
+    }
+
+private:
+    int maxTimestampsPerFrame;
+    int framesInFlight;
+    std::vector<unsigned int> queries;
+    std::vector<int> counts;
+    std::vector<FrameInfo> infos;
+    int head = 0;
+    int current = 0;
+    int pendingCount = 0;
+    int droppedFrames = 0;
+};
+
+#endif
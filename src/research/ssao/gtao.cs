@@ -0,0 +1,225 @@
+// Compute shader version of gtao.fs: a work group copies the linear depth of its tile and an apron around it
+// into shared memory once, the horizon search of its pixels reads depth from there.
+
+#version 430
+
+#define PI				3.1415926535897932
+#define TWO_PI			6.2831853071795864
+#define HALF_PI			1.5707963267948966
+#define ONE_OVER_PI		0.3183098861837906
+
+// specialized by the application like gtao.fs, the tile layout with them
+#ifndef NUM_DIRECTIONS
+#define NUM_DIRECTIONS	8
+#endif
+#ifndef NUM_STEPS
+#define NUM_STEPS		4
+#endif
+#ifndef RADIUS
+#define RADIUS			0.2		// in world space
+#endif
+#ifndef GROUP_SIZE
+#define GROUP_SIZE		16
+#endif
+#ifndef TILE_SIZE
+#define TILE_SIZE		32
+#endif
+#ifndef TILE_APRON
+#define TILE_APRON		24
+#endif
+
+layout (local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+
+// AO and packed depth, like the output of gtao.fs
+layout (rg16f) uniform writeonly image2D aoOutput;
+
+// linear depth (ao_downsample.fs) or the G-buffer depth (HARDWARE_DEPTH)
+uniform sampler2D linearDepth;
+uniform sampler2D gNormal;
+uniform sampler2D texNoise;
+
+uniform vec4 projInfo;
+uniform vec4 clipInfo;
+uniform vec2 params;
+uniform mat4 invView;
+
+// every invocation shades PIXELS_PER_THREAD x PIXELS_PER_THREAD pixels of the tile
+const int PIXELS_PER_THREAD = TILE_SIZE / GROUP_SIZE;
+// linear depth of the tile and TILE_APRON pixels around it, wrapped like the GL_REPEAT texture
+const int TILE_WIDTH = TILE_SIZE + 2 * TILE_APRON;
+shared float depthTile[TILE_WIDTH * TILE_WIDTH];
+ivec2 tileOrigin;
+
+#ifdef HARDWARE_DEPTH
+// the input is the G-buffer's depth buffer (AO at the render resolution), linearized like ao_downsample.fs does
+uniform vec2 LinMAD;
+
+float LinearizeDepth(float depth)
+{
+	if (depth == 1.0)
+		return 1.0; // far plane, nothing rendered
+	return (1.0 / (LinMAD.x * (depth * 2.0 - 1.0) + LinMAD.y) - clipInfo.x) / (clipInfo.y - clipInfo.x);
+}
+#else
+float LinearizeDepth(float depth)
+{
+	return depth;
+}
+#endif
+
+float FetchLinearDepth(ivec2 pixel)
+{
+	ivec2 size = textureSize(linearDepth, 0);
+	pixel -= size * ivec2(floor(vec2(pixel) / vec2(size)));
+	return LinearizeDepth(texelFetch(linearDepth, pixel, 0).r);
+}
+
+void LoadDepthTile()
+{
+	tileOrigin = ivec2(gl_WorkGroupID.xy) * TILE_SIZE - TILE_APRON;
+	for (int i = int(gl_LocalInvocationIndex); i < TILE_WIDTH * TILE_WIDTH; i += GROUP_SIZE * GROUP_SIZE)
+		depthTile[i] = FetchLinearDepth(tileOrigin + ivec2(i % TILE_WIDTH, i / TILE_WIDTH));
+	barrier();
+}
+
+// samples beyond the apron read the texture
+float LinearDepth(ivec2 pixel)
+{
+	ivec2 local = pixel - tileOrigin;
+	if (all(greaterThanEqual(local, ivec2(0))) && all(lessThan(local, ivec2(TILE_WIDTH))))
+		return depthTile[local.y * TILE_WIDTH + local.x];
+	return FetchLinearDepth(pixel);
+}
+
+// uv in pixels like gl_FragCoord in gtao.fs, nearest texel like its texture()
+vec4 GetViewPosition(vec2 uv)
+{
+	float d = LinearDepth(ivec2(floor(uv)));
+	vec4 ret = vec4(0.0, 0.0, 0.0, d);
+
+	ret.z = clipInfo.x + d * (clipInfo.y - clipInfo.x);
+	ret.xy = (uv * projInfo.xy + projInfo.zw) * ret.z;
+
+	return ret;
+}
+
+#define FALLOFF_START2	0.01
+#define FALLOFF_END2	0.5
+float Falloff(float dist2, float cosh)
+{
+	return 2.0 * clamp((dist2 - FALLOFF_START2) / (FALLOFF_END2 - FALLOFF_START2), 0.0, 1.0);
+}
+
+vec2 ComputeAO(ivec2 loc)
+{
+	vec2 fragCoord = vec2(loc) + 0.5;
+	vec4 vpos = GetViewPosition(fragCoord);
+
+	if (vpos.w == 1.0)
+		return vec2(1.0, -30.0 * vpos.z);
+
+	vec4 s;
+	vec3 vnorm	= texelFetch(gNormal, loc, 0).rgb;
+	vec3 vdir	= normalize(-vpos.xyz);
+	vec3 dir, ws;
+
+	// calculation uses left handed system
+	vnorm = vnorm * mat3(invView);
+	vnorm.z = -vnorm.z;
+
+	vec2 noises	= texelFetch(texNoise, loc % 4, 0).rg;
+	vec2 offset;
+	vec2 horizons = vec2(-1.0, -1.0);
+
+	float radius = (RADIUS * clipInfo.z) / vpos.z;
+	radius = max(NUM_STEPS, radius);
+
+	float stepsize	= radius / NUM_STEPS;
+	float phi		= 0.0;
+	float ao		= 0.0;
+	float division	= noises.y * stepsize;
+	float currstep	= 1.0;
+	float dist2, invdist, falloff, cosh;
+
+	for (int k = 0; k < NUM_DIRECTIONS; ++k) {
+		phi = float(k) * (PI / NUM_DIRECTIONS);
+		currstep = 1.0 + division + 0.25 * stepsize * params.y;
+
+		dir = vec3(cos(phi), sin(phi), 0.0);
+		horizons = vec2(-1.0);
+
+		// calculate horizon angles
+		for (int j = 0; j < NUM_STEPS; ++j) {
+			offset = round(dir.xy * currstep);
+
+			// h1
+			s = GetViewPosition(fragCoord + offset);
+			ws = s.xyz - vpos.xyz;
+
+			dist2 = dot(ws, ws);
+			invdist = inversesqrt(dist2);
+			cosh = invdist * dot(ws, vdir);
+
+			falloff = Falloff(dist2, cosh);
+			horizons.x = max(horizons.x, cosh - falloff);
+
+			// h2
+			s = GetViewPosition(fragCoord - offset);
+			ws = s.xyz - vpos.xyz;
+
+			dist2 = dot(ws, ws);
+			invdist = inversesqrt(dist2);
+			cosh = invdist * dot(ws, vdir);
+
+			falloff = Falloff(dist2, cosh);
+			horizons.y = max(horizons.y, cosh - falloff);
+
+			// increment
+			currstep += stepsize;
+		}
+
+		horizons = acos(horizons);
+
+		// calculate gamma
+		vec3 bitangent	= normalize(cross(dir, vdir));
+		vec3 tangent	= cross(vdir, bitangent);
+		vec3 nx			= vnorm - bitangent * dot(vnorm, bitangent);
+
+		float nnx		= length(nx);
+		float invnnx	= 1.0 / (nnx + 1e-6);			// to avoid division with zero
+		float cosxi		= dot(nx, tangent) * invnnx;	// xi = gamma + HALF_PI
+		float gamma		= acos(cosxi) - HALF_PI;
+		float cosgamma	= dot(nx, vdir) * invnnx;
+		float singamma2	= -2.0 * cosxi;					// cos(x + HALF_PI) = -sin(x)
+
+		// clamp to normal hemisphere
+		horizons.x = gamma + max(-horizons.x - gamma, -HALF_PI);
+		horizons.y = gamma + min(horizons.y - gamma, HALF_PI);
+
+		// Riemann integral is additive
+		ao += nnx * 0.25 * (
+			(horizons.x * singamma2 + cosgamma - cos(2.0 * horizons.x - gamma)) +
+			(horizons.y * singamma2 + cosgamma - cos(2.0 * horizons.y - gamma)));
+	}
+
+	// PDF = 1 / pi and must normalize with pi because of Lambert
+	ao = ao / float(NUM_DIRECTIONS);
+
+	// vpos.z is the distance in front of the camera, view space z is its negative
+	return vec2(ao, -30.0 * vpos.z);
+}
+
+void main()
+{
+	LoadDepthTile();
+
+	// pixels of an invocation are GROUP_SIZE apart, neighbouring invocations shade neighbouring pixels
+	ivec2 size = imageSize(aoOutput);
+	for (int i = 0; i < PIXELS_PER_THREAD * PIXELS_PER_THREAD; i++)
+	{
+		ivec2 pixel = ivec2(gl_WorkGroupID.xy) * TILE_SIZE + ivec2(gl_LocalInvocationID.xy) +
+			GROUP_SIZE * ivec2(i % PIXELS_PER_THREAD, i / PIXELS_PER_THREAD);
+		if (all(lessThan(pixel, size)))
+			imageStore(aoOutput, pixel, vec4(ComputeAO(pixel), 0.0, 0.0));
+	}
+}
@@ -7,11 +7,20 @@
 #define HALF_PI			1.5707963267948966
 #define ONE_OVER_PI		0.3183098861837906
 
+// specialized by the application (GTAO_DIRS, GTAO_STEPS, GTAO_SAMPLE_RADIUS)
+#ifndef NUM_DIRECTIONS
 #define NUM_DIRECTIONS	8
+#endif
+#ifndef NUM_STEPS
 #define NUM_STEPS		4
+#endif
+#ifndef RADIUS
 #define RADIUS			0.2		// in world space
+#endif
 
-uniform sampler2D gDepth;
+// linear depth (ao_downsample.fs) or the G-buffer depth (HARDWARE_DEPTH), a linear depth mip chain when DEPTH_PYRAMID
+// is defined (depth_pyramid.fs)
+uniform sampler2D linearDepth;
 uniform sampler2D gNormal;
 uniform sampler2D texNoise;
 
@@ -22,14 +31,54 @@ uniform mat4 invView;
 
 in vec2 TexCoord;
 
-out float FragColor;
+// AO and the depth bilateral_blur.fs weights its taps with, packed like hbao.fs does (30 * view space z)
+out vec2 FragColor;
+
+#ifdef HARDWARE_DEPTH
+// the input is the G-buffer's depth buffer (AO at the render resolution), linearized like ao_downsample.fs does
+uniform vec2 LinMAD;
+
+float LinearizeDepth(float depth)
+{
+	if (depth == 1.0)
+		return 1.0; // far plane, nothing rendered
+	return (1.0 / (LinMAD.x * (depth * 2.0 - 1.0) + LinMAD.y) - clipInfo.x) / (clipInfo.y - clipInfo.x);
+}
+#else
+float LinearizeDepth(float depth)
+{
+	return depth;
+}
+#endif
+
+#ifdef DEPTH_PYRAMID
+// last level of the pyramid, fewer than DEPTH_PYRAMID_LEVELS at small AO resolutions
+uniform int depthPyramidMaxLevel;
+
+// mip 0 for samples up to 8 pixels away, one level coarser per doubling of the distance
+int DepthPyramidLevel(float pixelDistance)
+{
+	return clamp(int(log2(max(pixelDistance, 1.0))) - 3, 0, depthPyramidMaxLevel);
+}
+
+// nearest texel of the level, like texture() on mip 0
+float DepthPyramidFetch(vec2 uv, int level)
+{
+	ivec2 size = textureSize(linearDepth, level);
+	return texelFetch(linearDepth, clamp(ivec2(uv * vec2(size)), ivec2(0), size - 1), level).r;
+}
+#endif
 
 vec4 GetViewPosition(vec2 uv)
 {
-	vec2 basesize = vec2(textureSize(gDepth, 0));
+	vec2 basesize = vec2(textureSize(linearDepth, 0));
 	vec2 coord = (uv / basesize);
 
-	float d = texture(gDepth, coord).r;
+#ifdef DEPTH_PYRAMID
+	float d = DepthPyramidFetch(coord, DepthPyramidLevel(length(uv - gl_FragCoord.xy)));
+#else
+	float d = LinearizeDepth(texture(linearDepth, coord).r);
+#endif
 	vec4 ret = vec4(0.0, 0.0, 0.0, d);
 
 	ret.z = clipInfo.x + d * (clipInfo.y - clipInfo.x);
@@ -53,7 +102,7 @@ void main()
 
 	if (vpos.w == 1.0) 
 	{
-		FragColor = 1.0;
+		FragColor = vec2(1.0, -30.0 * vpos.z);
 		return;
 	}
 
@@ -144,5 +193,6 @@ void main()
 	// PDF = 1 / pi and must normalize with pi because of Lambert
 	ao = ao / float(NUM_DIRECTIONS);
 
-	FragColor = ao;
+	// vpos.z is the distance in front of the camera, view space z is its negative
+	FragColor = vec2(ao, -30.0 * vpos.z);
 }
\ No newline at end of file
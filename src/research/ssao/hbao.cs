@@ -0,0 +1,295 @@
+// Compute shader version of hbao.fs: a work group copies the linear depth of its tile and an apron around it
+// into shared memory once, the horizon search of its pixels reads depth from there.
+
+#version 430 core
+
+const float PI = 3.14159265;
+
+// loop counts are specialized by the application like hbao.fs, the tile layout with them
+#ifndef NUM_DIRECTIONS
+#define NUM_DIRECTIONS 8
+#endif
+#ifndef NUM_STEPS
+#define NUM_STEPS 4
+#endif
+#ifndef GROUP_SIZE
+#define GROUP_SIZE 16
+#endif
+#ifndef TILE_SIZE
+#define TILE_SIZE 32
+#endif
+#ifndef TILE_APRON
+#define TILE_APRON 24
+#endif
+
+layout (local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+
+// AO and packed depth, like the output of hbao.fs
+layout (rg16f) uniform writeonly image2D aoOutput;
+
+// linear depth (ao_downsample.fs) or the G-buffer depth (HARDWARE_DEPTH)
+uniform sampler2D linearDepth;
+// near and far plane of the linear depth
+uniform vec2 clipPlanes;
+uniform sampler2D texNoise;
+
+uniform vec2 FocalLen;
+uniform vec2 UVToViewA;
+uniform vec2 UVToViewB;
+
+// set by the application for the current AO resolution
+uniform vec2 AORes;
+uniform vec2 InvAORes;
+
+uniform float AOStrength = 1.9;
+uniform float R = 0.3;
+uniform float R2 = 0.3*0.3;
+uniform float NegInvR2 = - 1.0 / (0.3*0.3);
+uniform float TanBias = tan(30.0 * PI / 180.0);
+uniform float MaxRadiusPixels = 100.0;
+
+// every invocation shades PIXELS_PER_THREAD x PIXELS_PER_THREAD pixels of the tile
+const int PIXELS_PER_THREAD = TILE_SIZE / GROUP_SIZE;
+// linear depth of the tile and TILE_APRON pixels around it, wrapped like the GL_REPEAT texture
+const int TILE_WIDTH = TILE_SIZE + 2 * TILE_APRON;
+shared float depthTile[TILE_WIDTH * TILE_WIDTH];
+ivec2 tileOrigin;
+
+// texture coordinate of the pixel being shaded, TexCoord of hbao.fs
+vec2 TexCoord;
+
+#ifdef HARDWARE_DEPTH
+// the input is the G-buffer's depth buffer (AO at the render resolution), linearized like ao_downsample.fs does
+uniform vec2 LinMAD;
+
+float LinearizeDepth(float depth)
+{
+	if (depth == 1.0)
+		return 1.0; // far plane, nothing rendered
+	return (1.0 / (LinMAD.x * (depth * 2.0 - 1.0) + LinMAD.y) - clipPlanes.x) / (clipPlanes.y - clipPlanes.x);
+}
+#else
+float LinearizeDepth(float depth)
+{
+	return depth;
+}
+#endif
+
+float FetchLinearDepth(ivec2 pixel)
+{
+	ivec2 size = textureSize(linearDepth, 0);
+	pixel -= size * ivec2(floor(vec2(pixel) / vec2(size)));
+	return LinearizeDepth(texelFetch(linearDepth, pixel, 0).r);
+}
+
+void LoadDepthTile()
+{
+	tileOrigin = ivec2(gl_WorkGroupID.xy) * TILE_SIZE - TILE_APRON;
+	for (int i = int(gl_LocalInvocationIndex); i < TILE_WIDTH * TILE_WIDTH; i += GROUP_SIZE * GROUP_SIZE)
+		depthTile[i] = FetchLinearDepth(tileOrigin + ivec2(i % TILE_WIDTH, i / TILE_WIDTH));
+	barrier();
+}
+
+// samples beyond the apron read the texture
+float LinearDepth(ivec2 pixel)
+{
+	ivec2 local = pixel - tileOrigin;
+	if (all(greaterThanEqual(local, ivec2(0))) && all(lessThan(local, ivec2(TILE_WIDTH))))
+		return depthTile[local.y * TILE_WIDTH + local.x];
+	return FetchLinearDepth(pixel);
+}
+
+vec3 UVToViewSpace(vec2 uv, float z)
+{
+	uv = UVToViewA * uv + UVToViewB;
+	return vec3(uv * z, z);
+}
+
+// nearest texel like texture() in hbao.fs
+vec3 GetViewPos(vec2 uv)
+{
+	float d = LinearDepth(ivec2(floor(uv * AORes)));
+	float z = -(clipPlanes.x + d * (clipPlanes.y - clipPlanes.x));
+	return UVToViewSpace(uv, z);
+}
+
+float TanToSin(float x)
+{
+	return x * inversesqrt(x * x + 1.0);
+}
+
+float InvLength(vec2 V)
+{
+	return inversesqrt(dot(V, V));
+}
+
+float BiasedTangent(vec3 V)
+{
+	return V.z * InvLength(V.xy) + TanBias;
+}
+
+float Tangent(vec3 P, vec3 S)
+{
+	return -(P.z - S.z) * InvLength(S.xy - P.xy);
+}
+
+float Length2(vec3 V)
+{
+	return dot(V, V);
+}
+
+vec3 MinDiff(vec3 P, vec3 Pr, vec3 Pl)
+{
+	vec3 V1 = Pr - P;
+	vec3 V2 = P - Pl;
+	return (Length2(V1) < Length2(V2)) ? V1 : V2;
+}
+
+vec2 SnapUVOffset(vec2 uv)
+{
+	return round(uv * AORes) * InvAORes;
+}
+
+float Falloff(float d2)
+{
+	return d2 * NegInvR2 + 1.0f;
+}
+
+float HorizonOcclusion(vec2 deltaUV, vec3 P, vec3 dPdu, vec3 dPdv, float randstep, float numSamples)
+{
+	float ao = 0;
+
+	// Offset the first coord with some noise
+	vec2 uv = TexCoord + SnapUVOffset(randstep*deltaUV);
+	deltaUV = SnapUVOffset( deltaUV );
+
+	// Calculate the tangent vector
+	vec3 T = deltaUV.x * dPdu + deltaUV.y * dPdv;
+
+	// Get the angle of the tangent vector from the viewspace axis
+	float tanH = BiasedTangent(T);
+	float sinH = TanToSin(tanH);
+
+	// Sample to find the maximum angle
+	for(float s = 1; s <= numSamples; ++s)
+	{
+		uv += deltaUV;
+		vec3 S = GetViewPos(uv);
+		float tanS = Tangent(P, S);
+		float d2 = Length2(S - P);
+
+		// Is the sample within the radius and the angle greater?
+		if(d2 < R2 && tanS > tanH)
+		{
+			float sinS = TanToSin(tanS);
+			// Apply falloff based on the distance
+			ao += Falloff(d2) * (sinS - sinH);
+
+			tanH = tanS;
+			sinH = sinS;
+		}
+	}
+
+	return ao;
+}
+
+vec2 RotateDirections(vec2 Dir, vec2 CosSin)
+{
+	return vec2(Dir.x*CosSin.x - Dir.y*CosSin.y,
+	            Dir.x*CosSin.y + Dir.y*CosSin.x);
+}
+
+void ComputeSteps(inout vec2 stepSizeUv, inout float numSteps, float rayRadiusPix, float rand)
+{
+	// Avoid oversampling if numSteps is greater than the kernel radius in pixels
+	numSteps = min(float(NUM_STEPS), rayRadiusPix);
+
+	// Divide by Ns+1 so that the farthest samples are not fully attenuated
+	float stepSizePix = rayRadiusPix / (numSteps + 1);
+
+	// Clamp numSteps if it is greater than the max kernel footprint
+	float maxNumSteps = MaxRadiusPixels / stepSizePix;
+	if (maxNumSteps < numSteps)
+	{
+		// Use dithering to avoid AO discontinuities
+		numSteps = floor(maxNumSteps + rand);
+		numSteps = max(numSteps, 1);
+		stepSizePix = MaxRadiusPixels / numSteps;
+	}
+
+	// Step size in uv space
+	stepSizeUv = stepSizePix * InvAORes;
+}
+
+vec2 ComputeAO(ivec2 pixel)
+{
+	TexCoord = (vec2(pixel) + 0.5) * InvAORes;
+
+	vec3 P, Pr, Pl, Pt, Pb;
+	P 	= GetViewPos(TexCoord);
+
+	// Sample neighboring pixels
+	Pr 	= GetViewPos(TexCoord + vec2( InvAORes.x, 0));
+	Pl 	= GetViewPos(TexCoord + vec2(-InvAORes.x, 0));
+	Pt 	= GetViewPos(TexCoord + vec2( 0, InvAORes.y));
+	Pb 	= GetViewPos(TexCoord + vec2( 0,-InvAORes.y));
+
+	// Calculate tangent basis vectors using the minimu difference
+	vec3 dPdu = MinDiff(P, Pr, Pl);
+	vec3 dPdv = MinDiff(P, Pt, Pb) * (AORes.y * InvAORes.x);
+
+	// Get the random samples from the noise texture
+	vec3 random = texelFetch(texNoise, pixel % textureSize(texNoise, 0), 0).rgb;
+
+	// Calculate the projected size of the hemisphere
+	vec2 rayRadiusUV = 0.5 * R * FocalLen / -P.z;
+	float rayRadiusPix = rayRadiusUV.x * AORes.x;
+
+	float ao = 1.0;
+
+	// Make sure the radius of the evaluated hemisphere is more than a pixel
+	if(rayRadiusPix > 1.0)
+	{
+		ao = 0.0;
+		float numSteps;
+		vec2 stepSizeUV;
+
+		// Compute the number of steps
+		ComputeSteps(stepSizeUV, numSteps, rayRadiusPix, random.z);
+
+		float alpha = 2.0 * PI / NUM_DIRECTIONS;
+
+		// Calculate the horizon occlusion of each direction
+		for(float d = 0; d < NUM_DIRECTIONS; ++d)
+		{
+			float theta = alpha * d;
+
+			// Apply noise to the direction
+			vec2 dir = RotateDirections(vec2(cos(theta), sin(theta)), random.xy);
+			vec2 deltaUV = dir * stepSizeUV;
+
+			// Sample the pixels along the direction
+			ao += HorizonOcclusion(deltaUV, P, dPdu, dPdv, random.z, numSteps);
+		}
+
+		// Average the results and produce the final AO
+		ao = 1.0 - ao / NUM_DIRECTIONS * AOStrength;
+	}
+
+	return vec2(ao, 30.0 * P.z);
+}
+
+void main()
+{
+	LoadDepthTile();
+
+	// pixels of an invocation are GROUP_SIZE apart, neighbouring invocations shade neighbouring pixels
+	ivec2 size = imageSize(aoOutput);
+	for (int i = 0; i < PIXELS_PER_THREAD * PIXELS_PER_THREAD; i++)
+	{
+		ivec2 pixel = ivec2(gl_WorkGroupID.xy) * TILE_SIZE + ivec2(gl_LocalInvocationID.xy) +
+			GROUP_SIZE * ivec2(i % PIXELS_PER_THREAD, i / PIXELS_PER_THREAD);
+		if (all(lessThan(pixel, size)))
+			imageStore(aoOutput, pixel, vec4(ComputeAO(pixel), 0.0, 0.0));
+	}
+}
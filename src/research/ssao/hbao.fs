@@ -4,20 +4,34 @@
 #version 330 core
 
 const float PI = 3.14159265;
-const float SCREEN_WIDTH = 1600;
-const float SCREEN_HEIGHT = 900;
 
-uniform sampler2D gDepth;
+#ifdef DEINTERLEAVED
+// one of the 4x4 layers of view space depth (deinterleave.fs), TexCoord addresses the layer
+uniform sampler2DArray layerDepth;
+uniform int layer;
+// uv of the full image = layer uv * LayerScale + LayerOffset
+uniform vec2 LayerScale;
+uniform vec2 LayerOffset;
+// noise of the layer's pixels, the same for all of them
+uniform vec4 jitter;
+#else
+// linear depth (ao_downsample.fs) or the G-buffer depth (HARDWARE_DEPTH), a linear depth mip chain when DEPTH_PYRAMID
+// is defined (depth_pyramid.fs):
+// samples farther away then read coarser levels
+uniform sampler2D linearDepth;
+// near and far plane of the linear depth
+uniform vec2 clipPlanes;
 uniform sampler2D texNoise;
+#endif
 
 uniform vec2 FocalLen;
 uniform vec2 UVToViewA;
 uniform vec2 UVToViewB;
-uniform vec2 LinMAD;
 
-uniform vec2 AORes = vec2(SCREEN_WIDTH, SCREEN_HEIGHT);
-uniform vec2 InvAORes = vec2(1.0 / SCREEN_WIDTH, 1.0/ SCREEN_HEIGHT);
-uniform vec2 NoiseScale = vec2(SCREEN_WIDTH, SCREEN_HEIGHT) / 4.0;
+// set by the application for the current AO resolution (of a layer when deinterleaved)
+uniform vec2 AORes;
+uniform vec2 InvAORes;
+uniform vec2 NoiseScale;
 
 uniform float AOStrength = 1.9;
 uniform float R = 0.3;
@@ -26,37 +40,78 @@ uniform float NegInvR2 = - 1.0 / (0.3*0.3);
 uniform float TanBias = tan(30.0 * PI / 180.0);
 uniform float MaxRadiusPixels = 100.0;
 
-uniform int NumDirections = 8;
-uniform int NumSamples = 4;
+// loop counts are specialized by the application (HBAO_DIRS, HBAO_SAMPLES)
+#ifndef NUM_DIRECTIONS
+#define NUM_DIRECTIONS 8
+#endif
+#ifndef NUM_STEPS
+#define NUM_STEPS 4
+#endif
 
 in vec2 TexCoord;
 
 out vec2 FragColor;
 
-float ViewSpaceZFromDepth(float d)
-{
-	d = d * 2.0 - 1.0;
-	return -1.0 / (LinMAD.x * d + LinMAD.y);
-}
-
 vec3 UVToViewSpace(vec2 uv, float z)
 {
 	uv = UVToViewA * uv + UVToViewB;
 	return vec3(uv * z, z);
 }
 
+#ifdef DEINTERLEAVED
 vec3 GetViewPos(vec2 uv)
 {
-	float z = ViewSpaceZFromDepth(texture(gDepth, uv).r);
+	float z = texture(layerDepth, vec3(uv, layer)).r;
+	return UVToViewSpace(uv * LayerScale + LayerOffset, z);
+}
+#elif defined(DEPTH_PYRAMID)
+// last level of the pyramid, fewer than DEPTH_PYRAMID_LEVELS at small AO resolutions
+uniform int depthPyramidMaxLevel;
+
+// mip 0 for samples up to 8 pixels away, one level coarser per doubling of the distance
+int DepthPyramidLevel(float pixelDistance)
+{
+	return clamp(int(log2(max(pixelDistance, 1.0))) - 3, 0, depthPyramidMaxLevel);
+}
+
+// nearest texel of the level, like texture() on mip 0
+float DepthPyramidFetch(vec2 uv, int level)
+{
+	ivec2 size = textureSize(linearDepth, level);
+	return texelFetch(linearDepth, clamp(ivec2(uv * vec2(size)), ivec2(0), size - 1), level).r;
+}
+
+vec3 GetViewPos(vec2 uv)
+{
+	float d = DepthPyramidFetch(uv, DepthPyramidLevel(length((uv - TexCoord) * AORes)));
+	float z = -(clipPlanes.x + d * (clipPlanes.y - clipPlanes.x));
 	return UVToViewSpace(uv, z);
 }
+#else
+#ifdef HARDWARE_DEPTH
+// the input is the G-buffer's depth buffer (AO at the render resolution), linearized like ao_downsample.fs does
+uniform vec2 LinMAD;
+
+float LinearizeDepth(float depth)
+{
+	if (depth == 1.0)
+		return 1.0; // far plane, nothing rendered
+	return (1.0 / (LinMAD.x * (depth * 2.0 - 1.0) + LinMAD.y) - clipPlanes.x) / (clipPlanes.y - clipPlanes.x);
+}
+#else
+float LinearizeDepth(float depth)
+{
+	return depth;
+}
+#endif
 
-vec3 GetViewPosPoint(ivec2 uv)
+vec3 GetViewPos(vec2 uv)
 {
-	ivec2 coord = ivec2(gl_FragCoord.xy) + uv;
-	float z = texelFetch(gDepth, coord, 0).r;
+	float d = LinearizeDepth(texture(linearDepth, uv).r);
+	float z = -(clipPlanes.x + d * (clipPlanes.y - clipPlanes.x));
 	return UVToViewSpace(uv, z);
 }
+#endif
 
 float TanToSin(float x)
 {
@@ -161,7 +216,7 @@ vec2 RotateDirections(vec2 Dir, vec2 CosSin)
 void ComputeSteps(inout vec2 stepSizeUv, inout float numSteps, float rayRadiusPix, float rand)
 {
     // Avoid oversampling if numSteps is greater than the kernel radius in pixels
-    numSteps = min(NumSamples, rayRadiusPix);
+    numSteps = min(float(NUM_STEPS), rayRadiusPix);
 
     // Divide by Ns+1 so that the farthest samples are not fully attenuated
     float stepSizePix = rayRadiusPix / (numSteps + 1);
@@ -182,7 +237,7 @@ void ComputeSteps(inout vec2 stepSizeUv, inout float numSteps, float rayRadiusPi
 
 void main(void)
 {
-	float numDirections = NumDirections;
+	float numDirections = NUM_DIRECTIONS;
 
 	vec3 P, Pr, Pl, Pt, Pb;
 	P 	= GetViewPos(TexCoord);
@@ -198,7 +253,11 @@ void main(void)
     vec3 dPdv = MinDiff(P, Pt, Pb) * (AORes.y * InvAORes.x);
 
     // Get the random samples from the noise texture
+#ifdef DEINTERLEAVED
+	vec3 random = jitter.rgb;
+#else
 	vec3 random = texture(texNoise, TexCoord.xy * NoiseScale).rgb;
+#endif
 
 	// Calculate the projected size of the hemisphere
     vec2 rayRadiusUV = 0.5 * R * FocalLen / -P.z;
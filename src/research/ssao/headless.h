@@ -0,0 +1,115 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+// Offscreen OpenGL context for running the research benchmark without a display.
+// Uses EGL with the Mesa surfaceless platform (works with llvmpipe on machines without GPU),
+// falls back to the default EGL display if the surfaceless platform is not exposed.
+// Only available when the project is configured with EGL support (HEADLESS_EGL).
+
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+#include <iostream>
+
+class HeadlessContext
+{
+public:
+    static bool isSupported()
+    {
+#ifdef HEADLESS_EGL
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    // creates the context and makes it current, the context has no default framebuffer.
+    // Falls back to the minimum version if the driver does not offer the preferred one.
+    bool create(int majorVersion, int minorVersion, int minMajorVersion, int minMinorVersion)
+    {
+#ifdef HEADLESS_EGL
+        auto eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+        if (eglGetPlatformDisplayEXT != nullptr)
+            display = eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        if (display == EGL_NO_DISPLAY)
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+        EGLint eglMajor, eglMinor;
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, &eglMajor, &eglMinor))
+        {
+            std::cout << "Failed to initialize EGL display" << std::endl;
+            return false;
+        }
+        if (!eglBindAPI(EGL_OPENGL_API))
+        {
+            std::cout << "EGL does not support desktop OpenGL" << std::endl;
+            return false;
+        }
+
+        // surfaceless platform may report no configs at all, which is fine as we never create a surface
+        EGLint configAttribs[] = { EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+        EGLConfig config = (EGLConfig)0;
+        EGLint numConfigs = 0;
+        eglChooseConfig(display, configAttribs, &config, 1, &numConfigs);
+
+        for (int attempt = 0; attempt < 2 && context == EGL_NO_CONTEXT; attempt++)
+        {
+            EGLint contextAttribs[] = {
+                EGL_CONTEXT_MAJOR_VERSION, attempt == 0 ? majorVersion : minMajorVersion,
+                EGL_CONTEXT_MINOR_VERSION, attempt == 0 ? minorVersion : minMinorVersion,
+                EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+                EGL_NONE
+            };
+            context = eglCreateContext(display, numConfigs > 0 ? config : (EGLConfig)0, EGL_NO_CONTEXT, contextAttribs);
+        }
+        if (context == EGL_NO_CONTEXT)
+        {
+            std::cout << "Failed to create EGL context (error 0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+            return false;
+        }
+        if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context))
+        {
+            std::cout << "Failed to make EGL context current (surfaceless contexts not supported?)" << std::endl;
+            return false;
+        }
+        return true;
+#else
+        std::cout << "Headless mode is not available: project was built without EGL" << std::endl;
+        return false;
+#endif
+    }
+
+    void destroy()
+    {
+#ifdef HEADLESS_EGL
+        if (display != EGL_NO_DISPLAY)
+        {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            if (context != EGL_NO_CONTEXT)
+                eglDestroyContext(display, context);
+            eglTerminate(display);
+        }
+        display = EGL_NO_DISPLAY;
+        context = EGL_NO_CONTEXT;
+#endif
+    }
+
+    static void* getProcAddress(const char* name)
+    {
+#ifdef HEADLESS_EGL
+        return (void*)eglGetProcAddress(name);
+#else
+        return nullptr;
+#endif
+    }
+
+private:
+#ifdef HEADLESS_EGL
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+#endif
+};
+
+#endif
@@ -6,6 +6,7 @@ in vec2 TexCoord;
 uniform sampler2D gAlbedo;
 uniform sampler2D gNormal;
 uniform sampler2D ao;
+uniform bool bakedAO; // RenderMode::BAKED: AO is the per-vertex bake in the albedo alpha
 
 vec3 lightInvDirection = vec3(0, 1, 0);
 
@@ -13,8 +14,9 @@ void main()
 {             
     // retrieve data from gbuffer
     vec3 Normal = texture(gNormal, TexCoord).rgb;
-    vec3 Diffuse = texture(gAlbedo, TexCoord).rgb;
-    float AmbientOcclusion = texture(ao, TexCoord).r;
+    vec4 Albedo = texture(gAlbedo, TexCoord);
+    vec3 Diffuse = Albedo.rgb;
+    float AmbientOcclusion = bakedAO ? Albedo.a : texture(ao, TexCoord).r;
     
     float diffuseFactor = 0.5 * dot(Normal, lightInvDirection);
     float ambientFactor = 0.2;
@@ -0,0 +1,38 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// number of worker threads used by the CPU AO code, at least one
+inline int getHardwareThreadCount()
+{
+    return std::max(1, (int)std::thread::hardware_concurrency());
+}
+
+// Calls body(index) for every index in [0, count) on threadCount threads (all hardware threads by default)
+// and returns when all of them are done. Indices are handed out one at a time, so uneven work
+// (e.g. image rows with and without geometry) is balanced between the threads.
+template <typename Body>
+void parallelFor(int count, const Body& body, int threadCount = 0)
+{
+    if (threadCount <= 0)
+        threadCount = getHardwareThreadCount();
+    threadCount = std::min(threadCount, count);
+    std::atomic<int> next(0);
+    auto worker = [&]()
+    {
+        for (int index = next++; index < count; index = next++)
+            body(index);
+    };
+    std::vector<std::thread> threads;
+    for (int i = 1; i < threadCount; i++)
+        threads.emplace_back(worker);
+    worker();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+#endif
@@ -0,0 +1,175 @@
+#ifndef PARAMETER_SWEEP_H
+#define PARAMETER_SWEEP_H
+
+#include "benchmark_report.h"
+
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+
+// values a single AO parameter takes during the sweep
+struct SweepParameter
+{
+    std::string name;
+    std::vector<double> values;
+};
+
+// measured cost of a single point of the sweep
+struct SweepResult
+{
+    std::string resolution;
+    std::vector<double> values; // one per parameter
+    TimingStats ao;
+    TimingStats frame;
+};
+
+// Cartesian product of AO parameter values for a single render mode, every point is rendered and timed
+// separately and the results are written as a cost matrix (one row per point).
+// Spec file is plain text, lines starting with '#' are ignored:
+//   mode hbao
+//   directions 2..16    <- lo..hi doubles the value up to hi: 2 4 8 16
+//   steps 2 4 6 8       <- explicit list of values
+//   radius 0.2 0.4
+class ParameterSweep
+{
+public:
+    std::string mode;
+    std::vector<SweepParameter> parameters;
+    std::vector<SweepResult> results;
+
+    bool load(const std::string& path)
+    {
+        std::ifstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::PARAMETER_SWEEP::FAILED_TO_READ: " << path << std::endl;
+            return false;
+        }
+        mode.clear();
+        parameters.clear();
+        std::string line;
+        while (std::getline(file, line))
+        {
+            line = line.substr(0, line.find('#'));
+            std::istringstream stream(line);
+            std::string name;
+            if (!(stream >> name))
+                continue;
+            if (name == "mode")
+            {
+                stream >> mode;
+                continue;
+            }
+            SweepParameter parameter;
+            parameter.name = name;
+            std::string token;
+            while (stream >> token)
+            {
+                if (!parseValues(token, parameter.values))
+                {
+                    std::cout << "ERROR::PARAMETER_SWEEP::INVALID_VALUE: " << name << " " << token << std::endl;
+                    return false;
+                }
+            }
+            if (parameter.values.empty())
+            {
+                std::cout << "ERROR::PARAMETER_SWEEP::NO_VALUES: " << name << std::endl;
+                return false;
+            }
+            parameters.push_back(parameter);
+        }
+        if (mode.empty() || parameters.empty())
+        {
+            std::cout << "ERROR::PARAMETER_SWEEP::EMPTY_SPEC: " << path << " (needs a mode and at least one parameter)" << std::endl;
+            return false;
+        }
+        return true;
+    }
+
+    // number of points, product of the value counts of all parameters
+    size_t size() const
+    {
+        size_t count = 1;
+        for (const auto& parameter : parameters)
+            count *= parameter.values.size();
+        return count;
+    }
+
+    // parameter values of the given point, the last parameter changes the fastest
+    std::vector<double> point(size_t index) const
+    {
+        std::vector<double> values(parameters.size());
+        for (size_t i = parameters.size(); i-- > 0;)
+        {
+            const auto& parameterValues = parameters[i].values;
+            values[i] = parameterValues[index % parameterValues.size()];
+            index /= parameterValues.size();
+        }
+        return values;
+    }
+
+    void addResult(const std::string& resolution, const std::vector<double>& values, const std::vector<double>& aoTimesMs, const std::vector<double>& frameTimesMs)
+    {
+        results.push_back({ resolution, values, TimingStats::compute(aoTimesMs), TimingStats::compute(frameTimesMs) });
+    }
+
+    // one row per point and resolution: resolution and parameter values followed by AO and frame time statistics
+    bool writeCostMatrix(const std::string& path, const std::vector<std::pair<std::string, std::string>>& metadata) const
+    {
+        std::ofstream file(path);
+        if (!file)
+        {
+            std::cout << "ERROR::PARAMETER_SWEEP::FAILED_TO_WRITE: " << path << std::endl;
+            return false;
+        }
+        file << "# mode: " << mode << "\n";
+        for (const auto& entry : metadata)
+            file << "# " << entry.first << ": " << entry.second << "\n";
+        file << "resolution,";
+        for (const auto& parameter : parameters)
+            file << parameter.name << ",";
+        file << "frames,ao_avg_ms,ao_dev_ms,ao_p50_ms,ao_p90_ms,ao_p99_ms,frame_avg_ms,ao_frame_fraction\n";
+        for (const auto& result : results)
+        {
+            file << result.resolution << ",";
+            for (double value : result.values)
+                file << value << ",";
+            file << result.ao.count << "," << result.ao.average << "," << result.ao.deviation << ","
+                 << result.ao.p50 << "," << result.ao.p90 << "," << result.ao.p99 << ","
+                 << result.frame.average << "," << (result.frame.average > 0.0 ? result.ao.average / result.frame.average : 0.0) << "\n";
+        }
+        return true;
+    }
+
+private:
+    // single value or lo..hi doubling range
+    static bool parseValues(const std::string& token, std::vector<double>& values)
+    {
+        size_t range = token.find("..");
+        char* end = nullptr;
+        if (range == std::string::npos)
+        {
+            double value = strtod(token.c_str(), &end);
+            if (*end != '\0')
+                return false;
+            values.push_back(value);
+            return true;
+        }
+        std::string loToken = token.substr(0, range);
+        std::string hiToken = token.substr(range + 2);
+        double lo = strtod(loToken.c_str(), &end);
+        if (loToken.empty() || *end != '\0' || lo <= 0.0)
+            return false;
+        double hi = strtod(hiToken.c_str(), &end);
+        if (hiToken.empty() || *end != '\0' || hi < lo)
+            return false;
+        for (double value = lo; value <= hi; value *= 2.0)
+            values.push_back(value);
+        return true;
+    }
+};
+
+#endif
@@ -0,0 +1,192 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "gpu_timer.h"
+
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+const int PROFILER_MAX_TIMESTAMPS_PER_FRAME = 128;
+
+// timings of a zone of a finished frame, name is the full path of the zone (e.g. "gbuffer/model0/mesh2")
+// without the implicit "frame" root zone
+struct ProfileZoneResult
+{
+    std::string name;
+    int depth;
+    double gpuMs; // negative for CPU only zones
+    double cpuMs;
+};
+
+// Collects nested CPU and GPU timing zones of every frame. GPU zones are timed with timestamp
+// queries of a GpuTimerRing, so their results (together with the CPU timings of the same frame)
+// become available a few frames later without stalling the pipeline.
+// Every frame is an implicit "frame" zone (GPU time and CPU time spent recording it), which is
+// the first result of a frame and the parent of all zones opened between beginFrame and endFrame.
+template <typename FrameInfo>
+class Profiler
+{
+public:
+    Profiler(int framesInFlight = GPU_TIMER_FRAMES_IN_FLIGHT)
+        : gpuTimers(PROFILER_MAX_TIMESTAMPS_PER_FRAME, framesInFlight)
+    {
+    }
+
+    void beginFrame(const FrameInfo& info)
+    {
+        gpuTimers.beginFrame({ info, {} });
+        stack.clear();
+        beginZone("frame", true);
+    }
+
+    // state of the frame being recorded, can be updated until endFrame
+    FrameInfo& currentFrameInfo()
+    {
+        return gpuTimers.currentFrame().info;
+    }
+
+    void endFrame()
+    {
+        while (!stack.empty())
+            endZone();
+        gpuTimers.endFrame();
+    }
+
+    void beginZone(const std::string& name, bool gpu)
+    {
+        std::vector<Zone>& zones = gpuTimers.currentFrame().zones;
+        Zone zone;
+        zone.name = stack.size() > 1 ? zones[stack.back()].name + "/" + name : name;
+        zone.depth = (int)stack.size();
+        zone.gpuBegin = gpu ? timestamp(zone.name) : -1;
+        zone.gpuEnd = -1;
+        zone.cpuBegin = now();
+        zone.cpuEnd = zone.cpuBegin;
+        stack.push_back((int)zones.size());
+        zones.push_back(zone);
+    }
+
+    void endZone()
+    {
+        Zone& zone = gpuTimers.currentFrame().zones[stack.back()];
+        stack.pop_back();
+        zone.cpuEnd = now();
+        if (zone.gpuBegin >= 0)
+            zone.gpuEnd = timestamp(zone.name);
+    }
+
+    // returns zones of the oldest finished frame in the order they were opened
+    bool popFrame(FrameInfo& info, std::vector<ProfileZoneResult>& results)
+    {
+        if (!gpuTimers.popFrame(poppedFrame, timestamps))
+            return false;
+
+        info = poppedFrame.info;
+        results.resize(poppedFrame.zones.size());
+        for (size_t i = 0; i < poppedFrame.zones.size(); i++)
+        {
+            const Zone& zone = poppedFrame.zones[i];
+            ProfileZoneResult& result = results[i];
+            result.name = zone.name;
+            result.depth = zone.depth;
+            result.cpuMs = (zone.cpuEnd - zone.cpuBegin) * 1000.0;
+            result.gpuMs = -1.0;
+            if (zone.gpuBegin >= 0 && zone.gpuEnd >= 0)
+                result.gpuMs = (timestamps[zone.gpuEnd] - timestamps[zone.gpuBegin]) / 1000000.0;
+        }
+        return true;
+    }
+
+    bool hasPendingFrames() const
+    {
+        return gpuTimers.hasPendingFrames();
+    }
+
+    int getDroppedFrames() const
+    {
+        return gpuTimers.getDroppedFrames();
+    }
+
+private:
+    struct Zone
+    {
+        std::string name;
+        int depth;
+        int gpuBegin;
+        int gpuEnd;
+        double cpuBegin;
+        double cpuEnd;
+    };
+
+    struct Frame
+    {
+        FrameInfo info;
+        std::vector<Zone> zones;
+    };
+
+    GpuTimerRing<Frame> gpuTimers;
+    std::vector<int> stack;
+    Frame poppedFrame;
+    std::vector<uint64_t> timestamps;
+    bool reportedTimestampOverflow = false;
+
+    // -1 once the frame used all its timestamp queries, the zone then only gets a CPU time; reported once per run
+    int timestamp(const std::string& zoneName)
+    {
+        int index = gpuTimers.timestamp();
+        if (index < 0 && !reportedTimestampOverflow)
+        {
+            std::cout << "ERROR::PROFILER::OUT_OF_TIMESTAMPS: " << zoneName << " and later zones of the frame are CPU only, frames have "
+                      << PROFILER_MAX_TIMESTAMPS_PER_FRAME << " timestamps (PROFILER_MAX_TIMESTAMPS_PER_FRAME)" << std::endl;
+            reportedTimestampOverflow = true;
+        }
+        return index;
+    }
+
+    static double now()
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+};
+
+// times the enclosing scope on the GPU and the CPU time spent recording it
+template <typename FrameInfo>
+class ScopedGpuZone
+{
+public:
+    ScopedGpuZone(Profiler<FrameInfo>& profiler, const std::string& name) : profiler(profiler)
+    {
+        profiler.beginZone(name, true);
+    }
+
+    ~ScopedGpuZone()
+    {
+        profiler.endZone();
+    }
+
+private:
+    Profiler<FrameInfo>& profiler;
+};
+
+// times the enclosing scope on the CPU only
+template <typename FrameInfo>
+class ScopedCpuZone
+{
+public:
+    ScopedCpuZone(Profiler<FrameInfo>& profiler, const std::string& name) : profiler(profiler)
+    {
+        profiler.beginZone(name, false);
+    }
+
+    ~ScopedCpuZone()
+    {
+        profiler.endZone();
+    }
+
+private:
+    Profiler<FrameInfo>& profiler;
+};
+
+#endif
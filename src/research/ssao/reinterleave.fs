@@ -0,0 +1,13 @@
+#version 330 core
+
+// Gathers the AO of the 4x4 deinterleaved layers back into a single image of the AO resolution
+out vec2 FragColor;
+
+uniform sampler2DArray aoLayers;
+
+void main()
+{
+    ivec2 coord = ivec2(gl_FragCoord.xy);
+    ivec2 layer = coord % 4;
+    FragColor = texelFetch(aoLayers, ivec3(coord / 4, layer.x + 4 * layer.y), 0).rg;
+}
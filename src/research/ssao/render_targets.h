@@ -0,0 +1,264 @@
+#ifndef RENDER_TARGETS_H
+#define RENDER_TARGETS_H
+
+#include <glad/glad.h>
+
+#include <algorithm>
+#include <iterator>
+#include <iostream>
+
+// deinterleaved AO splits the AO resolution into DEINTERLEAVE_FACTOR x DEINTERLEAVE_FACTOR layers,
+// layer x + DEINTERLEAVE_FACTOR * y holds the pixels (x, y) modulo DEINTERLEAVE_FACTOR
+const unsigned int DEINTERLEAVE_FACTOR = 4;
+const unsigned int DEINTERLEAVE_LAYERS = DEINTERLEAVE_FACTOR * DEINTERLEAVE_FACTOR;
+// layers written by one deinterleave pass, GL 3.3 guarantees 8 draw buffers
+const unsigned int DEINTERLEAVE_LAYERS_PER_PASS = 8;
+const unsigned int DEINTERLEAVE_PASSES = DEINTERLEAVE_LAYERS / DEINTERLEAVE_LAYERS_PER_PASS;
+// mip levels of the depth pyramid, AO samples up to 8 << (levels - 1) pixels away read a level of their own
+const unsigned int DEPTH_PYRAMID_LEVELS = 6;
+
+// G-buffer, AO and screen framebuffers. The AO passes run at 1 / aoScale of the render resolution (rounded up),
+// everything else at the render resolution.
+// Recreated from scratch whenever the resolution changes (window resize or headless resolution runs).
+struct RenderTargets
+{
+    unsigned int width = 0;
+    unsigned int height = 0;
+    unsigned int aoScale = 1;
+    unsigned int aoWidth = 0;
+    unsigned int aoHeight = 0;
+    unsigned int layerWidth = 0;
+    unsigned int layerHeight = 0;
+    unsigned int depthPyramidLevels = 0;
+
+    unsigned int gBuffer = 0;
+    unsigned int gAlbedo = 0;
+    unsigned int gNormal = 0;
+    unsigned int gDepth = 0;
+
+    // inputs of the AO passes with aoScale > 1: the linear depth (view depth - near) / (far - near) and the
+    // G-buffer normals at the AO resolution (ao_downsample.fs). With aoScale 1 the AO passes read gDepth and
+    // gNormal directly and linearize the depth themselves (HARDWARE_DEPTH)
+    unsigned int aoInputFBO = 0;
+    unsigned int linearDepth = 0;
+    unsigned int aoNormal = 0;
+
+    // view space depth at the AO resolution split into DEINTERLEAVE_LAYERS layers of layerWidth x layerHeight
+    // and the AO of every layer (deinterleaved SSAO and HBAO)
+    unsigned int deinterleaveFBOs[DEINTERLEAVE_PASSES] = {};
+    unsigned int depthLayers = 0;
+    unsigned int aoLayerFBOs[DEINTERLEAVE_LAYERS] = {};
+    unsigned int aoLayers = 0;
+
+    // linear depth at the AO resolution with a mip chain (depth_pyramid.fs), a framebuffer per level
+    unsigned int depthPyramidFBOs[DEPTH_PYRAMID_LEVELS] = {};
+    unsigned int depthPyramid = 0;
+
+    // AO and the depth packed next to it (30 * view space z), blurred in x into ssaoColorBufferBlurX
+    // and from there in y into ssaoColorBufferBlur
+    unsigned int ssaoFBO = 0;
+    unsigned int ssaoBlurXFBO = 0;
+    unsigned int ssaoBlurFBO = 0;
+    unsigned int ssaoColorBuffer = 0;
+    unsigned int ssaoColorBufferBlurX = 0;
+    unsigned int ssaoColorBufferBlur = 0;
+
+    // AO upsampled to the render resolution (ao_upsample.fs), only with aoScale > 1
+    unsigned int aoUpsampleFBO = 0;
+    unsigned int aoUpsampled = 0;
+
+    // headless context has no default framebuffer, final image goes into an offscreen one (0 otherwise)
+    unsigned int screenFBO = 0;
+    unsigned int screenColorBuffer = 0;
+    unsigned int screenDepthBuffer = 0;
+
+    void create(unsigned int targetWidth, unsigned int targetHeight, unsigned int targetAOScale, bool offscreen)
+    {
+        destroy();
+        width = targetWidth;
+        height = targetHeight;
+        aoScale = targetAOScale;
+        aoWidth = (width + aoScale - 1) / aoScale;
+        aoHeight = (height + aoScale - 1) / aoScale;
+        layerWidth = (aoWidth + DEINTERLEAVE_FACTOR - 1) / DEINTERLEAVE_FACTOR;
+        layerHeight = (aoHeight + DEINTERLEAVE_FACTOR - 1) / DEINTERLEAVE_FACTOR;
+
+        // configure g-buffer framebuffer
+        // ------------------------------
+        glGenFramebuffers(1, &gBuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
+        // color + specular color buffer
+        gAlbedo = createTexture(width, height, GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gAlbedo, 0);
+        // normal color buffer
+        gNormal = createTexture(width, height, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
+        // depth buffer
+        gDepth = createTexture(width, height, GL_DEPTH_COMPONENT, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gDepth, 0);
+        // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering
+        unsigned int attachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+        glDrawBuffers(std::size(attachments), attachments);
+        // finally check if framebuffer is complete
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "Framebuffer not complete!" << std::endl;
+
+        if (aoScale > 1)
+        {
+            glGenFramebuffers(1, &aoInputFBO);
+            glBindFramebuffer(GL_FRAMEBUFFER, aoInputFBO);
+            linearDepth = createTexture(aoWidth, aoHeight, GL_R32F, GL_RED, GL_FLOAT);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, linearDepth, 0);
+            aoNormal = createTexture(aoWidth, aoHeight, GL_RGBA16F, GL_RGBA, GL_FLOAT);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, aoNormal, 0);
+            glDrawBuffers(std::size(attachments), attachments);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "AO input Framebuffer not complete!" << std::endl;
+
+            glGenFramebuffers(1, &aoUpsampleFBO);
+            glBindFramebuffer(GL_FRAMEBUFFER, aoUpsampleFBO);
+            aoUpsampled = createTexture(width, height, GL_R16F, GL_RED, GL_FLOAT);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, aoUpsampled, 0);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "AO upsample Framebuffer not complete!" << std::endl;
+        }
+
+        // deinterleaved depth and AO layers
+        depthLayers = createTextureArray(GL_R32F, GL_RED);
+        glGenFramebuffers(DEINTERLEAVE_PASSES, deinterleaveFBOs);
+        for (unsigned int pass = 0; pass < DEINTERLEAVE_PASSES; pass++)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, deinterleaveFBOs[pass]);
+            unsigned int layerAttachments[DEINTERLEAVE_LAYERS_PER_PASS];
+            for (unsigned int i = 0; i < DEINTERLEAVE_LAYERS_PER_PASS; i++)
+            {
+                glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, depthLayers, 0, pass * DEINTERLEAVE_LAYERS_PER_PASS + i);
+                layerAttachments[i] = GL_COLOR_ATTACHMENT0 + i;
+            }
+            glDrawBuffers(DEINTERLEAVE_LAYERS_PER_PASS, layerAttachments);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "Deinterleave Framebuffer not complete!" << std::endl;
+        }
+        aoLayers = createTextureArray(GL_RG16F, GL_RG);
+        glGenFramebuffers(DEINTERLEAVE_LAYERS, aoLayerFBOs);
+        for (unsigned int layer = 0; layer < DEINTERLEAVE_LAYERS; layer++)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, aoLayerFBOs[layer]);
+            glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, aoLayers, 0, layer);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "AO layer Framebuffer not complete!" << std::endl;
+        }
+
+        // depth pyramid, down to 1x1 at small resolutions
+        depthPyramidLevels = 1;
+        while (depthPyramidLevels < DEPTH_PYRAMID_LEVELS && (std::max(aoWidth, aoHeight) >> depthPyramidLevels) > 0)
+            depthPyramidLevels++;
+        glGenTextures(1, &depthPyramid);
+        glBindTexture(GL_TEXTURE_2D, depthPyramid);
+        for (unsigned int level = 0; level < depthPyramidLevels; level++)
+            glTexImage2D(GL_TEXTURE_2D, level, GL_R32F, getDepthPyramidWidth(level), getDepthPyramidHeight(level), 0, GL_RED, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, depthPyramidLevels - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glGenFramebuffers(depthPyramidLevels, depthPyramidFBOs);
+        for (unsigned int level = 0; level < depthPyramidLevels; level++)
+        {
+            glBindFramebuffer(GL_FRAMEBUFFER, depthPyramidFBOs[level]);
+            glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, depthPyramid, level);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "Depth pyramid Framebuffer not complete!" << std::endl;
+        }
+
+        // also create framebuffer to hold SSAO processing stage
+        // -----------------------------------------------------
+        glGenFramebuffers(1, &ssaoFBO);
+        glGenFramebuffers(1, &ssaoBlurXFBO);
+        glGenFramebuffers(1, &ssaoBlurFBO);
+        glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
+        // SSAO color buffer
+        ssaoColorBuffer = createTexture(aoWidth, aoHeight, GL_RG16F, GL_RG, GL_FLOAT);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBuffer, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "SSAO Framebuffer not complete!" << std::endl;
+        // and the two blur stages
+        glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurXFBO);
+        ssaoColorBufferBlurX = createTexture(aoWidth, aoHeight, GL_RG16F, GL_RG, GL_FLOAT);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBufferBlurX, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "SSAO Blur X Framebuffer not complete!" << std::endl;
+        glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
+        ssaoColorBufferBlur = createTexture(aoWidth, aoHeight, GL_RG16F, GL_RG, GL_FLOAT);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBufferBlur, 0);
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+            std::cout << "SSAO Blur Framebuffer not complete!" << std::endl;
+
+        if (offscreen)
+        {
+            glGenFramebuffers(1, &screenFBO);
+            glBindFramebuffer(GL_FRAMEBUFFER, screenFBO);
+            glGenRenderbuffers(1, &screenColorBuffer);
+            glBindRenderbuffer(GL_RENDERBUFFER, screenColorBuffer);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, screenColorBuffer);
+            glGenRenderbuffers(1, &screenDepthBuffer);
+            glBindRenderbuffer(GL_RENDERBUFFER, screenDepthBuffer);
+            glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+            glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, screenDepthBuffer);
+            if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+                std::cout << "Screen Framebuffer not complete!" << std::endl;
+        }
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    }
+
+    unsigned int getDepthPyramidWidth(unsigned int level) const
+    {
+        return std::max(aoWidth >> level, 1u);
+    }
+
+    unsigned int getDepthPyramidHeight(unsigned int level) const
+    {
+        return std::max(aoHeight >> level, 1u);
+    }
+
+    void destroy()
+    {
+        unsigned int framebuffers[] = { gBuffer, aoInputFBO, ssaoFBO, ssaoBlurXFBO, ssaoBlurFBO, aoUpsampleFBO, screenFBO };
+        unsigned int textures[] = { gAlbedo, gNormal, gDepth, linearDepth, aoNormal, depthLayers, aoLayers, depthPyramid,
+            ssaoColorBuffer, ssaoColorBufferBlurX, ssaoColorBufferBlur, aoUpsampled };
+        unsigned int renderbuffers[] = { screenColorBuffer, screenDepthBuffer };
+        // zero names are silently ignored
+        glDeleteFramebuffers(std::size(framebuffers), framebuffers);
+        glDeleteFramebuffers(std::size(deinterleaveFBOs), deinterleaveFBOs);
+        glDeleteFramebuffers(std::size(aoLayerFBOs), aoLayerFBOs);
+        glDeleteFramebuffers(std::size(depthPyramidFBOs), depthPyramidFBOs);
+        glDeleteTextures(std::size(textures), textures);
+        glDeleteRenderbuffers(std::size(renderbuffers), renderbuffers);
+        *this = RenderTargets();
+    }
+
+private:
+    unsigned int createTexture(unsigned int textureWidth, unsigned int textureHeight, GLint internalFormat, GLenum format, GLenum type) const
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D, texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, textureWidth, textureHeight, 0, format, type, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        return texture;
+    }
+
+    // DEINTERLEAVE_LAYERS layers of layerWidth x layerHeight
+    unsigned int createTextureArray(GLint internalFormat, GLenum format) const
+    {
+        unsigned int texture;
+        glGenTextures(1, &texture);
+        glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+        glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, internalFormat, layerWidth, layerHeight, DEINTERLEAVE_LAYERS, 0, format, GL_FLOAT, NULL);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        return texture;
+    }
+};
+
+#endif
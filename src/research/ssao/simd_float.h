@@ -0,0 +1,344 @@
+#ifndef SIMD_FLOAT_H
+#define SIMD_FLOAT_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define SIMD_FLOAT_SSE2
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SIMD_FLOAT_NEON
+#endif
+
+#if defined(__SSE4_1__)
+#include <smmintrin.h>
+#define SIMD_FLOAT_SSE41
+#endif
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_FLOAT_AVX2
+#endif
+
+#if defined(__AVX512F__)
+#define SIMD_FLOAT_AVX512
+#endif
+
+// Everything compiled for a given instruction set lives in its own namespace, so translation units built with
+// different -m flags (ssao_kernels_*.cpp, see cpu_dispatch.h) never share a symbol for the same template instance.
+#if defined(SIMD_FLOAT_AVX512)
+#define SIMD_FLOAT_NAMESPACE simd_avx512
+#elif defined(SIMD_FLOAT_AVX2)
+#define SIMD_FLOAT_NAMESPACE simd_avx2
+#elif defined(__SSE4_2__)
+#define SIMD_FLOAT_NAMESPACE simd_sse42
+#elif defined(SIMD_FLOAT_SSE2)
+#define SIMD_FLOAT_NAMESPACE simd_sse2
+#elif defined(SIMD_FLOAT_NEON)
+#define SIMD_FLOAT_NAMESPACE simd_neon
+#else
+#define SIMD_FLOAT_NAMESPACE simd_scalar
+#endif
+
+// Minimal float vectors for the CPU AO kernels. Kernels are templates over the vector type, so the same
+// code processes 16 (AVX-512), 8 (AVX2), 4 (SSE2 / NEON) or 1 (FloatScalar) lanes at a time.
+// Comparisons return a lane mask in a vector of the same type, which can only be combined with & and ifThen.
+// max returns the second argument for NaN lanes of the first one, like maxps.
+namespace SIMD_FLOAT_NAMESPACE
+{
+
+// one lane, reference for the wider types and fallback for other architectures
+struct FloatScalar
+{
+    static const int WIDTH = 1;
+    float v;
+
+    FloatScalar() = default;
+    FloatScalar(float value) : v(value) {}
+
+    static FloatScalar load(const float* p) { return FloatScalar(*p); }
+    // base[index] of every lane, index is a whole number
+    static FloatScalar gather(const float* base, FloatScalar index) { return base[(int32_t)index.v]; }
+    void store(float* p) const { *p = v; }
+
+    friend FloatScalar operator+(FloatScalar a, FloatScalar b) { return a.v + b.v; }
+    friend FloatScalar operator-(FloatScalar a, FloatScalar b) { return a.v - b.v; }
+    friend FloatScalar operator*(FloatScalar a, FloatScalar b) { return a.v * b.v; }
+    friend FloatScalar operator/(FloatScalar a, FloatScalar b) { return a.v / b.v; }
+    friend FloatScalar operator>=(FloatScalar a, FloatScalar b) { return mask(a.v >= b.v); }
+    friend FloatScalar operator<(FloatScalar a, FloatScalar b) { return mask(a.v < b.v); }
+    friend FloatScalar operator>(FloatScalar a, FloatScalar b) { return mask(a.v > b.v); }
+    friend FloatScalar operator<=(FloatScalar a, FloatScalar b) { return mask(a.v <= b.v); }
+    friend FloatScalar operator&(FloatScalar a, FloatScalar b) { return mask(isSet(a) && isSet(b)); }
+    // value where the mask is set, 0 elsewhere
+    friend FloatScalar ifThen(FloatScalar m, FloatScalar value) { return isSet(m) ? value : FloatScalar(0.0f); }
+    // a where the mask is set, b elsewhere
+    friend FloatScalar select(FloatScalar m, FloatScalar a, FloatScalar b) { return isSet(m) ? a : b; }
+    friend FloatScalar sqrt(FloatScalar a) { return sqrtf(a.v); }
+    friend FloatScalar floor(FloatScalar a) { return floorf(a.v); }
+    friend FloatScalar min(FloatScalar a, FloatScalar b) { return a.v < b.v ? a.v : b.v; }
+    friend FloatScalar max(FloatScalar a, FloatScalar b) { return a.v > b.v ? a.v : b.v; }
+    friend float horizontalSum(FloatScalar a) { return a.v; }
+    // true if the mask is set in any lane
+    friend bool horizontalAny(FloatScalar m) { return isSet(m); }
+    // bit i set if the mask is set in lane i
+    friend int horizontalMask(FloatScalar m) { return isSet(m) ? 1 : 0; }
+
+private:
+    static FloatScalar mask(bool set)
+    {
+        uint32_t bits = set ? 0xffffffffu : 0u;
+        FloatScalar result;
+        std::memcpy(&result.v, &bits, sizeof(bits));
+        return result;
+    }
+    static bool isSet(FloatScalar m)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &m.v, sizeof(bits));
+        return bits != 0;
+    }
+};
+
+#if defined(SIMD_FLOAT_SSE2)
+struct Float4
+{
+    static const int WIDTH = 4;
+    __m128 v;
+
+    Float4() = default;
+    Float4(__m128 value) : v(value) {}
+    Float4(float value) : v(_mm_set1_ps(value)) {}
+
+    static Float4 load(const float* p) { return _mm_loadu_ps(p); }
+    static Float4 gather(const float* base, Float4 index)
+    {
+        alignas(16) int32_t i[4];
+        _mm_store_si128((__m128i*)i, _mm_cvttps_epi32(index.v));
+        return _mm_setr_ps(base[i[0]], base[i[1]], base[i[2]], base[i[3]]);
+    }
+    void store(float* p) const { _mm_storeu_ps(p, v); }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return _mm_add_ps(a.v, b.v); }
+    friend Float4 operator-(Float4 a, Float4 b) { return _mm_sub_ps(a.v, b.v); }
+    friend Float4 operator*(Float4 a, Float4 b) { return _mm_mul_ps(a.v, b.v); }
+    friend Float4 operator/(Float4 a, Float4 b) { return _mm_div_ps(a.v, b.v); }
+    friend Float4 operator>=(Float4 a, Float4 b) { return _mm_cmpge_ps(a.v, b.v); }
+    friend Float4 operator<(Float4 a, Float4 b) { return _mm_cmplt_ps(a.v, b.v); }
+    friend Float4 operator>(Float4 a, Float4 b) { return _mm_cmpgt_ps(a.v, b.v); }
+    friend Float4 operator<=(Float4 a, Float4 b) { return _mm_cmple_ps(a.v, b.v); }
+    friend Float4 operator&(Float4 a, Float4 b) { return _mm_and_ps(a.v, b.v); }
+    friend Float4 ifThen(Float4 m, Float4 value) { return _mm_and_ps(m.v, value.v); }
+#if defined(SIMD_FLOAT_SSE41)
+    friend Float4 select(Float4 m, Float4 a, Float4 b) { return _mm_blendv_ps(b.v, a.v, m.v); }
+    friend Float4 floor(Float4 a) { return _mm_floor_ps(a.v); }
+#else
+    friend Float4 select(Float4 m, Float4 a, Float4 b) { return _mm_or_ps(_mm_and_ps(m.v, a.v), _mm_andnot_ps(m.v, b.v)); }
+    friend Float4 floor(Float4 a)
+    {
+        // SSE2 has no floor: truncate (valid below 2^31) and step down where truncation rounded up
+        __m128 truncated = _mm_cvtepi32_ps(_mm_cvttps_epi32(a.v));
+        return _mm_sub_ps(truncated, _mm_and_ps(_mm_cmpgt_ps(truncated, a.v), _mm_set1_ps(1.0f)));
+    }
+#endif
+    friend Float4 sqrt(Float4 a) { return _mm_sqrt_ps(a.v); }
+    friend Float4 min(Float4 a, Float4 b) { return _mm_min_ps(a.v, b.v); }
+    friend Float4 max(Float4 a, Float4 b) { return _mm_max_ps(a.v, b.v); }
+    friend float horizontalSum(Float4 a)
+    {
+        __m128 sum = _mm_add_ps(a.v, _mm_movehl_ps(a.v, a.v));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+    }
+    friend bool horizontalAny(Float4 m) { return _mm_movemask_ps(m.v) != 0; }
+    friend int horizontalMask(Float4 m) { return _mm_movemask_ps(m.v); }
+};
+#elif defined(SIMD_FLOAT_NEON)
+struct Float4
+{
+    static const int WIDTH = 4;
+    float32x4_t v;
+
+    Float4() = default;
+    Float4(float32x4_t value) : v(value) {}
+    Float4(float value) : v(vdupq_n_f32(value)) {}
+
+    static Float4 load(const float* p) { return vld1q_f32(p); }
+    static Float4 gather(const float* base, Float4 index)
+    {
+        int32_t i[4];
+        vst1q_s32(i, vcvtq_s32_f32(index.v));
+        float values[4] = { base[i[0]], base[i[1]], base[i[2]], base[i[3]] };
+        return vld1q_f32(values);
+    }
+    void store(float* p) const { vst1q_f32(p, v); }
+
+    friend Float4 operator+(Float4 a, Float4 b) { return vaddq_f32(a.v, b.v); }
+    friend Float4 operator-(Float4 a, Float4 b) { return vsubq_f32(a.v, b.v); }
+    friend Float4 operator*(Float4 a, Float4 b) { return vmulq_f32(a.v, b.v); }
+    friend Float4 operator/(Float4 a, Float4 b) { return vdivq_f32(a.v, b.v); }
+    friend Float4 operator>=(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vcgeq_f32(a.v, b.v)); }
+    friend Float4 operator<(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vcltq_f32(a.v, b.v)); }
+    friend Float4 operator>(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vcgtq_f32(a.v, b.v)); }
+    friend Float4 operator<=(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vcleq_f32(a.v, b.v)); }
+    friend Float4 operator&(Float4 a, Float4 b) { return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a.v), vreinterpretq_u32_f32(b.v))); }
+    friend Float4 ifThen(Float4 m, Float4 value) { return m & value; }
+    friend Float4 select(Float4 m, Float4 a, Float4 b) { return vbslq_f32(vreinterpretq_u32_f32(m.v), a.v, b.v); }
+    friend Float4 sqrt(Float4 a) { return vsqrtq_f32(a.v); }
+    friend Float4 floor(Float4 a) { return vrndmq_f32(a.v); }
+    friend Float4 min(Float4 a, Float4 b) { return vminnmq_f32(a.v, b.v); }
+    friend Float4 max(Float4 a, Float4 b) { return vbslq_f32(vcgtq_f32(a.v, b.v), a.v, b.v); }
+    friend float horizontalSum(Float4 a) { return vaddvq_f32(a.v); }
+    friend bool horizontalAny(Float4 m) { return vmaxvq_u32(vreinterpretq_u32_f32(m.v)) != 0; }
+    friend int horizontalMask(Float4 m)
+    {
+        const int32_t shifts[4] = { 0, 1, 2, 3 };
+        return (int)vaddvq_u32(vshlq_u32(vshrq_n_u32(vreinterpretq_u32_f32(m.v), 31), vld1q_s32(shifts)));
+    }
+};
+#endif
+
+#if defined(SIMD_FLOAT_AVX2)
+struct Float8
+{
+    static const int WIDTH = 8;
+    __m256 v;
+
+    Float8() = default;
+    Float8(__m256 value) : v(value) {}
+    Float8(float value) : v(_mm256_set1_ps(value)) {}
+
+    static Float8 load(const float* p) { return _mm256_loadu_ps(p); }
+    static Float8 gather(const float* base, Float8 index) { return _mm256_i32gather_ps(base, _mm256_cvttps_epi32(index.v), 4); }
+    void store(float* p) const { _mm256_storeu_ps(p, v); }
+
+    friend Float8 operator+(Float8 a, Float8 b) { return _mm256_add_ps(a.v, b.v); }
+    friend Float8 operator-(Float8 a, Float8 b) { return _mm256_sub_ps(a.v, b.v); }
+    friend Float8 operator*(Float8 a, Float8 b) { return _mm256_mul_ps(a.v, b.v); }
+    friend Float8 operator/(Float8 a, Float8 b) { return _mm256_div_ps(a.v, b.v); }
+    friend Float8 operator>=(Float8 a, Float8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GE_OQ); }
+    friend Float8 operator<(Float8 a, Float8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LT_OQ); }
+    friend Float8 operator>(Float8 a, Float8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_GT_OQ); }
+    friend Float8 operator<=(Float8 a, Float8 b) { return _mm256_cmp_ps(a.v, b.v, _CMP_LE_OQ); }
+    friend Float8 operator&(Float8 a, Float8 b) { return _mm256_and_ps(a.v, b.v); }
+    friend Float8 ifThen(Float8 m, Float8 value) { return _mm256_and_ps(m.v, value.v); }
+    friend Float8 select(Float8 m, Float8 a, Float8 b) { return _mm256_blendv_ps(b.v, a.v, m.v); }
+    friend Float8 sqrt(Float8 a) { return _mm256_sqrt_ps(a.v); }
+    friend Float8 floor(Float8 a) { return _mm256_floor_ps(a.v); }
+    friend Float8 min(Float8 a, Float8 b) { return _mm256_min_ps(a.v, b.v); }
+    friend Float8 max(Float8 a, Float8 b) { return _mm256_max_ps(a.v, b.v); }
+    friend float horizontalSum(Float8 a)
+    {
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(a.v), _mm256_extractf128_ps(a.v, 1));
+        sum = _mm_add_ps(sum, _mm_movehl_ps(sum, sum));
+        sum = _mm_add_ss(sum, _mm_shuffle_ps(sum, sum, 1));
+        return _mm_cvtss_f32(sum);
+    }
+    friend bool horizontalAny(Float8 m) { return _mm256_movemask_ps(m.v) != 0; }
+    friend int horizontalMask(Float8 m) { return _mm256_movemask_ps(m.v); }
+};
+#endif
+
+#if defined(SIMD_FLOAT_AVX512)
+// AVX-512F only: comparisons are turned from mask registers back into all-ones lanes to keep the common interface.
+// Intrinsics that pass _mm512_undefined_ps() to their masked form use the zero-masked one with every lane set
+// instead: same instruction, but GCC warns about the undefined source at -O2 -Wall.
+struct Float16
+{
+    static const int WIDTH = 16;
+    __m512 v;
+
+    Float16() = default;
+    Float16(__m512 value) : v(value) {}
+    Float16(float value) : v(_mm512_set1_ps(value)) {}
+
+    static Float16 load(const float* p) { return _mm512_loadu_ps(p); }
+    static Float16 gather(const float* base, Float16 index)
+    {
+        return _mm512_mask_i32gather_ps(_mm512_setzero_ps(), ALL_LANES, _mm512_maskz_cvttps_epi32(ALL_LANES, index.v), base, 4);
+    }
+    void store(float* p) const { _mm512_storeu_ps(p, v); }
+
+    friend Float16 operator+(Float16 a, Float16 b) { return _mm512_add_ps(a.v, b.v); }
+    friend Float16 operator-(Float16 a, Float16 b) { return _mm512_sub_ps(a.v, b.v); }
+    friend Float16 operator*(Float16 a, Float16 b) { return _mm512_mul_ps(a.v, b.v); }
+    friend Float16 operator/(Float16 a, Float16 b) { return _mm512_div_ps(a.v, b.v); }
+    friend Float16 operator>=(Float16 a, Float16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GE_OQ)); }
+    friend Float16 operator<(Float16 a, Float16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LT_OQ)); }
+    friend Float16 operator>(Float16 a, Float16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_GT_OQ)); }
+    friend Float16 operator<=(Float16 a, Float16 b) { return fromMask(_mm512_cmp_ps_mask(a.v, b.v, _CMP_LE_OQ)); }
+    friend Float16 operator&(Float16 a, Float16 b) { return _mm512_castsi512_ps(_mm512_and_si512(_mm512_castps_si512(a.v), _mm512_castps_si512(b.v))); }
+    friend Float16 ifThen(Float16 m, Float16 value) { return _mm512_maskz_mov_ps(toMask(m), value.v); }
+    friend Float16 select(Float16 m, Float16 a, Float16 b) { return _mm512_mask_blend_ps(toMask(m), b.v, a.v); }
+    friend Float16 sqrt(Float16 a) { return _mm512_maskz_sqrt_ps(ALL_LANES, a.v); }
+    friend Float16 floor(Float16 a) { return _mm512_maskz_roundscale_ps(ALL_LANES, a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+    friend Float16 min(Float16 a, Float16 b) { return _mm512_maskz_min_ps(ALL_LANES, a.v, b.v); }
+    friend Float16 max(Float16 a, Float16 b) { return _mm512_maskz_max_ps(ALL_LANES, a.v, b.v); }
+    friend float horizontalSum(Float16 a) { return _mm512_reduce_add_ps(a.v); }
+    friend bool horizontalAny(Float16 m) { return toMask(m) != 0; }
+    friend int horizontalMask(Float16 m) { return toMask(m); }
+
+private:
+    static const __mmask16 ALL_LANES = 0xFFFF;
+
+    static Float16 fromMask(__mmask16 m) { return _mm512_castsi512_ps(_mm512_maskz_set1_epi32(m, -1)); }
+    static __mmask16 toMask(Float16 m) { return _mm512_test_epi32_mask(_mm512_castps_si512(m.v), _mm512_castps_si512(m.v)); }
+};
+#endif
+
+// acos, Abramowitz & Stegun 4.4.46 (error below 2e-8), input is clamped to [-1, 1]
+template <typename Float>
+Float acosApprox(Float x)
+{
+    Float zero(0.0f), one(1.0f);
+    Float negative = x < zero;
+    Float a = min(select(negative, zero - x, x), one);
+    Float p = Float(-0.0012624911f);
+    p = p * a + Float(0.0066700901f);
+    p = p * a + Float(-0.0170881256f);
+    p = p * a + Float(0.0308918810f);
+    p = p * a + Float(-0.0501743046f);
+    p = p * a + Float(0.0889789874f);
+    p = p * a + Float(-0.2145988016f);
+    p = p * a + Float(1.5707963050f);
+    Float result = sqrt(one - a) * p;
+    return select(negative, Float(3.14159265f) - result, result);
+}
+
+// cos, reduced to [0, pi / 2] and evaluated with a Taylor polynomial (error below 1e-8 there)
+template <typename Float>
+Float cosApprox(Float x)
+{
+    const float PI = 3.14159265f;
+    Float zero(0.0f), one(1.0f);
+    Float y = x - floor(x * Float(0.5f / PI) + Float(0.5f)) * Float(2.0f * PI);
+    y = max(y, zero - y);
+    Float flip = y > Float(0.5f * PI);
+    y = select(flip, Float(PI) - y, y);
+    Float y2 = y * y;
+    Float c = Float(1.0f / 479001600.0f);
+    c = c * y2 - Float(1.0f / 3628800.0f);
+    c = c * y2 + Float(1.0f / 40320.0f);
+    c = c * y2 - Float(1.0f / 720.0f);
+    c = c * y2 + Float(1.0f / 24.0f);
+    c = c * y2 - Float(0.5f);
+    c = c * y2 + one;
+    return select(flip, zero - c, c);
+}
+
+// widest vector available at compile time
+#if defined(SIMD_FLOAT_AVX512)
+typedef Float16 FloatNative;
+#elif defined(SIMD_FLOAT_AVX2)
+typedef Float8 FloatNative;
+#elif defined(SIMD_FLOAT_SSE2) || defined(SIMD_FLOAT_NEON)
+typedef Float4 FloatNative;
+#else
+typedef FloatScalar FloatNative;
+#endif
+}
+
+#endif
@@ -5,28 +5,51 @@
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 #include <glm/gtc/random.hpp>
+#include <glm/gtc/packing.hpp>
 
 #include <learnopengl/filesystem.h>
 #include <learnopengl/shader.h>
+#include <learnopengl/shader_c.h>
 #include <learnopengl/camera.h>
 #include <learnopengl/model.h>
 
+#include "headless.h"
+#include "camera_path.h"
+#include "benchmark_report.h"
+#include "profiler.h"
+#include "parameter_sweep.h"
+#include "render_targets.h"
+#include "benchmark_compare.h"
+#include "ao_image.h"
+#include "ao_raytracer.h"
+#include "ao_bake.h"
+#include "cpu_dispatch.h"
+
 #include <iostream>
 #include <random>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+#include <memory>
 
+void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow *window);
 unsigned int loadTexture(const char *path, bool gammaCorrection);
 void renderFullScreen();
 void renderCube();
+double getTime();
 
 // settings
-const unsigned int SRC_WIDTH = 1600;
-const unsigned int SRC_HEIGHT = 900;
+// default render resolution, can be changed with --resolution or by resizing the window
+const unsigned int DEFAULT_WIDTH = 1600;
+const unsigned int DEFAULT_HEIGHT = 900;
 
 const float SSAO_SAMPLE_RADIUS = 0.5f;
 const float SSAO_SAMPLE_BIAS = 0.025f;
+const unsigned int SSAO_KERNEL_SIZE = 16;
 
 const float HBAO_SAMPLE_RADIUS = 0.4f;
 const float HBAO_MAX_RADIUS_PIXELS = 50.0f;
@@ -35,16 +58,55 @@ const unsigned int HBAO_SAMPLES = 4;
 
 const float GTAO_ROTATIONS[6] = { 60.0f, 300.0f, 180.0f, 240.0f, 120.0f, 0.0f };
 const float GTAO_OFFSETS[4] = { 0.0f, 0.5f, 0.25f, 0.75f };
+// compiled into gtao.fs as NUM_DIRECTIONS, NUM_STEPS and RADIUS
+const unsigned int GTAO_DIRS = 8;
+const unsigned int GTAO_STEPS = 4;
+const float GTAO_SAMPLE_RADIUS = 0.2f;
 
 const float CAMERA_NEAR_PLANE = 0.1f;
 const float CAMERA_FAR_PLANE = 50.0f;
 
 const int NOISE_TEXTURE_RES = 4;
 
+// compute AO (ssao.cs, hbao.cs, gtao.cs): GROUP_SIZE x GROUP_SIZE invocations shade a tile of TILE_SIZE x TILE_SIZE pixels,
+// the linear depth of the tile and TILE_APRON pixels around it is kept in shared memory
+// (80 x 80 floats, 25 KB of the 32 KB GL 4.3 guarantees), samples beyond the apron read the texture
+const int COMPUTE_AO_GROUP_SIZE = 16;
+const int COMPUTE_AO_TILE_SIZE = 32;
+const int COMPUTE_AO_TILE_APRON = 24;
+
+// separable bilateral blur of the AO (bilateral_blur.fs, bilateral_blur.cs with compute AO): BLUR_RADIUS taps on each
+// side per direction, a tap differing from the center depth by 1 / BLUR_SHARPNESS of it gets 1 / e of its weight
+const unsigned int BLUR_RADIUS = 2;
+const float BLUR_SHARPNESS = 32.0f;
+const int COMPUTE_BLUR_GROUP_SIZE = 64;
+
+// ray traced reference AO (--reference), radius matches SSAO_SAMPLE_RADIUS
+const int REFERENCE_AO_SAMPLES = 64;
+const float REFERENCE_AO_RADIUS = 0.5f;
+
+// per-vertex AO of the model (RenderMode::BAKED) within REFERENCE_AO_RADIUS, cached in the working directory
+const int AO_BAKE_SAMPLES = 256;
+
+const int HEADLESS_WARMUP_FRAMES = 50;
+const int HEADLESS_RECORD_FRAMES = 500;
+
+// camera paths are replayed with a fixed timestep
+const float CAMERA_PATH_TIMESTEP = 1.0f / 60.0f;
+const int CAMERA_PATH_FRAMES_PER_VIEW = 60;
+
+// built-in views of the nanosuit room (--views), first two match experiments/*_view1/2.png
+const CameraPathFrame BENCHMARK_VIEWS[] = {
+    { glm::vec3(4.2f, 0.9f, 4.6f), -160.0f, -18.0f, 45.0f },  // legs of the three models from the feet side
+    { glm::vec3(-1.2f, 1.6f, -0.6f), -45.0f, -55.0f, 45.0f }, // close-up of the middle helmet
+    { glm::vec3(0.0f, 8.0f, 3.0f), -90.0f, -60.0f, 45.0f },   // overview from the top
+    { glm::vec3(6.0f, 3.0f, 6.0f), -135.0f, -20.0f, 45.0f },  // room corner, all three models on the floor
+};
+
 // camera
 Camera camera(glm::vec3(0.0f, 8.0f, 3.0f));
-float lastX = (float)SRC_WIDTH / 2.0;
-float lastY = (float)SRC_HEIGHT / 2.0;
+float lastX = (float)DEFAULT_WIDTH / 2.0;
+float lastY = (float)DEFAULT_HEIGHT / 2.0;
 bool firstMouse = true;
 
 // timing
@@ -56,6 +118,7 @@ enum class RenderMode {
     SSAO,
     HBAO,
     GTAO,
+    BAKED, // per-vertex AO baked into the model, no screen space pass
 };
 
 std::string getRenderModeName(RenderMode mode)
@@ -70,27 +133,882 @@ std::string getRenderModeName(RenderMode mode)
         return "hbao";
     case RenderMode::GTAO:
         return "gtao";
+    case RenderMode::BAKED:
+        return "baked";
     default:
         return "none";
     }
 }
 
+RenderMode getRenderModeByName(const std::string& name)
+{
+    for (RenderMode mode : { RenderMode::SSAO, RenderMode::HBAO, RenderMode::GTAO })
+    {
+        if (getRenderModeName(mode) == name)
+            return mode;
+    }
+    return RenderMode::NONE;
+}
+
+// AO quality knobs, loop counts are compiled into the shaders as defines (see getAODefines)
+struct AOSettings
+{
+    unsigned int ssaoKernelSize = SSAO_KERNEL_SIZE;
+    float ssaoRadius = SSAO_SAMPLE_RADIUS;
+    float ssaoBias = SSAO_SAMPLE_BIAS;
+    unsigned int hbaoDirections = HBAO_DIRS;
+    unsigned int hbaoSteps = HBAO_SAMPLES;
+    float hbaoRadius = HBAO_SAMPLE_RADIUS;
+    float hbaoMaxRadiusPixels = HBAO_MAX_RADIUS_PIXELS;
+    unsigned int gtaoDirections = GTAO_DIRS;
+    unsigned int gtaoSteps = GTAO_STEPS;
+    float gtaoRadius = GTAO_SAMPLE_RADIUS;
+
+    // sets a parameter of the mode by its report name, returns false if the mode has no such parameter
+    bool set(RenderMode mode, const std::string& name, double value)
+    {
+        unsigned int count = (unsigned int)std::max(1.0, value);
+        if (mode == RenderMode::SSAO)
+        {
+            if (name == "kernel_size")
+                ssaoKernelSize = count;
+            else if (name == "radius")
+                ssaoRadius = (float)value;
+            else if (name == "bias")
+                ssaoBias = (float)value;
+            else
+                return false;
+            return true;
+        }
+        if (mode == RenderMode::HBAO)
+        {
+            if (name == "directions")
+                hbaoDirections = count;
+            else if (name == "steps")
+                hbaoSteps = count;
+            else if (name == "radius")
+                hbaoRadius = (float)value;
+            else if (name == "max_radius_pixels")
+                hbaoMaxRadiusPixels = (float)value;
+            else
+                return false;
+            return true;
+        }
+        if (mode == RenderMode::GTAO)
+        {
+            if (name == "directions")
+                gtaoDirections = count;
+            else if (name == "steps")
+                gtaoSteps = count;
+            else if (name == "radius")
+                gtaoRadius = (float)value;
+            else
+                return false;
+            return true;
+        }
+        return false;
+    }
+};
+
 RenderMode renderMode = RenderMode::SSAO;
 bool enableBlur = true;
 bool inRecordMode = false;
+bool headless = false;
+std::string cameraSource = "live";
+AOSettings aoSettings;
+// render resolution, render targets follow it at the beginning of the next frame
+unsigned int srcWidth = DEFAULT_WIDTH;
+unsigned int srcHeight = DEFAULT_HEIGHT;
+// AO passes run at 1 / aoScale of the render resolution (1, 2 or 4) and are upsampled with a bilateral filter
+unsigned int aoScale = 1;
+// SSAO and HBAO sample 4x4 deinterleaved layers of the depth buffer instead of the full image, so the samples
+// of neighbouring pixels hit the same texels
+bool deinterleaveAO = false;
+static_assert(NOISE_TEXTURE_RES == DEINTERLEAVE_FACTOR, "every deinterleaved layer takes the jitter of one noise texel");
+// SSAO, HBAO and GTAO (not deinterleaved) sample a mip chain of linear depth built once per frame,
+// samples farther from the pixel read coarser levels
+bool depthPyramidAO = false;
+// SSAO, HBAO and GTAO run as compute shaders sharing the depth of a tile between the invocations of a work group
+// (takes precedence over deinterleaving and the depth pyramid), needs a GL 4.3 context
+bool computeAO = false;
+bool computeAOSupported = false;
+// SSAO, HBAO and GTAO of every frame are rendered on the CPU: the software rasterizer renders the G-buffer, the CPU AO
+// engine of the mode shades it and the result is uploaded into the AO target for the blur and the lighting pass
+// (takes precedence over compute, deinterleaving and the depth pyramid), full AO resolution only
+bool cpuPipelineAO = false;
+
+bool usesCpuPipeline(RenderMode mode)
+{
+    return cpuPipelineAO && (mode == RenderMode::SSAO || mode == RenderMode::HBAO || mode == RenderMode::GTAO);
+}
+// taps on each side of the blur, compiled into the blur shaders
+unsigned int blurRadius = BLUR_RADIUS;
+
+std::string getResolutionName(unsigned int width, unsigned int height)
+{
+    return std::to_string(width) + "x" + std::to_string(height);
+}
+
+// parses "WIDTHxHEIGHT"
+bool parseResolution(const char* text, unsigned int& width, unsigned int& height)
+{
+    char end;
+    return sscanf(text, "%ux%u%c", &width, &height, &end) == 2 && width > 0 && height > 0;
+}
+
+// passes reading the depth at the render resolution (aoScale 1) get the G-buffer depth buffer and linearize it themselves,
+// there is no linear depth target next to it; with aoScale > 1 they read the linear depth of ao_downsample.fs
+std::string getDepthInputDefines()
+{
+    return aoScale == 1 ? "#define HARDWARE_DEPTH\n" : "";
+}
+
+// shader defines specializing the AO shader of the mode for the current settings
+std::string getAODefines(RenderMode mode, bool deinterleaved = false, bool compute = false)
+{
+    std::string defines;
+    if (deinterleaved)
+        defines += "#define DEINTERLEAVED\n";
+    else if (compute)
+    {
+        defines += "#define GROUP_SIZE " + std::to_string(COMPUTE_AO_GROUP_SIZE) + "\n";
+        defines += "#define TILE_SIZE " + std::to_string(COMPUTE_AO_TILE_SIZE) + "\n";
+        defines += "#define TILE_APRON " + std::to_string(COMPUTE_AO_TILE_APRON) + "\n";
+    }
+    else if (depthPyramidAO)
+        defines += "#define DEPTH_PYRAMID\n";
+    if (!deinterleaved && (compute || !depthPyramidAO))
+        defines += getDepthInputDefines();
+    if (mode == RenderMode::SSAO)
+        defines += "#define KERNEL_SIZE " + std::to_string(aoSettings.ssaoKernelSize) + "\n";
+    if (mode == RenderMode::HBAO)
+    {
+        defines += "#define NUM_DIRECTIONS " + std::to_string(aoSettings.hbaoDirections) + "\n";
+        defines += "#define NUM_STEPS " + std::to_string(aoSettings.hbaoSteps) + "\n";
+    }
+    if (mode == RenderMode::GTAO)
+    {
+        defines += "#define NUM_DIRECTIONS " + std::to_string(aoSettings.gtaoDirections) + "\n";
+        defines += "#define NUM_STEPS " + std::to_string(aoSettings.gtaoSteps) + "\n";
+        defines += "#define RADIUS " + std::to_string(aoSettings.gtaoRadius) + "\n";
+    }
+    return defines;
+}
+
+// render state of a frame in flight, its timings are read back a few frames later
+struct RecordFrameInfo
+{
+    RenderMode mode;
+    bool blur;
+    bool record;
+    int run; // headless run, e.g. point of a parameter sweep
+    unsigned int width;
+    unsigned int height;
+    unsigned int aoScale;
+    bool deinterleave;
+    bool depthPyramid;
+    bool compute;
+};
 
 struct RecordFrame
 {
-    double aoTimeMs;
-    double blurTimeMs;
+    std::vector<ProfileZoneResult> zones;
+};
+
+void renderModel(Model& model, Shader& shader, Profiler<RecordFrameInfo>& profiler);
+
+// drives the render state when running headless: every render mode is measured with and without blur,
+// each run renders warmup frames first, then records a fixed number of frames and writes the report
+struct HeadlessBenchmark
+{
+    // NONE, SSAO, HBAO, GTAO, BAKED, deinterleaved SSAO and HBAO, SSAO, HBAO and GTAO on the depth pyramid
+    // and as compute shaders x blur on/off
+    static const int MODE_RUN_COUNT = 26;
+    static const int DEINTERLEAVED_MODE_RUN = 10; // first run of the deinterleaved modes
+    static const int DEPTH_PYRAMID_MODE_RUN = 14; // first run of the depth pyramid modes
+    static const int COMPUTE_MODE_RUN = 20; // first run of the compute modes, the last ones
+    static const int QUALITY_RUNS_PER_VIEW = 6; // SSAO, HBAO, GTAO x blur on/off
+
+    int warmupFrames = HEADLESS_WARMUP_FRAMES;
+    int recordFrames = HEADLESS_RECORD_FRAMES;
+    int runsPerResolution = MODE_RUN_COUNT;
+    // parameter sweep: every run measures the same mode (with blur) with settings of another sweep point
+    bool sweep = false;
+    RenderMode sweepMode = RenderMode::NONE;
+    // quality harness: every AO mode with and without blur at every built-in view, camera stays at the view
+    bool quality = false;
+    // resolution scaling: all runs are repeated at every resolution, empty keeps the current one
+    std::vector<glm::uvec2> resolutions;
+    int run = 0;
+    int frame = 0;
+
+    int getRunCount() const
+    {
+        return runsPerResolution * std::max(1, (int)resolutions.size());
+    }
+
+    bool isFinished() const
+    {
+        return run >= getRunCount();
+    }
+
+    // run within the current resolution, e.g. point of a parameter sweep
+    int getLocalRun() const
+    {
+        return run % runsPerResolution;
+    }
+
+    // sweep and quality runs keep deinterleave, depthPyramid and compute as set on the command line
+    void apply(RenderMode& mode, bool& blur, bool& deinterleave, bool& depthPyramid, bool& compute, bool& record, unsigned int& width, unsigned int& height) const
+    {
+        int localRun = getLocalRun();
+        if (quality)
+            mode = (RenderMode)(1 + (localRun % QUALITY_RUNS_PER_VIEW) / 2);
+        else if (sweep)
+            mode = sweepMode;
+        else
+        {
+            deinterleave = localRun >= DEINTERLEAVED_MODE_RUN && localRun < DEPTH_PYRAMID_MODE_RUN;
+            depthPyramid = localRun >= DEPTH_PYRAMID_MODE_RUN && localRun < COMPUTE_MODE_RUN;
+            compute = localRun >= COMPUTE_MODE_RUN;
+            if (compute)
+                mode = (RenderMode)(1 + (localRun - COMPUTE_MODE_RUN) / 2);
+            else if (depthPyramid)
+                mode = (RenderMode)(1 + (localRun - DEPTH_PYRAMID_MODE_RUN) / 2);
+            else if (deinterleave)
+                mode = (RenderMode)(1 + (localRun - DEINTERLEAVED_MODE_RUN) / 2);
+            else
+                mode = (RenderMode)(localRun / 2);
+        }
+        blur = sweep || (localRun % 2) == 0;
+        record = frame >= warmupFrames && frame < warmupFrames + recordFrames;
+        if (!resolutions.empty())
+        {
+            width = resolutions[run / runsPerResolution].x;
+            height = resolutions[run / runsPerResolution].y;
+        }
+    }
+
+    // built-in view measured by the quality harness
+    int getView() const
+    {
+        return getLocalRun() / QUALITY_RUNS_PER_VIEW;
+    }
+
+    // camera path frame to show: warmup frames stay on the first one, every run starts the path from the beginning
+    int pathFrame() const
+    {
+        return std::max(0, frame - warmupFrames);
+    }
+
+    void nextFrame()
+    {
+        if (++frame >= warmupFrames + recordFrames)
+        {
+            frame = 0;
+            run++;
+        }
+    }
+};
+
+// writes timings of every recorded frame (record_{mode}.csv) and their summary (report_{mode}.json),
+// runs over several resolutions get the resolution in the file names (e.g. report_ssao_1920x1080.json)
+void writeReport(const RecordFrameInfo& info, const std::vector<RecordFrame>& recordFrames, bool resolutionInName)
+{
+    RenderMode mode = info.mode;
+    auto renderModeName = getRenderModeName(mode);
+    auto resolution = getResolutionName(info.width, info.height);
+    std::string aoScaleName = info.aoScale == 2 ? "_half" : info.aoScale == 4 ? "_quarter" : "";
+    bool cpuPipeline = usesCpuPipeline(mode);
+    std::string pathName = cpuPipeline ? "_cpu" : info.compute ? "_compute" : info.deinterleave ? "_deinterleaved" : info.depthPyramid ? "_pyramid" : "";
+    auto reportName = renderModeName + (info.blur ? "" : "_noblur") + aoScaleName + pathName + (resolutionInName ? "_" + resolution : "");
+
+    BenchmarkReport report;
+    report.setMetadata("render_mode", renderModeName);
+    report.setMetadata("blur", info.blur ? "on" : "off");
+    report.setMetadata("resolution", resolution);
+    report.setMetadata("ao_scale", info.aoScale);
+    report.setMetadata("deinterleaved", info.deinterleave ? "on" : "off");
+    report.setMetadata("depth_pyramid", info.depthPyramid ? "on" : "off");
+    report.setMetadata("compute", info.compute ? "on" : "off");
+    report.setMetadata("cpu_pipeline", cpuPipeline ? "on" : "off");
+    report.setMetadata("camera", cameraSource);
+    if (mode == RenderMode::SSAO)
+    {
+        report.setMetadata("kernel_size", aoSettings.ssaoKernelSize);
+        report.setMetadata("radius", aoSettings.ssaoRadius);
+        report.setMetadata("bias", aoSettings.ssaoBias);
+    }
+    if (mode == RenderMode::HBAO)
+    {
+        report.setMetadata("directions", aoSettings.hbaoDirections);
+        report.setMetadata("steps", aoSettings.hbaoSteps);
+        report.setMetadata("radius", aoSettings.hbaoRadius);
+        report.setMetadata("max_radius_pixels", aoSettings.hbaoMaxRadiusPixels);
+    }
+    if (mode == RenderMode::GTAO)
+    {
+        report.setMetadata("directions", aoSettings.gtaoDirections);
+        report.setMetadata("steps", aoSettings.gtaoSteps);
+        report.setMetadata("radius", aoSettings.gtaoRadius);
+    }
+    report.setMetadata("gl_vendor", (const char*)glGetString(GL_VENDOR));
+    report.setMetadata("gl_renderer", (const char*)glGetString(GL_RENDERER));
+    report.setMetadata("gl_version", (const char*)glGetString(GL_VERSION));
+
+    // every zone becomes a pass with its GPU time and a "_cpu" pass with the CPU time spent recording it,
+    // made of the frames that contain the zone (e.g. not the ones before a render mode change) and
+    // for the GPU time only of those with a valid timestamp
+    std::vector<std::string> zoneNames;
+    std::vector<bool> zoneHasGpu;
+    for (const auto& frame : recordFrames)
+    {
+        for (const auto& zone : frame.zones)
+        {
+            size_t index = std::find(zoneNames.begin(), zoneNames.end(), zone.name) - zoneNames.begin();
+            if (index == zoneNames.size())
+            {
+                zoneNames.push_back(zone.name);
+                zoneHasGpu.push_back(false);
+            }
+            // a GPU zone past the timestamp budget of its frame has no GPU time there
+            if (zone.gpuMs >= 0.0)
+                zoneHasGpu[index] = true;
+        }
+    }
+    for (size_t i = 0; i < zoneNames.size(); i++)
+    {
+        std::vector<double> gpuTimes, cpuTimes;
+        std::vector<size_t> gpuFrames, cpuFrames;
+        for (size_t j = 0; j < recordFrames.size(); j++)
+        {
+            for (const auto& zone : recordFrames[j].zones)
+            {
+                if (zone.name != zoneNames[i])
+                    continue;
+                if (zone.gpuMs >= 0.0)
+                {
+                    gpuTimes.push_back(zone.gpuMs);
+                    gpuFrames.push_back(j);
+                }
+                cpuTimes.push_back(zone.cpuMs);
+                cpuFrames.push_back(j);
+                break;
+            }
+        }
+        if (zoneHasGpu[i])
+            report.addPass(zoneNames[i], gpuTimes, gpuFrames);
+        report.addPass(zoneNames[i] + "_cpu", cpuTimes, cpuFrames);
+    }
+    report.setFramePass("frame");
+
+    report.writeCsv("record_" + reportName + ".csv");
+    report.writeJson("report_" + reportName + ".json");
+}
+
+// AO quality and cost of a single view and render mode (--quality)
+struct QualityResult
+{
+    std::string resolution;
+    int view = 0;
+    RenderMode mode = RenderMode::NONE;
+    bool blur = false;
+    double aoTimeMs = 0.0;
+    double blurTimeMs = 0.0;
+    bool hasReference = false;
+    AOImageQuality quality;
+};
+
+// one row per view and mode: timings next to RMSE/PSNR/SSIM against the reference image of the view
+bool writeQualityReport(const std::string& path, const std::vector<QualityResult>& results)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::QUALITY_REPORT::FAILED_TO_WRITE: " << path << std::endl;
+        return false;
+    }
+    file << "# gl_renderer: " << glGetString(GL_RENDERER) << "\n";
+    file << "resolution,view,mode,blur,ao_ms,blur_ms,rmse,psnr_db,ssim\n";
+    for (const auto& result : results)
+    {
+        file << result.resolution << "," << result.view << "," << getRenderModeName(result.mode) << "," << (result.blur ? "on" : "off") << ","
+             << result.aoTimeMs << "," << result.blurTimeMs << ",";
+        if (result.hasReference)
+            file << result.quality.rmse << "," << result.quality.psnr << "," << result.quality.ssim << "\n";
+        else
+            file << ",,\n";
+    }
+    return true;
+}
+
+// reads back the AO channel of an AO texture, stalls until the GPU is done with it
+AOImage readAOImage(unsigned int texture, unsigned int width, unsigned int height)
+{
+    AOImage image;
+    image.resize(width, height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RED, GL_FLOAT, image.pixels.data());
+    return image;
+}
+
+// scene layout, shared by the geometry pass, the CPU ray tracer and the software rasterizer
+// -----------------------------------------------------------------------------------------
+const int SCENE_MODEL_COUNT = 3;
+
+glm::mat4 getRoomTransform()
+{
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(0.0, 7.0f, 0.0f));
+    model = glm::scale(model, glm::vec3(7.5f, 7.5f, 7.5f));
+    return model;
+}
+
+glm::mat4 getModelTransform(int i)
+{
+    float xOffset[] = {-3.0f, 0.0f, 3.0f};
+    glm::mat4 model = glm::mat4(1.0f);
+    model = glm::translate(model, glm::vec3(xOffset[i], -0.2f, 3.0));
+    model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
+    model = glm::scale(model, glm::vec3(0.3f));
+    return model;
+}
+
+// vertices of renderCube: position, normal, texture coordinates
+const float CUBE_VERTICES[] = {
+    // back face
+    -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
+     1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
+     1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 0.0f, // bottom-right         
+     1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
+    -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
+    -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 1.0f, // top-left
+    // front face
+    -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
+     1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 0.0f, // bottom-right
+     1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
+     1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
+    -1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 1.0f, // top-left
+    -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
+    // left face
+    -1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
+    -1.0f,  1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-left
+    -1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
+    -1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
+    -1.0f, -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-right
+    -1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
+    // right face
+     1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
+     1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
+     1.0f,  1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-right         
+     1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
+     1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
+     1.0f, -1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-left     
+    // bottom face
+    -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
+     1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 1.0f, // top-left
+     1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
+     1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
+    -1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 0.0f, // bottom-right
+    -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
+    // top face
+    -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
+     1.0f,  1.0f , 1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
+     1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 1.0f, // top-right     
+     1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
+    -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
+    -1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left        
+};
+
+// draws of the geometry pass for the software rasterizer
+CpuRasterScene getCpuRasterScene(const Model& mainModel)
+{
+    static std::vector<Vertex> cubeVertices;
+    static std::vector<unsigned int> cubeIndices;
+    if (cubeVertices.empty())
+    {
+        for (size_t i = 0; i < sizeof(CUBE_VERTICES) / sizeof(float) / 8; i++)
+        {
+            Vertex vertex = {};
+            vertex.Position = glm::vec3(CUBE_VERTICES[i * 8], CUBE_VERTICES[i * 8 + 1], CUBE_VERTICES[i * 8 + 2]);
+            vertex.Normal = glm::vec3(CUBE_VERTICES[i * 8 + 3], CUBE_VERTICES[i * 8 + 4], CUBE_VERTICES[i * 8 + 5]);
+            vertex.TexCoords = glm::vec2(CUBE_VERTICES[i * 8 + 6], CUBE_VERTICES[i * 8 + 7]);
+            cubeVertices.push_back(vertex);
+            cubeIndices.push_back((unsigned int)i);
+        }
+    }
+    CpuRasterScene scene;
+    scene.addMesh(cubeVertices, cubeIndices, getRoomTransform(), true);
+    for (int i = 0; i < SCENE_MODEL_COUNT; i++)
+    {
+        for (const Mesh& mesh : mainModel.meshes)
+            scene.addMesh(mesh.vertices, mesh.indices, getModelTransform(i), false);
+    }
+    return scene;
+}
+
+// renders ray traced AO of every built-in view into directory/reference_view{N}.pfm on the CPU
+bool writeReferenceImages(const std::string& directory, Model& mainModel, unsigned int width, unsigned int height, const AOReferenceSettings& settings)
+{
+    auto buildStart = std::chrono::steady_clock::now();
+    AOScene scene;
+    scene.addCube(getRoomTransform());
+    for (int i = 0; i < SCENE_MODEL_COUNT; i++)
+        scene.addModel(mainModel, getModelTransform(i));
+    scene.build();
+    double buildSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - buildStart).count();
+    printf("reference scene: %zu triangles, bvh built in %.1f ms, %d threads\n", scene.getTriangleCount(), buildSeconds * 1000.0, getHardwareThreadCount());
+
+    CameraPath views = CameraPath::fromViews(std::vector<CameraPathFrame>(std::begin(BENCHMARK_VIEWS), std::end(BENCHMARK_VIEWS)), 1);
+    Camera viewCamera;
+    for (size_t i = 0; i < views.size(); i++)
+    {
+        views.apply(viewCamera, i);
+        glm::mat4 projection = glm::perspective(glm::radians(viewCamera.Zoom), (float)width / (float)height, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
+        auto start = std::chrono::steady_clock::now();
+        AOImage image = renderReferenceAO(scene, viewCamera.GetViewMatrix(), projection, width, height, settings);
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::string path = directory + "/reference_view" + std::to_string(i) + ".pfm";
+        if (!image.savePfm(path))
+            return false;
+        printf("%s (%ux%u, %d samples): %.2f s, %.1f Mrays/s\n", path.c_str(), width, height, settings.samples, seconds,
+            (double)width * height * (settings.samples + 1) / seconds / 1000000.0);
+    }
+    return true;
+}
+
+// BVH build time on one and all threads and the ray rate of the reference renderer's primary (closest hit) and AO
+// (any hit within the reference radius) rays for every built-in view, node layout and single ray or packet
+// traversal, written to path (--bvh-benchmark)
+bool writeBvhBenchmark(const std::string& path, Model& mainModel, unsigned int width, unsigned int height, const AOReferenceSettings& settings)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::BVH_BENCHMARK::FAILED_TO_WRITE: " << path << std::endl;
+        return false;
+    }
+    auto measure = [](auto body)
+    {
+        auto start = std::chrono::steady_clock::now();
+        body();
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    AOScene scene;
+    scene.addCube(getRoomTransform());
+    for (int i = 0; i < SCENE_MODEL_COUNT; i++)
+        scene.addModel(mainModel, getModelTransform(i));
+    double singleBuildMs = measure([&]() { scene.build(1); });
+    double buildMs = measure([&]() { scene.build(); });
+    int threads = getHardwareThreadCount();
+    printf("bvh: %zu triangles (%zu in meshes), built in %.2f ms on 1 thread, %.2f ms on %d threads\n",
+        scene.getTriangleCount(), scene.getMeshTriangleCount(), singleBuildMs, buildMs, threads);
+    file << "# triangles: " << scene.getTriangleCount() << "\n";
+    file << "# mesh_triangles: " << scene.getMeshTriangleCount() << "\n";
+    for (AOBvhLayout layout : AO_BVH_LAYOUTS)
+    {
+        printf("bvh %s: %zu nodes (%zu bytes)\n", getAOBvhLayoutName(layout).c_str(), scene.getNodeCount(layout),
+            scene.getNodeCount(layout) * AOScene::getNodeSize(layout));
+        file << "# nodes_" << getAOBvhLayoutName(layout) << ": " << scene.getNodeCount(layout) << "\n";
+    }
+    file << "# build_ms_1_thread: " << singleBuildMs << "\n";
+    file << "# build_ms_" << threads << "_threads: " << buildMs << "\n";
+    file << "resolution,view,layout,traversal,rays,ray_count,ms,mrays_per_s\n";
+
+    CameraPath views = CameraPath::fromViews(std::vector<CameraPathFrame>(std::begin(BENCHMARK_VIEWS), std::end(BENCHMARK_VIEWS)), 1);
+    Camera viewCamera;
+    std::vector<AOSurface> surfaces((size_t)width * height);
+    AOImage image;
+    image.resize(width, height);
+    AOBvhLayout defaultLayout = scene.getLayout();
+    for (size_t i = 0; i < views.size(); i++)
+    {
+        views.apply(viewCamera, i);
+        glm::mat4 view = viewCamera.GetViewMatrix();
+        glm::mat4 projection = glm::perspective(glm::radians(viewCamera.Zoom), (float)width / (float)height, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
+        glm::mat4 invViewProjection = glm::inverse(projection * view);
+        glm::vec3 eye = glm::vec3(glm::inverse(view)[3]);
+        for (AOBvhLayout layout : AO_BVH_LAYOUTS)
+        {
+            scene.setLayout(layout);
+            for (bool packets : { false, true })
+            {
+                AOReferenceSettings traversalSettings = settings;
+                traversalSettings.packets = packets;
+                double primaryMs = measure([&]()
+                {
+                    parallelFor((int)height, [&](int y)
+                    {
+                        traceAOSurfaceRow(scene, invViewProjection, eye, y, width, height, packets, &surfaces[(size_t)y * width]);
+                    });
+                });
+                size_t hits = std::count_if(surfaces.begin(), surfaces.end(), [](const AOSurface& surface) { return surface.hit; });
+                double aoMs = measure([&]()
+                {
+                    parallelFor((int)height, [&](int y)
+                    {
+                        for (int x = 0; x < (int)width; x++)
+                        {
+                            const AOSurface& surface = surfaces[(size_t)y * width + x];
+                            image.pixels[(size_t)y * width + x] = surface.hit ? traceAOSamples(scene, surface, x, y, traversalSettings) : 1.0f;
+                        }
+                    });
+                });
+                size_t primaryRays = surfaces.size(), aoRays = hits * settings.samples;
+                std::string traversal = packets ? "packet" : "single";
+                printf("view %zu (%ux%u) %s %s: primary %.1f Mrays/s, ao %.1f Mrays/s (%d samples, radius %.2f)\n", i, width, height,
+                    getAOBvhLayoutName(layout).c_str(), traversal.c_str(), primaryRays / primaryMs / 1000.0, aoRays / aoMs / 1000.0,
+                    settings.samples, settings.radius);
+                std::string prefix = getResolutionName(width, height) + "," + std::to_string(i) + "," + getAOBvhLayoutName(layout) + "," + traversal;
+                file << prefix << ",primary," << primaryRays << "," << primaryMs << "," << primaryRays / primaryMs / 1000.0 << "\n";
+                file << prefix << ",ao," << aoRays << "," << aoMs << "," << aoRays / aoMs / 1000.0 << "\n";
+            }
+        }
+    }
+    scene.setLayout(defaultLayout);
+    return true;
+}
+
+// CPU AO engine run on a frame read back from the GL path (--cpu-ao)
+const float CPU_AO_TOLERANCE = 1.0f / 256.0f;
+// every timing is the fastest of this many runs, single runs vary by a third on a busy machine
+const int CPU_AO_TIMING_RUNS = 3;
+
+// SIMD kernel on a TileScheduler with a given number of threads
+struct CpuAOScalingPoint
+{
+    int threads = 0;
+    double ms = 0.0;
+    double utilization = 0.0;    // mean share of the wall time the threads spent running tiles
+    double minUtilization = 0.0; // least busy thread
+    int steals = 0;              // tiles run by another thread than the one they were queued on
+};
+
+struct CpuAOResult
+{
+    std::string resolution;
+    int view = 0;
+    RenderMode mode = RenderMode::NONE;
+    int threads = 0;
+    double naiveMs = 0.0;    // straightforward scalar port, single thread
+    double simdMs = 0.0;     // SIMD kernel, single thread
+    double threadedMs = 0.0; // SIMD kernel, all threads
+    std::vector<CpuAOScalingPoint> scaling; // SIMD kernel at 1, 2, 4, ... and all threads
+    float maxDifference = 0.0f;    // threaded result against the shader output
+    double mismatchFraction = 0.0; // pixels differing by more than CPU_AO_TOLERANCE
 };
 
+CpuGBuffer readGBuffer(const RenderTargets& targets)
+{
+    CpuGBuffer gBuffer;
+    gBuffer.resize(targets.width, targets.height);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    // the depth buffer linearized like the AO shaders do it (HARDWARE_DEPTH)
+    glBindTexture(GL_TEXTURE_2D, targets.gDepth);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, GL_FLOAT, gBuffer.linearDepth.data());
+    for (float& depth : gBuffer.linearDepth)
+    {
+        if (depth == 1.0f)
+            continue;
+        float ndc = depth * 2.0f - 1.0f;
+        float viewDepth = 2.0f * CAMERA_NEAR_PLANE * CAMERA_FAR_PLANE /
+            (CAMERA_NEAR_PLANE + CAMERA_FAR_PLANE + ndc * (CAMERA_NEAR_PLANE - CAMERA_FAR_PLANE));
+        depth = (viewDepth - CAMERA_NEAR_PLANE) / (CAMERA_FAR_PLANE - CAMERA_NEAR_PLANE);
+    }
+    glBindTexture(GL_TEXTURE_2D, targets.gNormal);
+    glGetTexImage(GL_TEXTURE_2D, 0, GL_RGB, GL_FLOAT, gBuffer.normals.data());
+    return gBuffer;
+}
+
+// times the naive port and the SIMD kernel on 1, 2, 4, ... and all threads, the last result is compared with the shader output
+template <typename Engine, typename Settings>
+void measureCpuAO(const Settings& settings, void (*kernel)(const Settings&, const CpuGBuffer&, AOImage&, TileScheduler&),
+    const CpuGBuffer& gBuffer, const AOImage& gpuImage, CpuAOResult& result)
+{
+    Engine engine(settings);
+    AOImage image;
+    auto measure = [&](auto render)
+    {
+        double fastest = 0.0;
+        for (int run = 0; run < CPU_AO_TIMING_RUNS; run++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            render();
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            fastest = run == 0 ? ms : std::min(fastest, ms);
+        }
+        return fastest;
+    };
+    result.threads = getHardwareThreadCount();
+    result.naiveMs = measure([&]() { engine.renderNaive(gBuffer, image); });
+    for (int threads = 1; ; threads = std::min(threads * 2, result.threads))
+    {
+        TileScheduler scheduler(threads);
+        CpuAOScalingPoint point;
+        point.threads = threads;
+        point.ms = measure([&]() { kernel(settings, gBuffer, image, scheduler); });
+        point.minUtilization = 1.0;
+        for (int i = 0; i < threads; i++)
+        {
+            point.utilization += scheduler.getUtilization(i) / threads;
+            point.minUtilization = std::min(point.minUtilization, scheduler.getUtilization(i));
+            point.steals += scheduler.getStats()[i].steals;
+        }
+        result.scaling.push_back(point);
+        if (threads == result.threads)
+            break;
+    }
+    result.simdMs = result.scaling.front().ms;
+    result.threadedMs = result.scaling.back().ms;
+
+    size_t mismatches = 0;
+    for (size_t i = 0; i < image.pixels.size(); i++)
+    {
+        float difference = fabsf(image.pixels[i] - gpuImage.pixels[i]);
+        result.maxDifference = std::max(result.maxDifference, difference);
+        if (difference > CPU_AO_TOLERANCE)
+            mismatches++;
+    }
+    result.mismatchFraction = (double)mismatches / image.pixels.size();
+}
+
+bool writeCpuAOReport(const std::string& path, const CpuAOKernels& kernels, const std::vector<CpuAOResult>& results)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::CPU_AO_REPORT::FAILED_TO_WRITE: " << path << std::endl;
+        return false;
+    }
+    file << "# isa: " << getCpuISAName(kernels.isa) << "\n";
+    file << "# simd_width: " << kernels.width << "\n";
+    file << "resolution,view,mode,threads,naive_ms,simd_ms,threaded_ms,speedup,max_diff,mismatch_fraction\n";
+    for (const auto& result : results)
+    {
+        file << result.resolution << "," << result.view << "," << getRenderModeName(result.mode) << "," << result.threads << ","
+             << result.naiveMs << "," << result.simdMs << "," << result.threadedMs << "," << result.naiveMs / result.threadedMs << ","
+             << result.maxDifference << "," << result.mismatchFraction << "\n";
+    }
+    return true;
+}
+
+// parallel efficiency of the SIMD kernel (speedup over one thread divided by the thread count) and the scheduler counters
+bool writeCpuAOScalingReport(const std::string& path, const std::vector<CpuAOResult>& results)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::CPU_AO_REPORT::FAILED_TO_WRITE: " << path << std::endl;
+        return false;
+    }
+    file << "resolution,view,mode,threads,ms,speedup,efficiency,utilization,min_utilization,steals\n";
+    for (const auto& result : results)
+    {
+        for (const auto& point : result.scaling)
+        {
+            double speedup = result.simdMs / point.ms;
+            file << result.resolution << "," << result.view << "," << getRenderModeName(result.mode) << "," << point.threads << ","
+                 << point.ms << "," << speedup << "," << speedup / point.threads << ","
+                 << point.utilization << "," << point.minUtilization << "," << point.steals << "\n";
+        }
+    }
+    return true;
+}
+
+// software rasterizer run with the camera of a frame, its G-buffer is compared with the one of the geometry pass (--cpu-ao)
+const float CPU_RASTER_LINEAR_DEPTH_TOLERANCE = 1e-3f;
+const float CPU_RASTER_NORMAL_TOLERANCE = 1e-2f; // gNormal is a half float target
+
+struct CpuRasterResult
+{
+    std::string resolution;
+    int view = 0;
+    int threads = 0;
+    double singleMs = 0.0;   // one thread
+    double threadedMs = 0.0; // all threads
+    CpuRasterStats stats;
+    double linearDepthMismatchFraction = 0.0; // pixels whose linear depth differs by more than CPU_RASTER_LINEAR_DEPTH_TOLERANCE
+    double normalMismatchFraction = 0.0;      // pixels with a gNormal component off by more than CPU_RASTER_NORMAL_TOLERANCE
+};
+
+void measureCpuRaster(const CpuRasterView& view, CpuRasterScene& scene,
+    void (*kernel)(const CpuRasterView&, CpuRasterScene&, CpuGBuffer&, TileScheduler&), const CpuGBuffer& gpuGBuffer, CpuRasterResult& result)
+{
+    CpuGBuffer gBuffer;
+    auto measure = [&](TileScheduler& scheduler)
+    {
+        auto start = std::chrono::steady_clock::now();
+        kernel(view, scene, gBuffer, scheduler);
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    TileScheduler singleScheduler(1);
+    TileScheduler scheduler;
+    measure(scheduler); // allocates the bins
+    result.threads = scheduler.getThreadCount();
+    result.singleMs = measure(singleScheduler);
+    result.threadedMs = measure(scheduler);
+    result.stats = scene.getStats();
+
+    size_t depthMismatches = 0, normalMismatches = 0;
+    for (size_t i = 0; i < gBuffer.linearDepth.size(); i++)
+    {
+        if (fabsf(gBuffer.linearDepth[i] - gpuGBuffer.linearDepth[i]) > CPU_RASTER_LINEAR_DEPTH_TOLERANCE)
+            depthMismatches++;
+        glm::vec3 difference = glm::abs(gBuffer.normals[i] - gpuGBuffer.normals[i]);
+        if (std::max(difference.x, std::max(difference.y, difference.z)) > CPU_RASTER_NORMAL_TOLERANCE)
+            normalMismatches++;
+    }
+    result.linearDepthMismatchFraction = (double)depthMismatches / gBuffer.linearDepth.size();
+    result.normalMismatchFraction = (double)normalMismatches / gBuffer.normals.size();
+}
+
+bool writeCpuRasterReport(const std::string& path, const CpuAOKernels& kernels, const std::vector<CpuRasterResult>& results)
+{
+    std::ofstream file(path);
+    if (!file)
+    {
+        std::cout << "ERROR::CPU_AO_REPORT::FAILED_TO_WRITE: " << path << std::endl;
+        return false;
+    }
+    file << "# isa: " << getCpuISAName(kernels.isa) << "\n";
+    file << "resolution,view,triangles,binned,tile_hiz_rejects,blocks,block_hiz_rejects,single_ms,threads,threaded_ms,speedup,"
+            "linear_depth_mismatch_fraction,normal_mismatch_fraction\n";
+    for (const auto& result : results)
+    {
+        file << result.resolution << "," << result.view << "," << result.stats.triangles << "," << result.stats.binned << ","
+             << result.stats.tileHiZRejects << "," << result.stats.blocks << "," << result.stats.blockHiZRejects << ","
+             << result.singleMs << "," << result.threads << "," << result.threadedMs << "," << result.singleMs / result.threadedMs << ","
+             << result.linearDepthMismatchFraction << "," << result.normalMismatchFraction << "\n";
+    }
+    return true;
+}
+
 float lerp(float a, float b, float f)
 {
     return a + f * (b - a);
 }
 
-unsigned int getSSAONoiseTexture()
+std::vector<glm::vec3> getSSAOKernel(unsigned int kernelSize)
+{
+    std::uniform_real_distribution<GLfloat> randomFloats(0.0, 1.0); // generates random floats between 0.0 and 1.0
+    std::default_random_engine generator;
+    std::vector<glm::vec3> ssaoKernel;
+    for (unsigned int i = 0; i < kernelSize; ++i)
+    {
+        glm::vec3 sample(randomFloats(generator) * 2.0 - 1.0, randomFloats(generator) * 2.0 - 1.0, randomFloats(generator));
+        sample = glm::normalize(sample);
+        sample *= randomFloats(generator);
+        float scale = float(i) / kernelSize;
+
+        scale = lerp(0.1f, 1.0f, scale * scale);
+        sample *= scale;
+        ssaoKernel.push_back(sample);
+    }
+    return ssaoKernel;
+}
+
+std::vector<glm::vec3> getSSAONoise()
 {
     std::vector<glm::vec3> ssaoNoise;
     for (int i = 0; i < NOISE_TEXTURE_RES * NOISE_TEXTURE_RES; i++)
@@ -98,7 +1016,11 @@ unsigned int getSSAONoiseTexture()
         glm::vec3 noise(glm::linearRand(0.0f, 1.0f) * 2.0 - 1.0, glm::linearRand(0.0f, 1.0f) * 2.0 - 1.0, 0.0f); // rotate around z-axis (in tangent space)
         ssaoNoise.push_back(glm::normalize(noise));
     }
+    return ssaoNoise;
+}
 
+unsigned int getSSAONoiseTexture(const std::vector<glm::vec3>& ssaoNoise)
+{
     unsigned int noiseTexture;
     glGenTextures(1, &noiseTexture);
     glBindTexture(GL_TEXTURE_2D, noiseTexture);
@@ -111,7 +1033,8 @@ unsigned int getSSAONoiseTexture()
     return noiseTexture;
 }
 
-unsigned int getHBAONoiseTexture()
+// rounded to half precision, the texture stores them as RGBA16F
+std::vector<glm::vec4> getHBAONoise()
 {
     std::vector<glm::vec4> noise;
     for (int y = 0; y < NOISE_TEXTURE_RES; y++)
@@ -121,10 +1044,14 @@ unsigned int getHBAONoiseTexture()
             glm::vec2 xy = glm::circularRand(1.0f);
             float z = glm::linearRand(0.0f, 1.0f);
             float w = glm::linearRand(0.0f, 1.0f);
-            noise.push_back(glm::vec4(xy, z, w));
+            noise.push_back(glm::unpackHalf4x16(glm::packHalf4x16(glm::vec4(xy, z, w))));
         }
     }
-       
+    return noise;
+}
+
+unsigned int getHBAONoiseTexture(const std::vector<glm::vec4>& noise)
+{
     unsigned int noiseTexture;
     glGenTextures(1, &noiseTexture);
     glBindTexture(GL_TEXTURE_2D, noiseTexture);
@@ -137,10 +1064,10 @@ unsigned int getHBAONoiseTexture()
     return noiseTexture;
 }
 
-unsigned int getGTAONoiseTexture()
+// direction noise and step offset as the shader reads them from the RG8 texture
+std::vector<glm::vec2> getGTAONoise()
 {
-    const int BYTES_PER_PIXEL = 2;
-    uint8_t noise[NOISE_TEXTURE_RES * NOISE_TEXTURE_RES * BYTES_PER_PIXEL];
+    std::vector<glm::vec2> noise;
     for (uint8_t i = 0; i < NOISE_TEXTURE_RES; i++) 
     {
         for (uint8_t j = 0; j < NOISE_TEXTURE_RES; j++) 
@@ -148,10 +1075,20 @@ unsigned int getGTAONoiseTexture()
             float dirnoise = 0.0625f * ((((i + j) & 0x3) << 2) + (i & 0x3));
             float offnoise = 0.25f * ((j - i) & 0x3);
 
-            noise[(i * NOISE_TEXTURE_RES + j) * BYTES_PER_PIXEL + 0] = (uint8_t)(dirnoise * 255.0f);
-            noise[(i * NOISE_TEXTURE_RES + j) * BYTES_PER_PIXEL + 1] = (uint8_t)(offnoise * 255.0f);
+            noise.push_back(glm::vec2((uint8_t)(dirnoise * 255.0f), (uint8_t)(offnoise * 255.0f)) / 255.0f);
         }
     }
+    return noise;
+}
+
+unsigned int getGTAONoiseTexture(const std::vector<glm::vec2>& gtaoNoise)
+{
+    std::vector<uint8_t> noise;
+    for (const auto& value : gtaoNoise)
+    {
+        noise.push_back((uint8_t)roundf(value.x * 255.0f));
+        noise.push_back((uint8_t)roundf(value.y * 255.0f));
+    }
 
     unsigned int noiseTexture;
     glGenTextures(1, &noiseTexture);
@@ -160,7 +1097,7 @@ unsigned int getGTAONoiseTexture()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, NOISE_TEXTURE_RES, NOISE_TEXTURE_RES, 0, GL_RG, GL_UNSIGNED_BYTE, noise);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG8, NOISE_TEXTURE_RES, NOISE_TEXTURE_RES, 0, GL_RG, GL_UNSIGNED_BYTE, noise.data());
 
     return noiseTexture;
 }
@@ -177,65 +1114,359 @@ unsigned int getEmptyAOTexture()
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, 1, 1, 0, GL_RG, GL_FLOAT, data);
 
-    return texture;
-}
+    return texture;
+}
+
+void openglMessageCallback(
+    GLenum source,
+    GLenum type,
+    GLuint id,
+    GLenum severity,
+    GLsizei length,
+    const GLchar* message,
+    const void* userParam)
+{
+    if (severity == GL_DEBUG_SEVERITY_HIGH)
+    {
+        std::cout << "OpenGL: " << message << std::endl;
+#ifdef _MSC_VER
+        __debugbreak();
+#endif
+    }
+}
+
+int main(int argc, char** argv)
+{
+    // command line
+    // ------------
+    HeadlessBenchmark benchmark;
+    CameraPath cameraPath;
+    bool playCameraPath = false;
+    bool framesSpecified = false;
+    std::string cameraPathRecordFile;
+    ParameterSweep sweep;
+    bool sweeping = false;
+    std::string compareBaseline, compareCandidate;
+    double compareAlpha = BENCHMARK_COMPARE_ALPHA;
+    double compareThreshold = BENCHMARK_COMPARE_THRESHOLD_PERCENT;
+    std::string qualityReferenceDir;
+    bool cpuAO = false;
+    const CpuAOKernels* cpuKernels = getBestCpuAOKernels();
+    std::string referenceOutputDir;
+    bool bvhBenchmark = false;
+    AOReferenceSettings referenceSettings;
+    referenceSettings.samples = REFERENCE_AO_SAMPLES;
+    referenceSettings.radius = REFERENCE_AO_RADIUS;
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+            headless = true;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+        {
+            benchmark.recordFrames = std::max(1, atoi(argv[++i]));
+            framesSpecified = true;
+        }
+        else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc)
+            benchmark.warmupFrames = std::max(0, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--record-path") == 0 && i + 1 < argc)
+            cameraPathRecordFile = argv[++i];
+        else if (strcmp(argv[i], "--play-path") == 0 && i + 1 < argc)
+        {
+            if (!cameraPath.load(argv[++i]))
+                return -1;
+            playCameraPath = true;
+            cameraSource = argv[i];
+        }
+        else if (strcmp(argv[i], "--views") == 0)
+        {
+            cameraPath = CameraPath::fromViews(
+                std::vector<CameraPathFrame>(std::begin(BENCHMARK_VIEWS), std::end(BENCHMARK_VIEWS)),
+                CAMERA_PATH_FRAMES_PER_VIEW);
+            playCameraPath = true;
+            cameraSource = "views";
+        }
+        else if (strcmp(argv[i], "--sweep") == 0 && i + 1 < argc)
+        {
+            if (!sweep.load(argv[++i]))
+                return -1;
+            sweeping = true;
+        }
+        else if (strcmp(argv[i], "--resolution") == 0 && i + 1 < argc)
+        {
+            if (!parseResolution(argv[++i], srcWidth, srcHeight))
+            {
+                std::cout << "invalid resolution: " << argv[i] << " (expected WIDTHxHEIGHT)\n";
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--ao-scale") == 0 && i + 1 < argc)
+        {
+            aoScale = atoi(argv[++i]);
+            if (aoScale != 1 && aoScale != 2 && aoScale != 4)
+            {
+                std::cout << "invalid AO scale: " << argv[i] << " (expected 1, 2 or 4)\n";
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--deinterleave") == 0)
+        {
+            deinterleaveAO = true;
+        }
+        else if (strcmp(argv[i], "--depth-pyramid") == 0)
+        {
+            depthPyramidAO = true;
+        }
+        else if (strcmp(argv[i], "--compute") == 0)
+        {
+            computeAO = true;
+        }
+        else if (strcmp(argv[i], "--blur-radius") == 0 && i + 1 < argc)
+        {
+            blurRadius = atoi(argv[++i]);
+            if (blurRadius < 1)
+            {
+                std::cout << "invalid blur radius: " << argv[i] << " (expected 1 or more)\n";
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--resolutions") == 0 && i + 1 < argc)
+        {
+            // comma separated list, e.g. 1280x720,1920x1080,3840x2160
+            std::stringstream list(argv[++i]);
+            std::string item;
+            while (std::getline(list, item, ','))
+            {
+                glm::uvec2 resolution;
+                if (!parseResolution(item.c_str(), resolution.x, resolution.y))
+                {
+                    std::cout << "invalid resolution: " << item << " (expected WIDTHxHEIGHT)\n";
+                    return -1;
+                }
+                benchmark.resolutions.push_back(resolution);
+            }
+            headless = true;
+        }
+        else if (strcmp(argv[i], "--quality") == 0 && i + 1 < argc)
+        {
+            qualityReferenceDir = argv[++i];
+            headless = true;
+        }
+        else if (strcmp(argv[i], "--cpu-ao") == 0)
+        {
+            cpuAO = true;
+            headless = true;
+        }
+        else if (strcmp(argv[i], "--cpu-pipeline") == 0)
+        {
+            cpuPipelineAO = true;
+        }
+        else if (strcmp(argv[i], "--cpu-isa") == 0 && i + 1 < argc)
+        {
+            // forces the instruction set of the CPU AO kernels instead of the widest one the CPU supports
+            CpuISA isa;
+            if (!parseCpuISA(argv[++i], isa))
+            {
+                std::cout << "unknown instruction set: " << argv[i] << " (expected scalar, sse2, sse4.2, avx2, avx512 or neon)\n";
+                return -1;
+            }
+            cpuKernels = getCpuAOKernels(isa);
+            if (!cpuKernels)
+            {
+                std::cout << "ERROR::CPU_AO::ISA_NOT_SUPPORTED: " << argv[i] << std::endl;
+                return -1;
+            }
+        }
+        else if (strcmp(argv[i], "--reference") == 0 && i + 1 < argc)
+        {
+            referenceOutputDir = argv[++i];
+            headless = true;
+        }
+        else if (strcmp(argv[i], "--bvh-benchmark") == 0)
+        {
+            bvhBenchmark = true;
+            headless = true;
+        }
+        else if (strcmp(argv[i], "--reference-samples") == 0 && i + 1 < argc)
+            referenceSettings.samples = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--reference-radius") == 0 && i + 1 < argc)
+            referenceSettings.radius = (float)atof(argv[++i]);
+        else if (strcmp(argv[i], "--compare") == 0 && i + 2 < argc)
+        {
+            compareBaseline = argv[++i];
+            compareCandidate = argv[++i];
+        }
+        else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc)
+            compareThreshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--alpha") == 0 && i + 1 < argc)
+            compareAlpha = atof(argv[++i]);
+        else
+        {
+            std::cout << "usage: " << argv[0] << " [--headless] [--frames N] [--warmup N] [--record-path FILE | --play-path FILE | --views] [--sweep FILE | --quality REFERENCE_DIR] [--cpu-ao | --cpu-pipeline] [--cpu-isa ISA]"
+                      << " [--resolution WxH | --resolutions WxH,WxH,...] [--ao-scale 1|2|4] [--deinterleave] [--depth-pyramid] [--compute] [--blur-radius N]\n";
+            std::cout << "       " << argv[0] << " --reference OUTPUT_DIR [--resolution WxH] [--reference-samples N] [--reference-radius R]\n";
+            std::cout << "       " << argv[0] << " --bvh-benchmark [--resolution WxH] [--reference-samples N] [--reference-radius R]\n";
+            std::cout << "       " << argv[0] << " --compare BASELINE CANDIDATE [--threshold PERCENT] [--alpha A]\n";
+            return -1;
+        }
+    }
+    // A/B comparison of two recorded runs, no rendering. exit code 1 means a significant regression
+    if (!compareBaseline.empty())
+    {
+        BenchmarkRun baselineRun, candidateRun;
+        if (!baselineRun.load(compareBaseline) || !candidateRun.load(compareCandidate))
+            return -1;
+        return compareBenchmarkRuns(baselineRun, candidateRun, compareAlpha, compareThreshold) > 0 ? 1 : 0;
+    }
+    if (playCameraPath && !cameraPathRecordFile.empty())
+    {
+        std::cout << "camera path can not be recorded and played at the same time\n";
+        return -1;
+    }
+    // parameter sweep runs headless, one run per point of the sweep
+    if (sweeping)
+    {
+        benchmark.sweep = true;
+        benchmark.sweepMode = getRenderModeByName(sweep.mode);
+        if (benchmark.sweepMode == RenderMode::NONE)
+        {
+            std::cout << "unknown sweep mode: " << sweep.mode << " (expected ssao, hbao or gtao)\n";
+            return -1;
+        }
+        for (const auto& parameter : sweep.parameters)
+        {
+            if (!AOSettings().set(benchmark.sweepMode, parameter.name, parameter.values[0]))
+            {
+                std::cout << "unknown " << sweep.mode << " parameter: " << parameter.name << "\n";
+                return -1;
+            }
+        }
+        benchmark.runsPerResolution = (int)sweep.size();
+        headless = true;
+    }
+    if (cpuPipelineAO && (cpuAO || aoScale != 1))
+    {
+        std::cout << "--cpu-pipeline renders the AO at full resolution on the CPU, it can not be combined with --cpu-ao or --ao-scale\n";
+        return -1;
+    }
+    // quality harness renders the built-in views, one view after another, CPU AO engines are validated on the same frames
+    if (!qualityReferenceDir.empty() || cpuAO)
+    {
+        if (sweeping || playCameraPath)
+        {
+            std::cout << "quality harness uses the built-in views, it can not be combined with --sweep or camera paths\n";
+            return -1;
+        }
+        benchmark.quality = true;
+        benchmark.runsPerResolution = (int)std::size(BENCHMARK_VIEWS) * HeadlessBenchmark::QUALITY_RUNS_PER_VIEW;
+        cameraPath = CameraPath::fromViews(std::vector<CameraPathFrame>(std::begin(BENCHMARK_VIEWS), std::end(BENCHMARK_VIEWS)), 1);
+        cameraSource = "views";
+    }
+    // by default a headless run covers the whole camera path once
+    if (playCameraPath && !framesSpecified)
+        benchmark.recordFrames = (int)cameraPath.size();
+
+    GLFWwindow* window = NULL;
+    HeadlessContext headlessContext;
+    if (headless)
+    {
+        // offscreen context, everything is rendered into framebuffer objects
+        // -------------------------------------------------------------------
+        // 4.3 for the compute AO shaders, everything else runs on 3.3
+        if (!headlessContext.create(4, 3, 3, 3))
+            return -1;
 
-void openglMessageCallback(
-    GLenum source,
-    GLenum type,
-    GLuint id,
-    GLenum severity,
-    GLsizei length,
-    const GLchar* message,
-    const void* userParam)
-{
-    if (severity == GL_DEBUG_SEVERITY_HIGH)
-        __debugbreak();
-}
+        if (!gladLoadGLLoader((GLADloadproc)HeadlessContext::getProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
 
-int main()
-{
-    // glfw: initialize and configure
-    // ------------------------------
-    glfwInit();
-    glfwWindowHint(GLFW_RESIZABLE, false);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+
+        std::cout << "headless context initialized: " << glGetString(GL_RENDERER) << "\n";
+        if (referenceOutputDir.empty() && !bvhBenchmark)
+        {
+            std::cout << "recording " << benchmark.recordFrames << " frames (" << benchmark.warmupFrames << " warmup) per "
+                      << (sweeping ? "sweep point, " + std::to_string(benchmark.runsPerResolution) + " points" : "mode");
+            if (!benchmark.resolutions.empty())
+                std::cout << " at " << benchmark.resolutions.size() << " resolutions";
+            std::cout << "\n";
+        }
+    }
+    else
+    {
+        // glfw: initialize and configure
+        // ------------------------------
+        glfwInit();
+        glfwWindowHint(GLFW_RESIZABLE, true);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
 
 #ifdef __APPLE__
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
 #endif
 
-    // glfw window creation
-    // --------------------
-    GLFWwindow* window = glfwCreateWindow(SRC_WIDTH, SRC_HEIGHT, "Research", NULL, NULL);
-    if (window == NULL)
-    {
-        std::cout << "Failed to create GLFW window" << std::endl;
-        glfwTerminate();
-        return -1;
-    }
-    glfwMakeContextCurrent(window);
-    glfwSetCursorPosCallback(window, mouse_callback);
-    glfwSetScrollCallback(window, scroll_callback);
+        // glfw window creation
+        // --------------------
+        window = glfwCreateWindow(srcWidth, srcHeight, "Research", NULL, NULL);
+        if (window == NULL)
+        {
+            // 4.3 for the compute AO shaders, everything else runs on 3.3
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+            glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+            window = glfwCreateWindow(srcWidth, srcHeight, "Research", NULL, NULL);
+        }
+        if (window == NULL)
+        {
+            std::cout << "Failed to create GLFW window" << std::endl;
+            glfwTerminate();
+            return -1;
+        }
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+        glfwSetCursorPosCallback(window, mouse_callback);
+        glfwSetScrollCallback(window, scroll_callback);
+        glfwSetKeyCallback(window, key_callback);
+
+        // tell GLFW to capture our mouse
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+        // glad: load all OpenGL function pointers
+        // ---------------------------------------
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+        {
+            std::cout << "Failed to initialize GLAD" << std::endl;
+            return -1;
+        }
 
-    // tell GLFW to capture our mouse
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        // render at the framebuffer resolution, it differs from the window size on high DPI displays
+        int framebufferWidth, framebufferHeight;
+        glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+        framebuffer_size_callback(window, framebufferWidth, framebufferHeight);
 
-    // glad: load all OpenGL function pointers
-    // ---------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-    {
-        std::cout << "Failed to initialize GLAD" << std::endl;
-        return -1;
+        std::cout << "context initialized!\n";
+        std::cout << "WASD - navigate, ESC - exit\n";
+        std::cout << "0 (NONE), 1 (SSAO), 2 (HBAO), 3 (GTAO) - switch modes\n";
+        std::cout << "B - enable/disable blur\n";
+        std::cout << "R - start recording, T - stop recording. output files: report_{mode}.json, record_{mode}.csv\n";
     }
 
-    std::cout << "context initialized!\n";
-    std::cout << "WASD - navigate, ESC - exit\n";
-    std::cout << "0 (NONE), 1 (SSAO), 2 (HBAO), 3 (GTAO) - switch modes\n";
-    std::cout << "B - enable/disable blur\n";
-    std::cout << "R - start recording, T - stop recording. output file: record_{mode}.txt\n";
+    computeAOSupported = GLAD_GL_VERSION_4_3;
+    if (!computeAOSupported)
+    {
+        if (computeAO)
+            std::cout << "ERROR::AO::COMPUTE_NOT_SUPPORTED: compute AO needs OpenGL 4.3, using the fragment shaders" << std::endl;
+        computeAO = false;
+        // the compute runs are the last ones of the benchmark
+        if (headless && !sweeping && !benchmark.quality)
+        {
+            std::cout << "OpenGL 4.3 not available, skipping the compute AO runs\n";
+            benchmark.runsPerResolution = HeadlessBenchmark::COMPUTE_MODE_RUN;
+        }
+    }
+    // the CPU pipeline replaces the deinterleaved, depth pyramid and compute variants, only the plain modes are run
+    if (cpuPipelineAO && headless && !sweeping && !benchmark.quality)
+        benchmark.runsPerResolution = HeadlessBenchmark::DEINTERLEAVED_MODE_RUN;
 
     // configure global opengl state
     // -----------------------------
@@ -248,106 +1479,83 @@ int main()
     // -------------------------
     Shader shaderGeometryPass("geometry.vs", "geometry.fs");
     Shader shaderLightingPass("fullscreen.vs", "lighting.fs");
-    Shader shaderSSAO("fullscreen.vs", "ssao.fs");
-    Shader shaderHBAO("fullscreen.vs", "hbao.fs");
-    Shader shaderGTAO("fullscreen.vs", "gtao.fs");
-    Shader shaderBoxBlur("fullscreen.vs", "box_blur.fs");
+    Shader shaderSSAO("fullscreen.vs", "ssao.fs", nullptr, getAODefines(RenderMode::SSAO));
+    Shader shaderHBAO("fullscreen.vs", "hbao.fs", nullptr, getAODefines(RenderMode::HBAO));
+    Shader shaderSSAODeinterleaved("fullscreen.vs", "ssao.fs", nullptr, getAODefines(RenderMode::SSAO, true));
+    Shader shaderHBAODeinterleaved("fullscreen.vs", "hbao.fs", nullptr, getAODefines(RenderMode::HBAO, true));
+    Shader shaderGTAO("fullscreen.vs", "gtao.fs", nullptr, getAODefines(RenderMode::GTAO));
+    std::string blurDefines = "#define KERNEL_RADIUS " + std::to_string(blurRadius) + "\n";
+    Shader shaderBilateralBlur("fullscreen.vs", "bilateral_blur.fs", nullptr, blurDefines);
+    Shader shaderAODownsample("fullscreen.vs", "ao_downsample.fs");
+    Shader shaderAOUpsample("fullscreen.vs", "ao_upsample.fs");
+    Shader shaderDeinterleave("fullscreen.vs", "deinterleave.fs", nullptr, getDepthInputDefines());
+    Shader shaderReinterleave("fullscreen.vs", "reinterleave.fs");
+    Shader shaderDepthPyramid("fullscreen.vs", "depth_pyramid.fs", nullptr, getDepthInputDefines());
+    // compute variants of the AO shaders, only with a GL 4.3 context
+    std::unique_ptr<ComputeShader> shaderSSAOCompute, shaderHBAOCompute, shaderGTAOCompute, shaderBilateralBlurCompute;
+    if (computeAOSupported)
+    {
+        shaderBilateralBlurCompute = std::make_unique<ComputeShader>("bilateral_blur.cs",
+            blurDefines + "#define GROUP_SIZE " + std::to_string(COMPUTE_BLUR_GROUP_SIZE) + "\n");
+    }
+    auto buildComputeAOShaders = [&]()
+    {
+        if (!computeAOSupported)
+            return;
+        shaderSSAOCompute = std::make_unique<ComputeShader>("ssao.cs", getAODefines(RenderMode::SSAO, false, true));
+        shaderHBAOCompute = std::make_unique<ComputeShader>("hbao.cs", getAODefines(RenderMode::HBAO, false, true));
+        shaderGTAOCompute = std::make_unique<ComputeShader>("gtao.cs", getAODefines(RenderMode::GTAO, false, true));
+    };
+    buildComputeAOShaders();
 
     // load models
     // -----------
-    Model mainModel(FileSystem::getPath("resources/objects/nanosuit/nanosuit.obj"));
-
-    // configure g-buffer framebuffer
-    // ------------------------------
-    unsigned int gBuffer;
-    glGenFramebuffers(1, &gBuffer);
-    glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-    unsigned int gAlbedo, gNormal, gGTAODepth, gDepth;
-    // color + specular color buffer
-    glGenTextures(1, &gAlbedo);
-    glBindTexture(GL_TEXTURE_2D, gAlbedo);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, SRC_WIDTH, SRC_HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gAlbedo, 0);
-    // normal color buffer
-    glGenTextures(1, &gNormal);
-    glBindTexture(GL_TEXTURE_2D, gNormal);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, SRC_WIDTH, SRC_HEIGHT, 0, GL_RGBA, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gNormal, 0);
-    // gtao depth buffer
-    glGenTextures(1, &gGTAODepth);
-    glBindTexture(GL_TEXTURE_2D, gGTAODepth);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, SRC_WIDTH, SRC_HEIGHT, 0, GL_RED, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gGTAODepth, 0);
-    // depth buffer
-    glGenTextures(1, &gDepth);
-    glBindTexture(GL_TEXTURE_2D, gDepth);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, SRC_WIDTH, SRC_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_BYTE, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, gDepth, 0);
-    // tell OpenGL which color attachments we'll use (of this framebuffer) for rendering 
-    unsigned int attachments[] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-    glDrawBuffers(std::size(attachments), attachments);
-    // finally check if framebuffer is complete
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-    // also create framebuffer to hold SSAO processing stage 
-    // -----------------------------------------------------
-    unsigned int ssaoFBO, ssaoBlurFBO;
-    glGenFramebuffers(1, &ssaoFBO);  
-    glGenFramebuffers(1, &ssaoBlurFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-    unsigned int ssaoColorBuffer, ssaoColorBufferBlur;
-    // SSAO color buffer
-    glGenTextures(1, &ssaoColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, SRC_WIDTH, SRC_HEIGHT, 0, GL_RG, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBuffer, 0);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "SSAO Framebuffer not complete!" << std::endl;
-    // and blur stage
-    glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-    glGenTextures(1, &ssaoColorBufferBlur);
-    glBindTexture(GL_TEXTURE_2D, ssaoColorBufferBlur);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG16F, SRC_WIDTH, SRC_HEIGHT, 0, GL_RG, GL_FLOAT, NULL);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ssaoColorBufferBlur, 0);
-    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
-        std::cout << "SSAO Blur Framebuffer not complete!" << std::endl;
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    std::string mainModelPath = FileSystem::getPath("resources/objects/nanosuit/nanosuit.obj");
+    Model mainModel(mainModelPath);
 
-    // generate sample kernel
-    // ----------------------
-    std::uniform_real_distribution<GLfloat> randomFloats(0.0, 1.0); // generates random floats between 0.0 and 1.0
-    std::default_random_engine generator;
-    std::vector<glm::vec3> ssaoKernel;
-    int kernelSize = 16;
-    for (unsigned int i = 0; i < kernelSize; ++i)
-    {
-        glm::vec3 sample(randomFloats(generator) * 2.0 - 1.0, randomFloats(generator) * 2.0 - 1.0, randomFloats(generator));
-        sample = glm::normalize(sample);
-        sample *= randomFloats(generator);
-        float scale = float(i) / kernelSize;
+    CpuRasterScene rasterScene = getCpuRasterScene(mainModel);
 
-        scale = lerp(0.1f, 1.0f, scale * scale);
-        sample *= scale;
-        ssaoKernel.push_back(sample);
+    // reference images are ray traced on the CPU, the context is only needed to load the model
+    if (!referenceOutputDir.empty())
+    {
+        bool written = writeReferenceImages(referenceOutputDir, mainModel, srcWidth, srcHeight, referenceSettings);
+        headlessContext.destroy();
+        return written ? 0 : -1;
+    }
+    if (bvhBenchmark)
+    {
+        bool written = writeBvhBenchmark("bvh.csv", mainModel, srcWidth, srcHeight, referenceSettings);
+        headlessContext.destroy();
+        return written ? 0 : -1;
     }
 
-    unsigned int ssaoNoiseTexture = getSSAONoiseTexture();
-    unsigned int hbaoNoiseTexture = getHBAONoiseTexture();
-    unsigned int gtaoNoiseTexture = getGTAONoiseTexture();
+    // bake the self-occlusion of the model, in model space so the radius is scaled by the model transform
+    AOReferenceSettings bakeSettings;
+    bakeSettings.samples = AO_BAKE_SAMPLES;
+    bakeSettings.radius = REFERENCE_AO_RADIUS / glm::length(glm::vec3(getModelTransform(0)[0]));
+    AOBake mainModelBake;
+    std::vector<unsigned int> bakeBuffers;
+    if (loadOrBakeVertexAO(mainModelPath, mainModel, bakeSettings, mainModelBake))
+        uploadAOBake(mainModel, mainModelBake, bakeBuffers);
+    // meshes without a bake (the room cube) read the current attribute value, unoccluded
+    glVertexAttrib1f(AO_BAKE_ATTRIBUTE, 1.0f);
+
+    // configure g-buffer, AO and screen framebuffers
+    // ----------------------------------------------
+    RenderTargets targets;
+    targets.create(srcWidth, srcHeight, aoScale, headless);
+    glViewport(0, 0, srcWidth, srcHeight);
+
+    // generate sample kernel
+    // ----------------------
+    std::vector<glm::vec3> ssaoKernel = getSSAOKernel(aoSettings.ssaoKernelSize);
+
+    std::vector<glm::vec3> ssaoNoise = getSSAONoise();
+    unsigned int ssaoNoiseTexture = getSSAONoiseTexture(ssaoNoise);
+    std::vector<glm::vec4> hbaoNoise = getHBAONoise();
+    unsigned int hbaoNoiseTexture = getHBAONoiseTexture(hbaoNoise);
+    std::vector<glm::vec2> gtaoNoise = getGTAONoise();
+    unsigned int gtaoNoiseTexture = getGTAONoiseTexture(gtaoNoise);
     unsigned int emptyAOTexture = getEmptyAOTexture();
 
     // shader configuration
@@ -357,292 +1565,979 @@ int main()
     shaderLightingPass.setInt("gNormal", 1);
     shaderLightingPass.setInt("ao", 2);
 
-    float fovRad = glm::radians(camera.Zoom);
-
-    glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SRC_WIDTH / (float)SRC_HEIGHT, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
-    glm::mat4 invProjection = glm::inverse(projection);
-    glm::vec4 projInfo = glm::vec4(
-        2.0f / (SRC_WIDTH * projection[0][0]),
-        2.0f / (SRC_HEIGHT * projection[1][1]),
-        -1.0f / projection[0][0],
-        -1.0f / projection[1][1]
-    );
-    glm::vec4 clipInfo = glm::vec4(
-        CAMERA_NEAR_PLANE,
-        CAMERA_FAR_PLANE,
-        0.5f * (SRC_HEIGHT / (2.0f * tanf(fovRad * 0.5f))),
-        0.0f
-    );
-
-    shaderGeometryPass.use();
-    shaderGeometryPass.setVec4("clipInfo", clipInfo);
-
-    shaderSSAO.use();
-    shaderSSAO.setFloat("sampleRadius", SSAO_SAMPLE_RADIUS);
-    shaderSSAO.setFloat("bias", SSAO_SAMPLE_BIAS);
-    shaderSSAO.setMat4("proj", projection);
-    shaderSSAO.setMat4("invProj", invProjection);
-    shaderSSAO.setInt("gDepth", 0);
-    shaderSSAO.setInt("gNormal", 1);
-    shaderSSAO.setInt("texNoise", 2);
-
+    // resolution and field of view dependent state, updated on resize and zoom
+    glm::mat4 projection;
+    glm::vec4 projInfo, clipInfo;
     glm::vec2 FocalLen, InvFocalLen, UVToViewA, UVToViewB, LinMAD;
-    FocalLen[0] = 1.0f / tanf(fovRad * 0.5f) * ((float)SRC_HEIGHT / (float)SRC_WIDTH);
-    FocalLen[1] = 1.0f / tanf(fovRad * 0.5f);
-    InvFocalLen[0] = 1.0f / FocalLen[0];
-    InvFocalLen[1] = 1.0f / FocalLen[1];
-
-    UVToViewA[0] = -2.0f * InvFocalLen[0];
-    UVToViewA[1] = -2.0f * InvFocalLen[1];
-    UVToViewB[0] = 1.0f * InvFocalLen[0];
-    UVToViewB[1] = 1.0f * InvFocalLen[1];
-
-    LinMAD[0] = (CAMERA_NEAR_PLANE - CAMERA_FAR_PLANE) / (2.0f * CAMERA_NEAR_PLANE * CAMERA_FAR_PLANE);
-    LinMAD[1] = (CAMERA_NEAR_PLANE + CAMERA_FAR_PLANE) / (2.0f * CAMERA_NEAR_PLANE * CAMERA_FAR_PLANE);
-    shaderHBAO.use();
-    shaderHBAO.setVec2("FocalLen", FocalLen);
-    shaderHBAO.setVec2("UVToViewA", UVToViewA);
-    shaderHBAO.setVec2("UVToViewB", UVToViewB);
-    shaderHBAO.setVec2("LinMAD", LinMAD);
-    shaderHBAO.setVec2("AORes", glm::vec2(SRC_WIDTH, SRC_HEIGHT));
-    shaderHBAO.setVec2("InvAORes", glm::vec2(1.0f / SRC_WIDTH, 1.0f / SRC_HEIGHT));
-    shaderHBAO.setFloat("R", HBAO_SAMPLE_RADIUS);
-    shaderHBAO.setFloat("R2", HBAO_SAMPLE_RADIUS * HBAO_SAMPLE_RADIUS);
-    shaderHBAO.setFloat("NegInvR2", -1.0f / (HBAO_SAMPLE_RADIUS * HBAO_SAMPLE_RADIUS));
-    shaderHBAO.setFloat("MaxRadiusPixels", HBAO_MAX_RADIUS_PIXELS);
-    shaderHBAO.setVec2("NoiseScale", glm::vec2((float)SRC_WIDTH / NOISE_TEXTURE_RES, (float)SRC_HEIGHT / NOISE_TEXTURE_RES));
-    shaderHBAO.setInt("NumDirections", HBAO_DIRS);
-    shaderHBAO.setInt("NumSamples", HBAO_SAMPLES);
-    shaderHBAO.setInt("gDepth", 0);
-    shaderHBAO.setInt("texNoise", 1);
+    float projectionZoom = 0.0f;
+    auto updateProjection = [&]()
+    {
+        float fovRad = glm::radians(camera.Zoom);
+        projectionZoom = camera.Zoom;
+
+        projection = glm::perspective(fovRad, (float)srcWidth / (float)srcHeight, CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
+        projInfo = glm::vec4(
+            2.0f / (srcWidth * projection[0][0]),
+            2.0f / (srcHeight * projection[1][1]),
+            -1.0f / projection[0][0],
+            -1.0f / projection[1][1]
+        );
+        clipInfo = glm::vec4(
+            CAMERA_NEAR_PLANE,
+            CAMERA_FAR_PLANE,
+            0.5f * (srcHeight / (2.0f * tanf(fovRad * 0.5f))),
+            0.0f
+        );
+
+        FocalLen[0] = 1.0f / tanf(fovRad * 0.5f) * ((float)srcHeight / (float)srcWidth);
+        FocalLen[1] = 1.0f / tanf(fovRad * 0.5f);
+        InvFocalLen[0] = 1.0f / FocalLen[0];
+        InvFocalLen[1] = 1.0f / FocalLen[1];
+
+        UVToViewA[0] = -2.0f * InvFocalLen[0];
+        UVToViewA[1] = -2.0f * InvFocalLen[1];
+        UVToViewB[0] = 1.0f * InvFocalLen[0];
+        UVToViewB[1] = 1.0f * InvFocalLen[1];
+
+        LinMAD[0] = (CAMERA_NEAR_PLANE - CAMERA_FAR_PLANE) / (2.0f * CAMERA_NEAR_PLANE * CAMERA_FAR_PLANE);
+        LinMAD[1] = (CAMERA_NEAR_PLANE + CAMERA_FAR_PLANE) / (2.0f * CAMERA_NEAR_PLANE * CAMERA_FAR_PLANE);
+
+        // passes turning the hardware depth into the linear depth
+        for (Shader* shader : { &shaderAODownsample, &shaderAOUpsample, &shaderDeinterleave, &shaderDepthPyramid })
+        {
+            shader->use();
+            shader->setVec2("LinMAD", LinMAD);
+            shader->setVec2("clipPlanes", glm::vec2(clipInfo));
+        }
+    };
+
+    // AO shaders depend on aoSettings, a parameter sweep rebuilds them for every point
+    auto configureAOShaders = [&]()
+    {
+        // AO passes work in pixels of the AO resolution, one of them covers aoScale x aoScale render pixels
+        float aoWidth = (float)targets.aoWidth, aoHeight = (float)targets.aoHeight;
+        float aoPixelSize = (float)targets.aoScale;
+        glm::vec4 aoProjInfo(projInfo.x * aoPixelSize, projInfo.y * aoPixelSize, projInfo.z, projInfo.w);
+        glm::vec4 aoClipInfo(clipInfo.x, clipInfo.y, clipInfo.z / aoPixelSize, clipInfo.w);
+
+        // fragment and compute variants take the same uniforms, the compute ones write image unit 0 instead of a
+        // framebuffer and ignore the noise scale
+        auto configureSSAO = [&](auto& shader)
+        {
+            shader.use();
+            shader.setFloat("sampleRadius", aoSettings.ssaoRadius);
+            shader.setFloat("bias", aoSettings.ssaoBias);
+            shader.setMat4("proj", projection);
+            shader.setInt("linearDepth", 0);
+            shader.setInt("gNormal", 1);
+            shader.setInt("texNoise", 2);
+            shader.setVec2("noiseScale", glm::vec2(aoWidth / NOISE_TEXTURE_RES, aoHeight / NOISE_TEXTURE_RES));
+            shader.setVec2("clipPlanes", glm::vec2(clipInfo));
+            shader.setVec2("LinMAD", LinMAD);
+            shader.setVec2("UVToViewA", UVToViewA);
+            shader.setVec2("UVToViewB", UVToViewB);
+        };
+        auto configureHBAO = [&](auto& shader)
+        {
+            shader.use();
+            shader.setVec2("FocalLen", FocalLen);
+            shader.setVec2("UVToViewA", UVToViewA);
+            shader.setVec2("UVToViewB", UVToViewB);
+            shader.setVec2("AORes", glm::vec2(aoWidth, aoHeight));
+            shader.setVec2("InvAORes", glm::vec2(1.0f / aoWidth, 1.0f / aoHeight));
+            shader.setFloat("R", aoSettings.hbaoRadius);
+            shader.setFloat("R2", aoSettings.hbaoRadius * aoSettings.hbaoRadius);
+            shader.setFloat("NegInvR2", -1.0f / (aoSettings.hbaoRadius * aoSettings.hbaoRadius));
+            shader.setFloat("MaxRadiusPixels", aoSettings.hbaoMaxRadiusPixels / aoPixelSize);
+            shader.setVec2("NoiseScale", glm::vec2(aoWidth / NOISE_TEXTURE_RES, aoHeight / NOISE_TEXTURE_RES));
+            shader.setInt("linearDepth", 0);
+            shader.setInt("texNoise", 1);
+            shader.setVec2("clipPlanes", glm::vec2(clipInfo));
+            shader.setVec2("LinMAD", LinMAD);
+        };
+        auto configureGTAO = [&](auto& shader)
+        {
+            shader.use();
+            shader.setVec4("clipInfo", aoClipInfo);
+            shader.setVec4("projInfo", aoProjInfo);
+            shader.setVec2("LinMAD", LinMAD);
+            shader.setInt("linearDepth", 0);
+            shader.setInt("gNormal", 1);
+            shader.setInt("texNoise", 2);
+        };
+        configureSSAO(shaderSSAO);
+        configureHBAO(shaderHBAO);
+        configureGTAO(shaderGTAO);
+        if (computeAOSupported)
+        {
+            configureSSAO(*shaderSSAOCompute);
+            configureHBAO(*shaderHBAOCompute);
+            configureGTAO(*shaderGTAOCompute);
+        }
+        // levels of the pyramid at the current AO resolution, the uniform only exists with --depth-pyramid
+        for (Shader* shader : { &shaderSSAO, &shaderHBAO, &shaderGTAO })
+        {
+            shader->use();
+            shader->setInt("depthPyramidMaxLevel", (int)targets.depthPyramidLevels - 1);
+        }
 
+        // deinterleaved variants render one layer at a time, HBAO steps in pixels of a layer
+        float layerWidth = (float)targets.layerWidth, layerHeight = (float)targets.layerHeight;
+        glm::vec2 layerScale(DEINTERLEAVE_FACTOR * layerWidth / aoWidth, DEINTERLEAVE_FACTOR * layerHeight / aoHeight);
+        shaderDeinterleave.use();
+        shaderDeinterleave.setVec2("clipPlanes", glm::vec2(clipInfo));
+
+        shaderSSAODeinterleaved.use();
+        shaderSSAODeinterleaved.setFloat("sampleRadius", aoSettings.ssaoRadius);
+        shaderSSAODeinterleaved.setFloat("bias", aoSettings.ssaoBias);
+        shaderSSAODeinterleaved.setMat4("proj", projection);
+        shaderSSAODeinterleaved.setVec2("UVToViewA", UVToViewA);
+        shaderSSAODeinterleaved.setVec2("UVToViewB", UVToViewB);
+        shaderSSAODeinterleaved.setVec2("LayerScale", layerScale);
+        shaderSSAODeinterleaved.setInt("layerDepth", 0);
+        shaderSSAODeinterleaved.setInt("gNormal", 1);
+
+        shaderHBAODeinterleaved.use();
+        shaderHBAODeinterleaved.setVec2("FocalLen", FocalLen);
+        shaderHBAODeinterleaved.setVec2("UVToViewA", UVToViewA);
+        shaderHBAODeinterleaved.setVec2("UVToViewB", UVToViewB);
+        shaderHBAODeinterleaved.setVec2("AORes", glm::vec2(layerWidth, layerHeight));
+        shaderHBAODeinterleaved.setVec2("InvAORes", glm::vec2(1.0f / layerWidth, 1.0f / layerHeight));
+        shaderHBAODeinterleaved.setFloat("R", aoSettings.hbaoRadius);
+        shaderHBAODeinterleaved.setFloat("R2", aoSettings.hbaoRadius * aoSettings.hbaoRadius);
+        shaderHBAODeinterleaved.setFloat("NegInvR2", -1.0f / (aoSettings.hbaoRadius * aoSettings.hbaoRadius));
+        shaderHBAODeinterleaved.setFloat("MaxRadiusPixels", aoSettings.hbaoMaxRadiusPixels / (aoPixelSize * DEINTERLEAVE_FACTOR));
+        shaderHBAODeinterleaved.setVec2("LayerScale", layerScale);
+        shaderHBAODeinterleaved.setInt("layerDepth", 0);
+    };
+    bool aoShadersDepthPyramid = depthPyramidAO; // depthPyramidAO the AO shaders are specialized for
+    auto rebuildAOShaders = [&]()
+    {
+        aoShadersDepthPyramid = depthPyramidAO;
+        glDeleteProgram(shaderSSAO.ID);
+        glDeleteProgram(shaderHBAO.ID);
+        glDeleteProgram(shaderSSAODeinterleaved.ID);
+        glDeleteProgram(shaderHBAODeinterleaved.ID);
+        glDeleteProgram(shaderGTAO.ID);
+        shaderSSAO = Shader("fullscreen.vs", "ssao.fs", nullptr, getAODefines(RenderMode::SSAO));
+        shaderHBAO = Shader("fullscreen.vs", "hbao.fs", nullptr, getAODefines(RenderMode::HBAO));
+        shaderSSAODeinterleaved = Shader("fullscreen.vs", "ssao.fs", nullptr, getAODefines(RenderMode::SSAO, true));
+        shaderHBAODeinterleaved = Shader("fullscreen.vs", "hbao.fs", nullptr, getAODefines(RenderMode::HBAO, true));
+        shaderGTAO = Shader("fullscreen.vs", "gtao.fs", nullptr, getAODefines(RenderMode::GTAO));
+        if (computeAOSupported)
+        {
+            glDeleteProgram(shaderSSAOCompute->ID);
+            glDeleteProgram(shaderHBAOCompute->ID);
+            glDeleteProgram(shaderGTAOCompute->ID);
+            buildComputeAOShaders();
+        }
+        ssaoKernel = getSSAOKernel(aoSettings.ssaoKernelSize);
+        configureAOShaders();
+    };
+    updateProjection();
+    configureAOShaders();
     int gtaoSampleIndex = 0;
-    shaderGTAO.use();
-    shaderGTAO.setVec4("clipInfo", clipInfo);
-    shaderGTAO.setVec4("projInfo", projInfo);
-    shaderGTAO.setInt("gDepth", 0);
-    shaderGTAO.setInt("gNormal", 1);
-    shaderGTAO.setInt("texNoise", 2);
+    glm::vec2 gtaoParams(0.0f); // temporal parameters of the last GTAO frame
 
-    shaderBoxBlur.use();
-    shaderBoxBlur.setInt("ssaoInput", 0);
+    // CPU AO engines and the software rasterizer with the settings of the AO shaders and the geometry pass
+    auto getCpuSSAOSettings = [&]()
+    {
+        CpuSSAOSettings settings;
+        settings.kernel = ssaoKernel;
+        settings.noise = ssaoNoise;
+        settings.noiseSize = NOISE_TEXTURE_RES;
+        settings.radius = aoSettings.ssaoRadius;
+        settings.bias = aoSettings.ssaoBias;
+        settings.projection = projection;
+        settings.uvToViewA = UVToViewA;
+        settings.uvToViewB = UVToViewB;
+        settings.clipPlanes = glm::vec2(clipInfo);
+        return settings;
+    };
+    auto getCpuHBAOSettings = [&]()
+    {
+        CpuHBAOSettings settings;
+        settings.focalLen = FocalLen;
+        settings.uvToViewA = UVToViewA;
+        settings.uvToViewB = UVToViewB;
+        settings.clipPlanes = glm::vec2(clipInfo);
+        settings.radius = aoSettings.hbaoRadius;
+        settings.maxRadiusPixels = aoSettings.hbaoMaxRadiusPixels;
+        settings.numDirections = aoSettings.hbaoDirections;
+        settings.numSteps = aoSettings.hbaoSteps;
+        settings.noise = hbaoNoise;
+        settings.noiseSize = NOISE_TEXTURE_RES;
+        return settings;
+    };
+    auto getCpuGTAOSettings = [&](const glm::mat4& invView)
+    {
+        CpuGTAOSettings settings;
+        settings.projInfo = projInfo;
+        settings.clipInfo = clipInfo;
+        settings.invView = invView;
+        settings.params = gtaoParams;
+        settings.numDirections = aoSettings.gtaoDirections;
+        settings.numSteps = aoSettings.gtaoSteps;
+        settings.radius = aoSettings.gtaoRadius;
+        settings.noise = gtaoNoise;
+        settings.noiseSize = NOISE_TEXTURE_RES;
+        return settings;
+    };
+    auto getCpuRasterView = [&](const glm::mat4& view)
+    {
+        CpuRasterView rasterView;
+        rasterView.view = view;
+        rasterView.projection = projection;
+        rasterView.nearPlane = CAMERA_NEAR_PLANE;
+        rasterView.farPlane = CAMERA_FAR_PLANE;
+        rasterView.width = srcWidth;
+        rasterView.height = srcHeight;
+        return rasterView;
+    };
+
+    // state of the CPU pipeline kept across frames: the scheduler's threads, the G-buffer, the AO and the
+    // AO target texels (AO and packed depth) it is uploaded as
+    std::unique_ptr<TileScheduler> cpuPipelineScheduler;
+    if (cpuPipelineAO)
+        cpuPipelineScheduler = std::make_unique<TileScheduler>();
+    CpuGBuffer cpuPipelineGBuffer;
+    AOImage cpuPipelineImage;
+    std::vector<glm::vec2> cpuPipelineTexels;
+
+    shaderBilateralBlur.use();
+    shaderBilateralBlur.setInt("ssaoInput", 0);
+    shaderBilateralBlur.setFloat("sharpness", BLUR_SHARPNESS);
+    if (computeAOSupported)
+    {
+        shaderBilateralBlurCompute->use();
+        shaderBilateralBlurCompute->setInt("ssaoInput", 0);
+        shaderBilateralBlurCompute->setInt("aoOutput", 0);
+        shaderBilateralBlurCompute->setFloat("sharpness", BLUR_SHARPNESS);
+    }
+    shaderAODownsample.use();
+    shaderAODownsample.setInt("gDepth", 0);
+    shaderAODownsample.setInt("gNormal", 1);
+    shaderAOUpsample.use();
+    shaderAOUpsample.setInt("aoInput", 0);
+    shaderAOUpsample.setInt("linearDepth", 1);
+    shaderAOUpsample.setInt("aoNormal", 2);
+    shaderAOUpsample.setInt("gDepth", 3);
+    shaderAOUpsample.setInt("gNormal", 4);
+    shaderDeinterleave.use();
+    shaderDeinterleave.setInt("linearDepth", 0);
+    shaderReinterleave.use();
+    shaderReinterleave.setInt("aoLayers", 0);
+    shaderDepthPyramid.use();
+    shaderDepthPyramid.setInt("depthInput", 0);
+    auto configureAOScale = [&]()
+    {
+        shaderAODownsample.use();
+        shaderAODownsample.setInt("scale", targets.aoScale);
+        shaderAOUpsample.use();
+        shaderAOUpsample.setFloat("scale", (float)targets.aoScale);
+    };
+    configureAOScale();
 
     // timers initialization
     // ---------------------
-    unsigned int queries[3];
-    const int QUERY_AO_START = 0;
-    const int QUERY_AO_END = 1;
-    const int QUERY_AO_BLUR_END = 2;
-    glGenQueries(std::size(queries), queries);
+    Profiler<RecordFrameInfo> profiler;
     float timeAccumulated = 0.0f;
 
     std::vector<RecordFrame> recordFrames;
+    RecordFrameInfo recordInfo = { renderMode, enableBlur, false, 0, srcWidth, srcHeight, aoScale, deinterleaveAO, depthPyramidAO, computeAO };
+    std::vector<QualityResult> qualityResults(benchmark.quality ? benchmark.getRunCount() : 0);
+    std::vector<CpuAOResult> cpuResults;
+    std::vector<CpuRasterResult> cpuRasterResults;
+    auto flushReport = [&]()
+    {
+        if (benchmark.quality)
+        {
+            // the AO of the CPU pipeline costs its CPU time and the upload
+            std::vector<double> aoTimes, blurTimes;
+            for (const auto& frame : recordFrames)
+            {
+                double aoMs = 0.0;
+                for (const auto& zone : frame.zones)
+                {
+                    if (zone.name == "ao")
+                        aoMs += zone.gpuMs;
+                    if (zone.name == "cpu_pipeline")
+                        aoMs += zone.cpuMs;
+                    if (zone.name == "blur")
+                        blurTimes.push_back(zone.gpuMs);
+                }
+                aoTimes.push_back(aoMs);
+            }
+            qualityResults[recordInfo.run].aoTimeMs = TimingStats::compute(aoTimes).average;
+            qualityResults[recordInfo.run].blurTimeMs = TimingStats::compute(blurTimes).average;
+            recordFrames.clear();
+            return;
+        }
+        if (sweeping)
+        {
+            // only the AO pass and the whole frame go into the cost matrix
+            std::vector<double> aoTimes, frameTimes;
+            for (const auto& frame : recordFrames)
+            {
+                for (const auto& zone : frame.zones)
+                {
+                    if (zone.gpuMs < 0.0)
+                        continue;
+                    if (zone.name == "ao")
+                        aoTimes.push_back(zone.gpuMs);
+                    if (zone.name == "frame")
+                        frameTimes.push_back(zone.gpuMs);
+                }
+            }
+            std::vector<double> values = sweep.point(recordInfo.run % benchmark.runsPerResolution);
+            std::string resolution = getResolutionName(recordInfo.width, recordInfo.height);
+            sweep.addResult(resolution, values, aoTimes, frameTimes);
+            printf("%s %s", sweep.mode.c_str(), resolution.c_str());
+            for (size_t i = 0; i < values.size(); i++)
+                printf(" %s=%g", sweep.parameters[i].name.c_str(), values[i]);
+            printf(": ao %.3f ms (p90 %.3f ms), frame %.3f ms\n", sweep.results.back().ao.average, sweep.results.back().ao.p90, sweep.results.back().frame.average);
+            recordFrames.clear();
+            return;
+        }
+        writeReport(recordInfo, recordFrames, !benchmark.resolutions.empty());
+        if (headless)
+        {
+            // geometry pass and AO cost of the run, with the passes preparing the AO input (linear depth, reduced
+            // AO resolution, depth pyramid, deinterleaving) and bringing its result back; the CPU pipeline is timed
+            // on the CPU (rasterizer and AO engine), its "ao" zone is the upload
+            bool cpuPipeline = usesCpuPipeline(recordInfo.mode);
+            printf("%s (blur %s, %ux%u, ao scale %u%s):", getRenderModeName(recordInfo.mode).c_str(), recordInfo.blur ? "on" : "off",
+                recordInfo.width, recordInfo.height, recordInfo.aoScale,
+                cpuPipeline ? ", cpu pipeline" : recordInfo.compute ? ", compute" : recordInfo.deinterleave ? ", deinterleaved" :
+                recordInfo.depthPyramid ? ", depth pyramid" : "");
+            for (const char* zoneName : { "gbuffer", "cpu_pipeline", "cpu_pipeline/raster", "cpu_pipeline/ao", "ao_downsample", "ao",
+                "ao/depth_pyramid", "ao/deinterleave", "ao/reinterleave", "ao_upsample" })
+            {
+                std::vector<double> times;
+                for (const auto& frame : recordFrames)
+                {
+                    for (const auto& zone : frame.zones)
+                    {
+                        if (zone.name == zoneName)
+                            times.push_back(zone.gpuMs >= 0.0 ? zone.gpuMs : zone.cpuMs);
+                    }
+                }
+                if (times.empty())
+                    continue;
+                printf(" %s %.3f ms", zoneName, TimingStats::compute(times).average);
+                if (times.size() < recordFrames.size())
+                    printf(" (%zu of %zu frames)", times.size(), recordFrames.size());
+                printf(",");
+            }
+            printf(" report written\n");
+        }
+        recordFrames.clear();
+    };
+    auto collectTimings = [&]()
+    {
+        RecordFrameInfo frameInfo;
+        std::vector<ProfileZoneResult> zones;
+        while (profiler.popFrame(frameInfo, zones))
+        {
+            // recording stopped or recorded state changed (e.g. next headless run): previous recording is complete
+            bool recordingChanged = !frameInfo.record || frameInfo.mode != recordInfo.mode || frameInfo.blur != recordInfo.blur ||
+                frameInfo.run != recordInfo.run || frameInfo.width != recordInfo.width || frameInfo.height != recordInfo.height ||
+                frameInfo.aoScale != recordInfo.aoScale || frameInfo.deinterleave != recordInfo.deinterleave ||
+                frameInfo.depthPyramid != recordInfo.depthPyramid || frameInfo.compute != recordInfo.compute;
+            if (!recordFrames.empty() && recordingChanged)
+                flushReport();
+            if (!frameInfo.record)
+                continue;
+
+            if (!headless && timeAccumulated > 0.2f)
+            {
+                for (const auto& zone : zones)
+                {
+                    if (zone.name == "frame" || zone.name == "ao" || zone.name == "blur")
+                        printf("%s(ms): %f ", zone.name.c_str(), zone.gpuMs);
+                }
+                printf("\n");
+                timeAccumulated = 0.0f;
+            }
+            recordFrames.push_back({ zones });
+            recordInfo = frameInfo;
+        }
+    };
+    size_t cameraPathFrame = 0;
 
     // render loop
     // -----------
-    lastFrame = static_cast<float>(glfwGetTime());
-    while (!glfwWindowShouldClose(window))
+    lastFrame = static_cast<float>(getTime());
+    while (headless ? !benchmark.isFinished() : !glfwWindowShouldClose(window))
     {
         // per-frame time logic
         // --------------------
-        float currentFrame = static_cast<float>(glfwGetTime());
-        deltaTime = currentFrame - lastFrame;
+        float currentFrame = static_cast<float>(getTime());
+        deltaTime = playCameraPath ? CAMERA_PATH_TIMESTEP : currentFrame - lastFrame;
         lastFrame = currentFrame;
 
+        // every frame is timed, results are collected without waiting for the GPU
         timeAccumulated += deltaTime;
-        if (inRecordMode && timeAccumulated > 0.2f)
-        {
-            uint64_t timestamps[std::size(queries)];
-            for (int i = 0; i < std::size(queries); i++)
-            {
-                glGetQueryObjectui64v(queries[i], GL_QUERY_RESULT, &timestamps[i]);
-            }
-
-            double aoTimeMs = (timestamps[QUERY_AO_END] - timestamps[QUERY_AO_START]) / 1000000.0;
-            double blurTimeMs = (timestamps[QUERY_AO_BLUR_END] - timestamps[QUERY_AO_END]) / 1000000.0;
-            printf("ao(ms): %f, blur(ms): %f\n", aoTimeMs, blurTimeMs);
-            recordFrames.push_back({ aoTimeMs, blurTimeMs });
+        collectTimings();
 
-            timeAccumulated = 0.0f;
-        }
-        if (!inRecordMode && !recordFrames.empty())
+        // every sweep point starts a new run with shaders specialized for its settings
+        int benchmarkRun = benchmark.run;
+        int benchmarkView = benchmark.quality ? benchmark.getView() : 0;
+        if (sweeping && benchmark.frame == 0)
         {
-            auto renderModeName = getRenderModeName(renderMode);
-            std::ofstream report("report_" + renderModeName + ".txt");
-            auto aoTimeLimits = std::minmax_element(recordFrames.begin(), recordFrames.end(), 
-                [](auto& f1, auto& f2) { return f1.aoTimeMs < f2.aoTimeMs; });
-            auto blurTimeLimits = std::minmax_element(recordFrames.begin(), recordFrames.end(),
-                [](auto& f1, auto& f2) { return f1.blurTimeMs < f2.blurTimeMs; });
+            std::vector<double> values = sweep.point(benchmark.getLocalRun());
+            for (size_t i = 0; i < values.size(); i++)
+                aoSettings.set(benchmark.sweepMode, sweep.parameters[i].name, values[i]);
+            rebuildAOShaders();
+        }
+        profiler.beginFrame({ renderMode, enableBlur, inRecordMode, benchmarkRun, srcWidth, srcHeight, aoScale, deinterleaveAO, depthPyramidAO, computeAO });
 
-            double aoTimeAverage = 0.0f, blurTimeAverage = 0.0f;
-            for (const auto& frame : recordFrames)
+        // input
+        // -----
+        {
+            ScopedCpuZone<RecordFrameInfo> inputZone(profiler, "input");
+            if (headless)
             {
-                aoTimeAverage += frame.aoTimeMs;
-                blurTimeAverage += frame.blurTimeMs;
+                benchmark.apply(renderMode, enableBlur, deinterleaveAO, depthPyramidAO, computeAO, inRecordMode, srcWidth, srcHeight);
+                if (benchmark.quality)
+                    cameraPath.apply(camera, benchmark.getView());
+                else if (playCameraPath)
+                    cameraPath.apply(camera, benchmark.pathFrame());
+                benchmark.nextFrame();
             }
-            aoTimeAverage /= recordFrames.size();
-            blurTimeAverage /= recordFrames.size();
-            
-            double aoTimeDeviation = 0.0f, blurTimeDeviation = 0.0f;
-            for (const auto& frame : recordFrames)
+            else
             {
-                aoTimeDeviation += (frame.aoTimeMs - aoTimeAverage) * (frame.aoTimeMs - aoTimeAverage);
-                blurTimeDeviation += (frame.blurTimeMs - blurTimeAverage) * (frame.blurTimeMs - blurTimeAverage);
+                processInput(window);
+                if (playCameraPath)
+                    cameraPath.apply(camera, cameraPathFrame++);
+                else if (!cameraPathRecordFile.empty())
+                    cameraPath.record(camera);
             }
-            aoTimeDeviation = sqrt(aoTimeDeviation / recordFrames.size());
-            blurTimeDeviation = sqrt(blurTimeDeviation / recordFrames.size());
-
-            report << "render mode: " << renderModeName << "\n";
-
-            report << "ao \n";
-            report << "  avg time (ms): " << aoTimeAverage << "\n";
-            report << "  dev time (ms): " << aoTimeDeviation << "\n";
-            report << "  min time (ms): " << aoTimeLimits.first->aoTimeMs << "\n";
-            report << "  max time (ms): " << aoTimeLimits.second->aoTimeMs << "\n";
+        }
 
-            report << "blur \n";
-            report << "  avg time (ms): " << blurTimeAverage << "\n";
-            report << "  dev time (ms): " << blurTimeDeviation << "\n";
-            report << "  min time (ms): " << blurTimeLimits.first->blurTimeMs << "\n";
-            report << "  max time (ms): " << blurTimeLimits.second->blurTimeMs << "\n";
+        // depth pyramid was toggled (key or headless run)
+        if (depthPyramidAO != aoShadersDepthPyramid)
+            rebuildAOShaders();
 
-            report.close();
-            recordFrames.clear();
+        // window was resized or a headless run changed the resolution, camera path may change zoom
+        if (srcWidth != targets.width || srcHeight != targets.height || aoScale != targets.aoScale)
+        {
+            targets.create(srcWidth, srcHeight, aoScale, headless);
+            glViewport(0, 0, srcWidth, srcHeight);
+            updateProjection();
+            configureAOShaders();
+            configureAOScale();
         }
-
-        // input
-        // -----
-        processInput(window);
+        else if (camera.Zoom != projectionZoom)
+        {
+            updateProjection();
+            configureAOShaders();
+        }
+        profiler.currentFrameInfo() = { renderMode, enableBlur, inRecordMode, benchmarkRun, srcWidth, srcHeight, aoScale, deinterleaveAO, depthPyramidAO, computeAO };
 
         // render
         // ------
+        glBindFramebuffer(GL_FRAMEBUFFER, targets.screenFBO);
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+        // screen space AO reads the G-buffer depth and normals, at a reduced resolution a downsampled G-buffer with linear depth
+        bool screenSpaceAO = renderMode == RenderMode::SSAO || renderMode == RenderMode::HBAO || renderMode == RenderMode::GTAO;
+        bool reducedAO = screenSpaceAO && targets.aoScale > 1;
+        // the CPU pipeline rasterizes its own G-buffer, the geometry pass then only feeds the lighting pass
+        bool cpuPipeline = usesCpuPipeline(renderMode);
+
         // 1. geometry pass: render scene's geometry/color data into gbuffer
         // -----------------------------------------------------------------
-        glBindFramebuffer(GL_FRAMEBUFFER, gBuffer);
-            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-            glm::mat4 view = camera.GetViewMatrix();
-            glm::mat4 invView = glm::inverse(view);
-            glm::mat4 model = glm::mat4(1.0f);
-            shaderGeometryPass.use();
-            shaderGeometryPass.setMat4("projection", projection);
-            shaderGeometryPass.setMat4("view", view);
-            // room cube
-            model = glm::mat4(1.0f);
-            model = glm::translate(model, glm::vec3(0.0, 7.0f, 0.0f));
-            model = glm::scale(model, glm::vec3(7.5f, 7.5f, 7.5f));
-            shaderGeometryPass.setMat4("model", model);
-            shaderGeometryPass.setInt("invertedNormals", 1); // invert normals as we're inside the cube
-            renderCube();
-            shaderGeometryPass.setInt("invertedNormals", 0); 
-            // models renderer (we dont care about instancing as we measuring screen space ssao afterwards)
-            for (int i = 0; i < 3; i++)
-            {
-                float xOffset[] = {-3.0f, 0.0f, 3.0f};
-                model = glm::mat4(1.0f);
-                model = glm::translate(model, glm::vec3(xOffset[i], -0.2f, 3.0));
-                model = glm::rotate(model, glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
-                model = glm::scale(model, glm::vec3(0.3f));
-                shaderGeometryPass.setMat4("model", model);
-                mainModel.Draw(shaderGeometryPass);
-            }
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-        glQueryCounter(queries[QUERY_AO_START], GL_TIMESTAMP);
-        if (renderMode == RenderMode::SSAO)
+        glm::mat4 view = camera.GetViewMatrix();
+        glm::mat4 invView = glm::inverse(view);
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-                glClear(GL_COLOR_BUFFER_BIT);
-                shaderSSAO.use();
-                for (unsigned int i = 0; i < kernelSize; ++i)
-                    shaderSSAO.setVec3("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
-                glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, gDepth);
-                glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, gNormal);
-                glActiveTexture(GL_TEXTURE2);
-                glBindTexture(GL_TEXTURE_2D, ssaoNoiseTexture);
-                renderFullScreen();
+            ScopedGpuZone<RecordFrameInfo> gbufferZone(profiler, "gbuffer");
+            glBindFramebuffer(GL_FRAMEBUFFER, targets.gBuffer);
+                glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+                glm::mat4 model = glm::mat4(1.0f);
+                shaderGeometryPass.use();
+                shaderGeometryPass.setMat4("projection", projection);
+                shaderGeometryPass.setMat4("view", view);
+                // room cube
+                model = getRoomTransform();
+                shaderGeometryPass.setMat4("model", model);
+                shaderGeometryPass.setInt("invertedNormals", 1); // invert normals as we're inside the cube
+                {
+                    ScopedGpuZone<RecordFrameInfo> cubeZone(profiler, "cube");
+                    renderCube();
+                }
+                shaderGeometryPass.setInt("invertedNormals", 0); 
+                // models renderer (we dont care about instancing as we measuring screen space ssao afterwards)
+                for (int i = 0; i < SCENE_MODEL_COUNT; i++)
+                {
+                    model = getModelTransform(i);
+                    shaderGeometryPass.setMat4("model", model);
+                    ScopedGpuZone<RecordFrameInfo> modelZone(profiler, "model" + std::to_string(i));
+                    renderModel(mainModel, shaderGeometryPass, profiler);
+                }
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
         }
-        if (renderMode == RenderMode::HBAO)
+
+        unsigned int aoDepthInput = reducedAO ? targets.linearDepth : targets.gDepth;
+        unsigned int aoNormalInput = reducedAO ? targets.aoNormal : targets.gNormal;
+        glViewport(0, 0, targets.aoWidth, targets.aoHeight);
+        if (reducedAO)
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-                glClear(GL_COLOR_BUFFER_BIT);
-                shaderHBAO.use();
+            ScopedGpuZone<RecordFrameInfo> downsampleZone(profiler, "ao_downsample");
+            glBindFramebuffer(GL_FRAMEBUFFER, targets.aoInputFBO);
+                shaderAODownsample.use();
                 glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, gDepth);
+                glBindTexture(GL_TEXTURE_2D, targets.gDepth);
                 glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, hbaoNoiseTexture);
+                glBindTexture(GL_TEXTURE_2D, targets.gNormal);
                 renderFullScreen();
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
         }
+
         if (renderMode == RenderMode::GTAO)
         {
-            glm::vec2 params = glm::vec2(
+            gtaoParams = glm::vec2(
                 GTAO_ROTATIONS[gtaoSampleIndex % 6] / 360.0f,
                 GTAO_OFFSETS[(gtaoSampleIndex / 6) % 4]
             );
-            glBindFramebuffer(GL_FRAMEBUFFER, ssaoFBO);
-                glClear(GL_COLOR_BUFFER_BIT);
-                shaderGTAO.use();
-                shaderGTAO.setVec2("params", params);
-                shaderGTAO.setMat4("invView", invView);
+            gtaoSampleIndex = (gtaoSampleIndex + 1) % 24;
+        }
+        if (cpuPipeline)
+        {
+            // the geometry pass runs on the GPU while the CPU renders the AO
+            glFlush();
+            ScopedCpuZone<RecordFrameInfo> pipelineZone(profiler, "cpu_pipeline");
+            {
+                ScopedCpuZone<RecordFrameInfo> rasterZone(profiler, "raster");
+                cpuKernels->rasterizeGBuffer(getCpuRasterView(view), rasterScene, cpuPipelineGBuffer, *cpuPipelineScheduler);
+            }
+            {
+                ScopedCpuZone<RecordFrameInfo> cpuAOZone(profiler, "ao");
+                if (renderMode == RenderMode::SSAO)
+                    cpuKernels->renderSSAO(getCpuSSAOSettings(), cpuPipelineGBuffer, cpuPipelineImage, *cpuPipelineScheduler);
+                if (renderMode == RenderMode::HBAO)
+                    cpuKernels->renderHBAO(getCpuHBAOSettings(), cpuPipelineGBuffer, cpuPipelineImage, *cpuPipelineScheduler);
+                if (renderMode == RenderMode::GTAO)
+                    cpuKernels->renderGTAO(getCpuGTAOSettings(invView), cpuPipelineGBuffer, cpuPipelineImage, *cpuPipelineScheduler);
+                // AO and the depth bilateral_blur.fs weights its taps with, packed like the shaders do (30 * view space z)
+                cpuPipelineTexels.resize(cpuPipelineImage.pixels.size());
+                for (size_t i = 0; i < cpuPipelineTexels.size(); i++)
+                {
+                    float viewZ = -(CAMERA_NEAR_PLANE + cpuPipelineGBuffer.linearDepth[i] * (CAMERA_FAR_PLANE - CAMERA_NEAR_PLANE));
+                    cpuPipelineTexels[i] = glm::vec2(cpuPipelineImage.pixels[i], 30.0f * viewZ);
+                }
+            }
+        }
+
+        bool computePass = computeAO && screenSpaceAO && !cpuPipeline;
+        bool deinterleaved = deinterleaveAO && !computePass && !cpuPipeline && (renderMode == RenderMode::SSAO || renderMode == RenderMode::HBAO);
+        {
+            ScopedGpuZone<RecordFrameInfo> aoZone(profiler, "ao");
+            // the depth pyramid replaces the depth inputs of the fragment passes that are not deinterleaved
+            if (depthPyramidAO && screenSpaceAO && !deinterleaved && !computePass && !cpuPipeline)
+            {
+                ScopedGpuZone<RecordFrameInfo> pyramidZone(profiler, "depth_pyramid");
+                shaderDepthPyramid.use();
+                glActiveTexture(GL_TEXTURE0);
+                for (unsigned int level = 0; level < targets.depthPyramidLevels; level++)
+                {
+                    if (level == 0)
+                        glBindTexture(GL_TEXTURE_2D, aoDepthInput);
+                    else
+                    {
+                        // only the previous level is visible while the next one is written
+                        glBindTexture(GL_TEXTURE_2D, targets.depthPyramid);
+                        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level - 1);
+                        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, level - 1);
+                    }
+                    glViewport(0, 0, targets.getDepthPyramidWidth(level), targets.getDepthPyramidHeight(level));
+                    glBindFramebuffer(GL_FRAMEBUFFER, targets.depthPyramidFBOs[level]);
+                    shaderDepthPyramid.setInt("level", level);
+                    renderFullScreen();
+                }
+                glBindTexture(GL_TEXTURE_2D, targets.depthPyramid);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+                glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, targets.depthPyramidLevels - 1);
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                glViewport(0, 0, targets.aoWidth, targets.aoHeight);
+                aoDepthInput = targets.depthPyramid;
+            }
+            if (cpuPipeline)
+            {
+                glBindTexture(GL_TEXTURE_2D, targets.ssaoColorBuffer);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, srcWidth, srcHeight, GL_RG, GL_FLOAT, cpuPipelineTexels.data());
+            }
+            if (computePass)
+            {
+                // one work group per tile, the AO goes straight into ssaoColorBuffer
+                ComputeShader& shaderCompute = renderMode == RenderMode::SSAO ? *shaderSSAOCompute :
+                    renderMode == RenderMode::HBAO ? *shaderHBAOCompute : *shaderGTAOCompute;
+                shaderCompute.use();
+                if (renderMode == RenderMode::SSAO)
+                {
+                    for (unsigned int i = 0; i < ssaoKernel.size(); ++i)
+                        shaderCompute.setVec3("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
+                }
+                if (renderMode == RenderMode::GTAO)
+                {
+                    shaderCompute.setVec2("params", gtaoParams);
+                    shaderCompute.setMat4("invView", invView);
+                }
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D, aoDepthInput);
+                if (renderMode == RenderMode::HBAO)
+                {
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, hbaoNoiseTexture);
+                }
+                else
+                {
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, aoNormalInput);
+                    glActiveTexture(GL_TEXTURE2);
+                    glBindTexture(GL_TEXTURE_2D, renderMode == RenderMode::SSAO ? ssaoNoiseTexture : gtaoNoiseTexture);
+                }
+                shaderCompute.setInt("aoOutput", 0);
+                glBindImageTexture(0, targets.ssaoColorBuffer, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+                glDispatchCompute((targets.aoWidth + COMPUTE_AO_TILE_SIZE - 1) / COMPUTE_AO_TILE_SIZE,
+                    (targets.aoHeight + COMPUTE_AO_TILE_SIZE - 1) / COMPUTE_AO_TILE_SIZE, 1);
+                // blur, upsample and lighting sample the AO, quality runs read it back
+                glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+            }
+            if (renderMode == RenderMode::SSAO && !deinterleaved && !computePass && !cpuPipeline)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, targets.ssaoFBO);
+                    glClear(GL_COLOR_BUFFER_BIT);
+                    shaderSSAO.use();
+                    for (unsigned int i = 0; i < ssaoKernel.size(); ++i)
+                        shaderSSAO.setVec3("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, aoDepthInput);
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, aoNormalInput);
+                    glActiveTexture(GL_TEXTURE2);
+                    glBindTexture(GL_TEXTURE_2D, ssaoNoiseTexture);
+                    renderFullScreen();
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            }
+            if (renderMode == RenderMode::HBAO && !deinterleaved && !computePass && !cpuPipeline)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, targets.ssaoFBO);
+                    glClear(GL_COLOR_BUFFER_BIT);
+                    shaderHBAO.use();
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, aoDepthInput);
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, hbaoNoiseTexture);
+                    renderFullScreen();
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            }
+            if (deinterleaved)
+            {
+                bool ssao = renderMode == RenderMode::SSAO;
+                Shader& shaderLayer = ssao ? shaderSSAODeinterleaved : shaderHBAODeinterleaved;
+                glViewport(0, 0, targets.layerWidth, targets.layerHeight);
+
+                {
+                    ScopedGpuZone<RecordFrameInfo> deinterleaveZone(profiler, "deinterleave");
+                    shaderDeinterleave.use();
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, aoDepthInput);
+                    for (unsigned int pass = 0; pass < DEINTERLEAVE_PASSES; pass++)
+                    {
+                        glBindFramebuffer(GL_FRAMEBUFFER, targets.deinterleaveFBOs[pass]);
+                        shaderDeinterleave.setInt("firstRow", pass * DEINTERLEAVE_LAYERS_PER_PASS / DEINTERLEAVE_FACTOR);
+                        renderFullScreen();
+                    }
+                }
+
+                shaderLayer.use();
+                if (ssao)
+                {
+                    for (unsigned int i = 0; i < ssaoKernel.size(); ++i)
+                        shaderLayer.setVec3("samples[" + std::to_string(i) + "]", ssaoKernel[i]);
+                }
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_2D_ARRAY, targets.depthLayers);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_2D, aoNormalInput);
+                for (unsigned int layer = 0; layer < DEINTERLEAVE_LAYERS; layer++)
+                {
+                    // the layer holds pixels (x, y) modulo 4, its jitter is the noise texel the full image uses for them
+                    glm::vec2 pixel(layer % DEINTERLEAVE_FACTOR, layer / DEINTERLEAVE_FACTOR);
+                    glm::vec2 layerOffset = (pixel + 0.5f - 0.5f * DEINTERLEAVE_FACTOR) / glm::vec2(targets.aoWidth, targets.aoHeight);
+                    glBindFramebuffer(GL_FRAMEBUFFER, targets.aoLayerFBOs[layer]);
+                    shaderLayer.setInt("layer", layer);
+                    shaderLayer.setVec2("LayerOffset", layerOffset);
+                    if (ssao)
+                        shaderLayer.setVec3("jitter", ssaoNoise[layer]);
+                    else
+                        shaderLayer.setVec4("jitter", hbaoNoise[layer]);
+                    renderFullScreen();
+                }
+
+                {
+                    ScopedGpuZone<RecordFrameInfo> reinterleaveZone(profiler, "reinterleave");
+                    glViewport(0, 0, targets.aoWidth, targets.aoHeight);
+                    glBindFramebuffer(GL_FRAMEBUFFER, targets.ssaoFBO);
+                        shaderReinterleave.use();
+                        glActiveTexture(GL_TEXTURE0);
+                        glBindTexture(GL_TEXTURE_2D_ARRAY, targets.aoLayers);
+                        renderFullScreen();
+                    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                }
+            }
+            if (renderMode == RenderMode::GTAO && !computePass && !cpuPipeline)
+            {
+                glBindFramebuffer(GL_FRAMEBUFFER, targets.ssaoFBO);
+                    glClear(GL_COLOR_BUFFER_BIT);
+                    shaderGTAO.use();
+                    shaderGTAO.setVec2("params", gtaoParams);
+                    shaderGTAO.setMat4("invView", invView);
+                    glActiveTexture(GL_TEXTURE0);
+                    glBindTexture(GL_TEXTURE_2D, aoDepthInput);
+                    glActiveTexture(GL_TEXTURE1);
+                    glBindTexture(GL_TEXTURE_2D, aoNormalInput);
+                    glActiveTexture(GL_TEXTURE2);
+                    glBindTexture(GL_TEXTURE_2D, gtaoNoiseTexture);
+                    renderFullScreen();
+                glBindFramebuffer(GL_FRAMEBUFFER, 0);
+            }
+        }
+
+        {
+            ScopedGpuZone<RecordFrameInfo> blurZone(profiler, "blur");
+            if (enableBlur)
+            {
+                // horizontal pass into ssaoColorBufferBlurX, vertical pass from there into ssaoColorBufferBlur
+                unsigned int blurInputs[] = { targets.ssaoColorBuffer, targets.ssaoColorBufferBlurX };
+                unsigned int blurOutputs[] = { targets.ssaoColorBufferBlurX, targets.ssaoColorBufferBlur };
+                unsigned int blurFBOs[] = { targets.ssaoBlurXFBO, targets.ssaoBlurFBO };
+                glActiveTexture(GL_TEXTURE0);
+                for (int pass = 0; pass < 2; pass++)
+                {
+                    glm::vec2 direction(pass == 0, pass == 1);
+                    glBindTexture(GL_TEXTURE_2D, blurInputs[pass]);
+                    if (computePass)
+                    {
+                        // a work group per COMPUTE_BLUR_GROUP_SIZE pixels of a row (a column in the vertical pass)
+                        unsigned int lineLength = pass == 0 ? targets.aoWidth : targets.aoHeight;
+                        unsigned int lineCount = pass == 0 ? targets.aoHeight : targets.aoWidth;
+                        shaderBilateralBlurCompute->use();
+                        shaderBilateralBlurCompute->setVec2("direction", direction);
+                        glBindImageTexture(0, blurOutputs[pass], 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RG16F);
+                        glDispatchCompute((lineLength + COMPUTE_BLUR_GROUP_SIZE - 1) / COMPUTE_BLUR_GROUP_SIZE, lineCount, 1);
+                        glMemoryBarrier(GL_TEXTURE_FETCH_BARRIER_BIT | GL_TEXTURE_UPDATE_BARRIER_BIT);
+                    }
+                    else
+                    {
+                        glBindFramebuffer(GL_FRAMEBUFFER, blurFBOs[pass]);
+                        shaderBilateralBlur.use();
+                        shaderBilateralBlur.setVec2("direction", direction);
+                        renderFullScreen();
+                        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                    }
+                }
+            }
+        }
+        glViewport(0, 0, srcWidth, srcHeight);
+
+        // finilize to output
+        bool hasAO = renderMode != RenderMode::NONE;
+        unsigned int aoTexture = hasAO ?
+            (enableBlur ? targets.ssaoColorBufferBlur : targets.ssaoColorBuffer) :
+            emptyAOTexture;
+        if (reducedAO)
+        {
+            ScopedGpuZone<RecordFrameInfo> upsampleZone(profiler, "ao_upsample");
+            glBindFramebuffer(GL_FRAMEBUFFER, targets.aoUpsampleFBO);
+                shaderAOUpsample.use();
                 glActiveTexture(GL_TEXTURE0);
-                glBindTexture(GL_TEXTURE_2D, gGTAODepth);
+                glBindTexture(GL_TEXTURE_2D, aoTexture);
                 glActiveTexture(GL_TEXTURE1);
-                glBindTexture(GL_TEXTURE_2D, gNormal);
+                glBindTexture(GL_TEXTURE_2D, targets.linearDepth);
                 glActiveTexture(GL_TEXTURE2);
-                glBindTexture(GL_TEXTURE_2D, gtaoNoiseTexture);
+                glBindTexture(GL_TEXTURE_2D, targets.aoNormal);
+                glActiveTexture(GL_TEXTURE3);
+                glBindTexture(GL_TEXTURE_2D, targets.gDepth);
+                glActiveTexture(GL_TEXTURE4);
+                glBindTexture(GL_TEXTURE_2D, targets.gNormal);
                 renderFullScreen();
             glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-            gtaoSampleIndex = (gtaoSampleIndex + 1) % 24;
+            aoTexture = targets.aoUpsampled;
         }
-        glQueryCounter(queries[QUERY_AO_END], GL_TIMESTAMP);
 
-        if (enableBlur)
         {
-            glBindFramebuffer(GL_FRAMEBUFFER, ssaoBlurFBO);
-            glClear(GL_COLOR_BUFFER_BIT);
-            shaderBoxBlur.use();
+            ScopedGpuZone<RecordFrameInfo> lightingZone(profiler, "lighting");
+            glBindFramebuffer(GL_FRAMEBUFFER, targets.screenFBO);
+            glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+            shaderLightingPass.use();
+            shaderLightingPass.setBool("bakedAO", renderMode == RenderMode::BAKED);
             glActiveTexture(GL_TEXTURE0);
-            glBindTexture(GL_TEXTURE_2D, ssaoColorBuffer);
+            glBindTexture(GL_TEXTURE_2D, targets.gAlbedo);
+            glActiveTexture(GL_TEXTURE1);
+            glBindTexture(GL_TEXTURE_2D, targets.gNormal);
+            glActiveTexture(GL_TEXTURE2);
+            glBindTexture(GL_TEXTURE_2D, aoTexture);
             renderFullScreen();
-            glBindFramebuffer(GL_FRAMEBUFFER, 0);
         }
-        glQueryCounter(queries[QUERY_AO_BLUR_END], GL_TIMESTAMP);
-
+        profiler.endFrame();
 
-        // finilize to output
-        bool hasAO = renderMode != RenderMode::NONE;
-        unsigned int aoTexture = hasAO ?
-            (enableBlur ? ssaoColorBufferBlur : ssaoColorBuffer) :
-            emptyAOTexture;
+        // quality harness: AO of the last frame of a run is compared to the reference image of its view
+        if (benchmark.quality && benchmark.run != benchmarkRun)
+        {
+            QualityResult& result = qualityResults[benchmarkRun];
+            result.resolution = getResolutionName(srcWidth, srcHeight);
+            result.view = benchmarkView;
+            result.mode = renderMode;
+            result.blur = enableBlur;
+            std::string referencePath = qualityReferenceDir + "/reference_view" + std::to_string(result.view) + ".pfm";
+            AOImage reference;
+            if (!qualityReferenceDir.empty() && reference.loadPfm(referencePath))
+            {
+                if (reference.width == (int)srcWidth && reference.height == (int)srcHeight)
+                {
+                    result.quality = AOImageQuality::compute(readAOImage(aoTexture, srcWidth, srcHeight), reference);
+                    result.hasReference = true;
+                }
+                else
+                    std::cout << "reference " << referencePath << " is " << reference.width << "x" << reference.height << ", rendering " << result.resolution << "\n";
+            }
 
-        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        shaderLightingPass.use();
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, gAlbedo);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, gNormal);
-        glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, aoTexture);
-        renderFullScreen();
+            // CPU engines get the G-buffer of the same frame, their result is compared with the unblurred shader output
+            if (cpuAO && !enableBlur && targets.aoScale == 1 && !deinterleaveAO && !depthPyramidAO)
+            {
+                CpuGBuffer gBuffer = readGBuffer(targets);
+                AOImage gpuImage = readAOImage(targets.ssaoColorBuffer, srcWidth, srcHeight);
+                CpuAOResult cpuResult;
+                cpuResult.resolution = result.resolution;
+                cpuResult.view = result.view;
+                cpuResult.mode = renderMode;
+                if (renderMode == RenderMode::SSAO)
+                {
+                    measureCpuAO<SIMD_FLOAT_NAMESPACE::CpuSSAO>(getCpuSSAOSettings(), cpuKernels->renderSSAO, gBuffer, gpuImage, cpuResult);
+                    cpuResults.push_back(cpuResult);
+
+                    // the G-buffer does not depend on the AO mode, the rasterizer runs once per view
+                    CpuRasterResult rasterResult;
+                    rasterResult.resolution = result.resolution;
+                    rasterResult.view = result.view;
+                    measureCpuRaster(getCpuRasterView(view), rasterScene, cpuKernels->rasterizeGBuffer, gBuffer, rasterResult);
+                    cpuRasterResults.push_back(rasterResult);
+                }
+                if (renderMode == RenderMode::HBAO)
+                {
+                    measureCpuAO<SIMD_FLOAT_NAMESPACE::CpuHBAO>(getCpuHBAOSettings(), cpuKernels->renderHBAO, gBuffer, gpuImage, cpuResult);
+                    cpuResults.push_back(cpuResult);
+                }
+                if (renderMode == RenderMode::GTAO)
+                {
+                    measureCpuAO<SIMD_FLOAT_NAMESPACE::CpuGTAO>(getCpuGTAOSettings(invView), cpuKernels->renderGTAO, gBuffer, gpuImage, cpuResult);
+                    cpuResults.push_back(cpuResult);
+                }
+            }
+        }
 
 
         // glfw: swap buffers and poll IO events (keys pressed/released, mouse moved etc.)
         // -------------------------------------------------------------------------------
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+        if (!headless)
+        {
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
     }
 
-    glfwTerminate();
+    // frames still in flight are only waited for on exit
+    glFinish();
+    collectTimings();
+    if (!recordFrames.empty())
+        flushReport();
+    if (benchmark.quality)
+    {
+        for (const auto& result : qualityResults)
+        {
+            printf("view %d %s (blur %s, %s): ao %.3f ms, blur %.3f ms", result.view, getRenderModeName(result.mode).c_str(),
+                result.blur ? "on" : "off", result.resolution.c_str(), result.aoTimeMs, result.blurTimeMs);
+            if (result.hasReference)
+                printf(", rmse %.4f, psnr %.2f dB, ssim %.4f", result.quality.rmse, result.quality.psnr, result.quality.ssim);
+            printf("\n");
+        }
+        if (writeQualityReport("quality.csv", qualityResults))
+            std::cout << "quality report written: quality.csv\n";
+    }
+    if (cpuAO)
+    {
+        std::cout << "cpu ao kernels: " << getCpuISAName(cpuKernels->isa) << " (" << cpuKernels->width << " lanes)\n";
+        for (const auto& result : cpuResults)
+        {
+            printf("cpu %s view %d (%s): naive %.1f ms, simd %.1f ms, %d threads %.1f ms (%.1fx), max diff %.4f, mismatches %.3f%%\n",
+                getRenderModeName(result.mode).c_str(), result.view, result.resolution.c_str(), result.naiveMs, result.simdMs,
+                result.threads, result.threadedMs, result.naiveMs / result.threadedMs, result.maxDifference, result.mismatchFraction * 100.0);
+            printf("  scaling:");
+            for (const auto& point : result.scaling)
+                printf(" %d threads %.1f ms (%.2fx, utilization %.0f%%)", point.threads, point.ms, result.simdMs / point.ms, point.utilization * 100.0);
+            printf("\n");
+        }
+        if (writeCpuAOReport("cpu_ao.csv", *cpuKernels, cpuResults))
+            std::cout << "cpu ao report written: cpu_ao.csv\n";
+        if (writeCpuAOScalingReport("cpu_ao_scaling.csv", cpuResults))
+            std::cout << "cpu ao scaling report written: cpu_ao_scaling.csv\n";
+        for (const auto& result : cpuRasterResults)
+        {
+            printf("cpu raster view %d (%s): %zu triangles, 1 thread %.1f ms, %d threads %.1f ms, hi-z rejects %zu tiles %zu blocks, "
+                "mismatches depth %.3f%% normal %.3f%%\n", result.view, result.resolution.c_str(), result.stats.triangles, result.singleMs,
+                result.threads, result.threadedMs, result.stats.tileHiZRejects, result.stats.blockHiZRejects,
+                result.linearDepthMismatchFraction * 100.0, result.normalMismatchFraction * 100.0);
+        }
+        if (writeCpuRasterReport("cpu_raster.csv", *cpuKernels, cpuRasterResults))
+            std::cout << "cpu raster report written: cpu_raster.csv\n";
+    }
+    if (sweeping)
+    {
+        std::string costMatrixPath = "sweep_" + sweep.mode + ".csv";
+        std::vector<std::pair<std::string, std::string>> metadata = {
+            { "camera", cameraSource },
+            { "blur", "on" },
+            { "gl_renderer", (const char*)glGetString(GL_RENDERER) },
+        };
+        if (sweep.writeCostMatrix(costMatrixPath, metadata))
+            std::cout << "cost matrix written: " << costMatrixPath << " (" << sweep.results.size() << " points)\n";
+    }
+    if (profiler.getDroppedFrames() > 0)
+        std::cout << "warning: " << profiler.getDroppedFrames() << " frames were not timed, GPU was more than " << GPU_TIMER_FRAMES_IN_FLIGHT << " frames behind\n";
+    if (!cameraPathRecordFile.empty() && cameraPath.save(cameraPathRecordFile))
+        std::cout << "camera path saved: " << cameraPathRecordFile << " (" << cameraPath.size() << " frames)\n";
+
+    if (headless)
+        headlessContext.destroy();
+    else
+        glfwTerminate();
     return 0;
 }
 
+// time in seconds, glfw timer is not available without a window
+// -------------------------------------------------------------
+double getTime()
+{
+    if (!headless)
+        return glfwGetTime();
+    static auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// draws every mesh of the model in its own timing zone
+// -----------------------------------------------------
+void renderModel(Model& model, Shader& shader, Profiler<RecordFrameInfo>& profiler)
+{
+    for (unsigned int i = 0; i < model.meshes.size(); i++)
+    {
+        ScopedGpuZone<RecordFrameInfo> meshZone(profiler, "mesh" + std::to_string(i));
+        model.meshes[i].Draw(shader);
+    }
+}
+
 // renderCube() renders a 1x1 3D cube in NDC.
 // -------------------------------------------------
 unsigned int cubeVAO = 0;
@@ -652,55 +2547,11 @@ void renderCube()
     // initialize (if necessary)
     if (cubeVAO == 0)
     {
-        float vertices[] = {
-            // back face
-            -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
-             1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
-             1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 0.0f, // bottom-right         
-             1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 1.0f, 1.0f, // top-right
-            -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 0.0f, // bottom-left
-            -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, -1.0f, 0.0f, 1.0f, // top-left
-            // front face
-            -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
-             1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 0.0f, // bottom-right
-             1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
-             1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 1.0f, 1.0f, // top-right
-            -1.0f,  1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 1.0f, // top-left
-            -1.0f, -1.0f,  1.0f,  0.0f,  0.0f,  1.0f, 0.0f, 0.0f, // bottom-left
-            // left face
-            -1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
-            -1.0f,  1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-left
-            -1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
-            -1.0f, -1.0f, -1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-left
-            -1.0f, -1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-right
-            -1.0f,  1.0f,  1.0f, -1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-right
-            // right face
-             1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
-             1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
-             1.0f,  1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 1.0f, // top-right         
-             1.0f, -1.0f, -1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 1.0f, // bottom-right
-             1.0f,  1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 1.0f, 0.0f, // top-left
-             1.0f, -1.0f,  1.0f,  1.0f,  0.0f,  0.0f, 0.0f, 0.0f, // bottom-left     
-            // bottom face
-            -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
-             1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 1.0f, // top-left
-             1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
-             1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 1.0f, 0.0f, // bottom-left
-            -1.0f, -1.0f,  1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 0.0f, // bottom-right
-            -1.0f, -1.0f, -1.0f,  0.0f, -1.0f,  0.0f, 0.0f, 1.0f, // top-right
-            // top face
-            -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
-             1.0f,  1.0f , 1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
-             1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 1.0f, // top-right     
-             1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 1.0f, 0.0f, // bottom-right
-            -1.0f,  1.0f, -1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 1.0f, // top-left
-            -1.0f,  1.0f,  1.0f,  0.0f,  1.0f,  0.0f, 0.0f, 0.0f  // bottom-left        
-        };
         glGenVertexArrays(1, &cubeVAO);
         glGenBuffers(1, &cubeVBO);
         // fill buffer
         glBindBuffer(GL_ARRAY_BUFFER, cubeVBO);
-        glBufferData(GL_ARRAY_BUFFER, sizeof(vertices), vertices, GL_STATIC_DRAW);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(CUBE_VERTICES), CUBE_VERTICES, GL_STATIC_DRAW);
         // link vertex attributes
         glBindVertexArray(cubeVAO);
         glEnableVertexAttribArray(0);
@@ -747,9 +2598,6 @@ void processInput(GLFWwindow *window)
     if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS)
         camera.ProcessKeyboard(RIGHT, deltaTime);
 
-    if (glfwGetKey(window, GLFW_KEY_B) == GLFW_PRESS)
-        enableBlur = !enableBlur;
-
     if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS)
         inRecordMode = true;
     if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS)
@@ -763,6 +2611,37 @@ void processInput(GLFWwindow *window)
         renderMode = RenderMode::HBAO;
     if (glfwGetKey(window, GLFW_KEY_3) == GLFW_PRESS)
         renderMode = RenderMode::GTAO;
+    if (glfwGetKey(window, GLFW_KEY_4) == GLFW_PRESS)
+        renderMode = RenderMode::BAKED;
+}
+
+// glfw: whenever a key is pressed, this callback is called; toggles flip once per press instead of every frame the key is held
+// ----------------------------------------------------------------------------------------------------------------------------
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+    if (action != GLFW_PRESS)
+        return;
+
+    if (key == GLFW_KEY_B)
+        enableBlur = !enableBlur;
+    if (key == GLFW_KEY_I)
+        deinterleaveAO = !deinterleaveAO;
+    if (key == GLFW_KEY_P)
+        depthPyramidAO = !depthPyramidAO;
+    if (key == GLFW_KEY_C)
+        computeAO = !computeAO && computeAOSupported;
+}
+
+// glfw: whenever the window size changed (by OS or user resize) this callback function executes
+// ---------------------------------------------------------------------------------------------
+void framebuffer_size_callback(GLFWwindow* window, int width, int height)
+{
+    // minimized window has an empty framebuffer, keep the previous resolution
+    if (width > 0 && height > 0)
+    {
+        srcWidth = width;
+        srcHeight = height;
+    }
 }
 
 // glfw: whenever the mouse moves, this callback is called
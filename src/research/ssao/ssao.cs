@@ -0,0 +1,154 @@
+// Compute shader version of ssao.fs: a work group copies the linear depth of its tile and an apron around it
+// into shared memory once, the kernel samples of its pixels read depth from there.
+
+#version 430 core
+
+// sample count is specialized by the application like ssao.fs, the tile layout with it
+#ifndef KERNEL_SIZE
+#define KERNEL_SIZE 16
+#endif
+#ifndef GROUP_SIZE
+#define GROUP_SIZE 16
+#endif
+#ifndef TILE_SIZE
+#define TILE_SIZE 32
+#endif
+#ifndef TILE_APRON
+#define TILE_APRON 24
+#endif
+
+layout (local_size_x = GROUP_SIZE, local_size_y = GROUP_SIZE) in;
+
+// AO and packed depth, like the output of ssao.fs
+layout (rg16f) uniform writeonly image2D aoOutput;
+
+uniform sampler2D gNormal;
+// linear depth (ao_downsample.fs) or the G-buffer depth (HARDWARE_DEPTH)
+uniform sampler2D linearDepth;
+// near and far plane of the linear depth
+uniform vec2 clipPlanes;
+uniform vec2 UVToViewA;
+uniform vec2 UVToViewB;
+uniform sampler2D texNoise;
+
+uniform vec3 samples[KERNEL_SIZE];
+
+uniform float sampleRadius = 0.5;
+uniform float bias = 0.025;
+
+const float DEPTH_RANGE_MAX = 0.02;
+
+const int kernelSize = KERNEL_SIZE;
+
+uniform mat4 proj;
+
+// every invocation shades PIXELS_PER_THREAD x PIXELS_PER_THREAD pixels of the tile
+const int PIXELS_PER_THREAD = TILE_SIZE / GROUP_SIZE;
+// linear depth of the tile and TILE_APRON pixels around it, wrapped like the GL_REPEAT texture
+const int TILE_WIDTH = TILE_SIZE + 2 * TILE_APRON;
+shared float depthTile[TILE_WIDTH * TILE_WIDTH];
+ivec2 tileOrigin;
+
+#ifdef HARDWARE_DEPTH
+// the input is the G-buffer's depth buffer (AO at the render resolution), linearized like ao_downsample.fs does
+uniform vec2 LinMAD;
+
+float LinearizeDepth(float depth)
+{
+    if (depth == 1.0)
+        return 1.0; // far plane, nothing rendered
+    return (1.0 / (LinMAD.x * (depth * 2.0 - 1.0) + LinMAD.y) - clipPlanes.x) / (clipPlanes.y - clipPlanes.x);
+}
+#else
+float LinearizeDepth(float depth)
+{
+    return depth;
+}
+#endif
+
+float FetchLinearDepth(ivec2 pixel)
+{
+    ivec2 size = textureSize(linearDepth, 0);
+    pixel -= size * ivec2(floor(vec2(pixel) / vec2(size)));
+    return LinearizeDepth(texelFetch(linearDepth, pixel, 0).r);
+}
+
+void LoadDepthTile()
+{
+    tileOrigin = ivec2(gl_WorkGroupID.xy) * TILE_SIZE - TILE_APRON;
+    for (int i = int(gl_LocalInvocationIndex); i < TILE_WIDTH * TILE_WIDTH; i += GROUP_SIZE * GROUP_SIZE)
+        depthTile[i] = FetchLinearDepth(tileOrigin + ivec2(i % TILE_WIDTH, i / TILE_WIDTH));
+    barrier();
+}
+
+// samples beyond the apron read the texture
+float LinearDepth(ivec2 pixel)
+{
+    ivec2 local = pixel - tileOrigin;
+    if (all(greaterThanEqual(local, ivec2(0))) && all(lessThan(local, ivec2(TILE_WIDTH))))
+        return depthTile[local.y * TILE_WIDTH + local.x];
+    return FetchLinearDepth(pixel);
+}
+
+// nearest texel like texture() in ssao.fs
+float ViewSpaceZ(vec2 uv)
+{
+    float d = LinearDepth(ivec2(floor(uv * vec2(textureSize(linearDepth, 0)))));
+    return -(clipPlanes.x + d * (clipPlanes.y - clipPlanes.x));
+}
+
+mat3 computeTBN(vec3 normal, ivec2 pixel)
+{
+    vec3 randomVec = texelFetch(texNoise, pixel % textureSize(texNoise, 0), 0).xyz;
+
+    vec3 tangent = cross(randomVec, normal);
+    vec3 bitangent = cross(normal, tangent);
+    return mat3(tangent, bitangent, normal);
+}
+
+vec4 projectPosition(vec3 position)
+{
+    vec4 p = vec4(position, 1.0);
+    p = proj * p;
+    p.xyz /= p.w;
+    p.xy = p.xy * 0.5 + 0.5;
+    return p;
+}
+
+vec2 ComputeAO(ivec2 pixel, vec2 uv)
+{
+    float fragZ = ViewSpaceZ(uv);
+    vec3 fragPos = vec3((UVToViewA * uv + UVToViewB) * fragZ, fragZ);
+    vec3 normal = 2.0 * texture(gNormal, uv).rgb - 1.0;
+    mat3 TBN = computeTBN(normal, pixel);
+
+    float occlusion = 0.0;
+    for(int i = 0; i < kernelSize; ++i)
+    {
+        vec3 samplePos = TBN * samples[i];
+        samplePos = fragPos + samplePos * sampleRadius;
+
+        vec4 offset = projectPosition(samplePos);
+        float sampleZ = ViewSpaceZ(offset.xy);
+
+        float rangeCheck = step(1.0, dot(samplePos - fragPos, samplePos - fragPos) / DEPTH_RANGE_MAX);
+        occlusion += (sampleZ >= fragPos.z + bias ? 1.0 : 0.0) * rangeCheck;
+    }
+
+    return vec2(1.0 - (occlusion / kernelSize), 30.0 * fragPos.z);
+}
+
+void main()
+{
+    LoadDepthTile();
+
+    // pixels of an invocation are GROUP_SIZE apart, neighbouring invocations shade neighbouring pixels
+    ivec2 size = imageSize(aoOutput);
+    for (int i = 0; i < PIXELS_PER_THREAD * PIXELS_PER_THREAD; i++)
+    {
+        ivec2 pixel = ivec2(gl_WorkGroupID.xy) * TILE_SIZE + ivec2(gl_LocalInvocationID.xy) +
+            GROUP_SIZE * ivec2(i % PIXELS_PER_THREAD, i / PIXELS_PER_THREAD);
+        if (all(lessThan(pixel, size)))
+            imageStore(aoOutput, pixel, vec4(ComputeAO(pixel, (vec2(pixel) + 0.5) / vec2(size)), 0.0, 0.0));
+    }
+}
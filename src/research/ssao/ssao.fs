@@ -1,39 +1,102 @@
 #version 330 core
 
-out float FragColor;
+// AO and the depth bilateral_blur.fs weights its taps with, packed like hbao.fs does (30 * view space z)
+out vec2 FragColor;
 
 in vec2 TexCoord;
 
-uniform sampler2D gDepth;
 uniform sampler2D gNormal;
+#ifdef DEINTERLEAVED
+// one of the 4x4 layers of view space depth (deinterleave.fs), TexCoord addresses the layer
+uniform sampler2DArray layerDepth;
+uniform int layer;
+// uv of the full image = layer uv * LayerScale + LayerOffset
+uniform vec2 LayerScale;
+uniform vec2 LayerOffset;
+uniform vec2 UVToViewA;
+uniform vec2 UVToViewB;
+// noise of the layer's pixels, the same for all of them
+uniform vec3 jitter;
+#else
+// linear depth (ao_downsample.fs) or the G-buffer depth (HARDWARE_DEPTH), a linear depth mip chain when DEPTH_PYRAMID
+// is defined (depth_pyramid.fs):
+// samples farther away then read coarser levels
+uniform sampler2D linearDepth;
+// near and far plane of the linear depth
+uniform vec2 clipPlanes;
+uniform vec2 UVToViewA;
+uniform vec2 UVToViewB;
 uniform sampler2D texNoise;
+#endif
 
-uniform vec3 samples[16];
+// sample count is specialized by the application (SSAO_KERNEL_SIZE)
+#ifndef KERNEL_SIZE
+#define KERNEL_SIZE 16
+#endif
+
+uniform vec3 samples[KERNEL_SIZE];
 
 uniform float sampleRadius = 0.5;
 uniform float bias = 0.025;
 
 const float DEPTH_RANGE_MAX = 0.02;
 
-const int kernelSize = 16;
+const int kernelSize = KERNEL_SIZE;
 
-const float SCREEN_WIDTH = 1600;
-const float SCREEN_HEIGHT = 900;
-const vec2 noiseScale = vec2(SCREEN_WIDTH / 4.0, SCREEN_HEIGHT / 4.0); 
+// render resolution / noise texture resolution
+uniform vec2 noiseScale;
 
 uniform mat4 proj;
-uniform mat4 invProj;
 
-vec3 reconstructPosition(float z, vec2 texcoords)
+#ifndef DEINTERLEAVED
+#ifdef HARDWARE_DEPTH
+// the input is the G-buffer's depth buffer (AO at the render resolution), linearized like ao_downsample.fs does
+uniform vec2 LinMAD;
+
+float LinearizeDepth(float depth)
+{
+    if (depth == 1.0)
+        return 1.0; // far plane, nothing rendered
+    return (1.0 / (LinMAD.x * (depth * 2.0 - 1.0) + LinMAD.y) - clipPlanes.x) / (clipPlanes.y - clipPlanes.x);
+}
+#else
+float LinearizeDepth(float depth)
+{
+    return depth;
+}
+#endif
+
+#ifdef DEPTH_PYRAMID
+// last level of the pyramid, fewer than DEPTH_PYRAMID_LEVELS at small AO resolutions
+uniform int depthPyramidMaxLevel;
+
+// mip 0 for samples up to 8 pixels away, one level coarser per doubling of the distance
+int DepthPyramidLevel(float pixelDistance)
+{
+    return clamp(int(log2(max(pixelDistance, 1.0))) - 3, 0, depthPyramidMaxLevel);
+}
+#endif
+
+float ViewSpaceZ(vec2 uv, int level)
 {
-    vec4 projected = vec4(2.0 * texcoords - 1.0, z, 1.0f);
-    vec4 position = invProj * projected;
-    return position.xyz / position.w;
+#ifdef DEPTH_PYRAMID
+    // nearest texel of the level, like texture() on mip 0
+    ivec2 size = textureSize(linearDepth, level);
+    float d = texelFetch(linearDepth, clamp(ivec2(uv * vec2(size)), ivec2(0), size - 1), level).r;
+#else
+    float d = LinearizeDepth(texture(linearDepth, uv).r);
+#endif
+    return -(clipPlanes.x + d * (clipPlanes.y - clipPlanes.x));
 }
+#endif
 
 mat3 computeTBN(vec3 normal)
 {
+#ifdef DEINTERLEAVED
+    vec3 randomVec = jitter;
+#else
     vec3 randomVec = texture(texNoise, TexCoord * noiseScale).xyz;
+#endif
 
     vec3 tangent = cross(randomVec, normal);
     vec3 bitangent = cross(normal, tangent);
@@ -51,9 +114,19 @@ vec4 projectPosition(vec3 position)
 
 void main()
 {
-    float fragDepth = texture(gDepth, TexCoord).r;
-    vec3 fragPos = reconstructPosition(fragDepth, TexCoord);
-    vec3 normal = 2.0 * texture(gNormal, TexCoord).rgb - 1.0;
+#ifdef DEINTERLEAVED
+    vec2 uv = TexCoord * LayerScale + LayerOffset;
+    float fragZ = texture(layerDepth, vec3(TexCoord, layer)).r;
+    vec3 fragPos = vec3((UVToViewA * uv + UVToViewB) * fragZ, fragZ);
+#else
+    vec2 uv = TexCoord;
+    float fragZ = ViewSpaceZ(TexCoord, 0);
+    vec3 fragPos = vec3((UVToViewA * uv + UVToViewB) * fragZ, fragZ);
+#endif
+#ifdef DEPTH_PYRAMID
+    vec2 depthSize = vec2(textureSize(linearDepth, 0));
+#endif
+    vec3 normal = 2.0 * texture(gNormal, uv).rgb - 1.0;
     mat3 TBN = computeTBN(normal);
     
     float occlusion = 0.0;
@@ -64,14 +137,20 @@ void main()
         
         vec4 offset = projectPosition(samplePos);
 
-        float sampleDepth = texture(gDepth, offset.xy).r;
-        vec3 sampleFragPos = reconstructPosition(sampleDepth, offset.xy);
+#ifdef DEINTERLEAVED
+        // nearest pixel of the same layer
+        float sampleZ = texture(layerDepth, vec3((offset.xy - LayerOffset) / LayerScale, layer)).r;
+#elif defined(DEPTH_PYRAMID)
+        float sampleZ = ViewSpaceZ(offset.xy, DepthPyramidLevel(length((offset.xy - TexCoord) * depthSize)));
+#else
+        float sampleZ = ViewSpaceZ(offset.xy, 0);
+#endif
         
         float rangeCheck = step(1.0, dot(samplePos - fragPos, samplePos - fragPos) / DEPTH_RANGE_MAX);
-        occlusion += (sampleFragPos.z >= fragPos.z + bias ? 1.0 : 0.0) * rangeCheck;  
+        occlusion += (sampleZ >= fragPos.z + bias ? 1.0 : 0.0) * rangeCheck;  
     }
 
     occlusion = 1.0 - (occlusion / kernelSize);
     
-    FragColor = occlusion;
+    FragColor = vec2(occlusion, 30.0 * fragPos.z);
 }
@@ -0,0 +1,12 @@
+// CPU AO kernels built with -mavx2 -mfma (CMakeLists.txt), picked at runtime by cpu_dispatch.h
+#include "cpu_dispatch.h"
+
+const CpuAOKernels* getCpuAOKernelsAVX2()
+{
+#if defined(SIMD_FLOAT_AVX2)
+    static const CpuAOKernels kernels = SIMD_FLOAT_NAMESPACE::makeCpuAOKernels<SIMD_FLOAT_NAMESPACE::Float8>(CpuISA::AVX2);
+    return &kernels;
+#else
+    return nullptr;
+#endif
+}
@@ -0,0 +1,12 @@
+// CPU AO kernels built with -mavx512f -mavx2 -mfma (CMakeLists.txt), picked at runtime by cpu_dispatch.h
+#include "cpu_dispatch.h"
+
+const CpuAOKernels* getCpuAOKernelsAVX512()
+{
+#if defined(SIMD_FLOAT_AVX512)
+    static const CpuAOKernels kernels = SIMD_FLOAT_NAMESPACE::makeCpuAOKernels<SIMD_FLOAT_NAMESPACE::Float16>(CpuISA::AVX512);
+    return &kernels;
+#else
+    return nullptr;
+#endif
+}
@@ -0,0 +1,12 @@
+// CPU AO kernels built with -msse4.2 (CMakeLists.txt), picked at runtime by cpu_dispatch.h
+#include "cpu_dispatch.h"
+
+const CpuAOKernels* getCpuAOKernelsSSE42()
+{
+#if defined(__SSE4_2__)
+    static const CpuAOKernels kernels = SIMD_FLOAT_NAMESPACE::makeCpuAOKernels<SIMD_FLOAT_NAMESPACE::Float4>(CpuISA::SSE42);
+    return &kernels;
+#else
+    return nullptr;
+#endif
+}
@@ -0,0 +1,94 @@
+#ifndef TILE_SCHEDULER_H
+#define TILE_SCHEDULER_H
+
+#include "parallel_for.h"
+
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// per thread counters of the last TileScheduler::forEachTile call
+struct TileSchedulerThreadStats
+{
+    int tiles = 0;       // tiles run by the thread
+    int steals = 0;      // tiles taken from the queue of another thread
+    double busyMs = 0.0; // time spent in the tile body
+};
+
+// Work-stealing job system for screen tiles. Every thread owns a deque that starts with a contiguous band
+// of tiles; it runs them front to back, and once it is empty steals from the back of the other deques, so
+// threads that got cheap tiles (sky pixels exit early) help with the expensive ones.
+// Worker threads are created once and wait between calls, the calling thread works as thread 0.
+// Only forEachTile is inline: the rest is defined in cpu_ao.cpp, so the kernels in ssao_kernels_*.cpp do not
+// compile their own copy of it (see cpu_dispatch.h).
+class TileScheduler
+{
+public:
+    explicit TileScheduler(int threadCount = 0);
+    ~TileScheduler();
+
+    TileScheduler(const TileScheduler&) = delete;
+    TileScheduler& operator=(const TileScheduler&) = delete;
+
+    int getThreadCount() const { return (int)queues.size(); }
+
+    // calls tileBody(x0, y0, x1, y1) for every tileSize tile of the image and returns when all of them are done
+    template <typename TileBody>
+    void forEachTile(int width, int height, int tileSize, const TileBody& tileBody)
+    {
+        run(width, height, tileSize, [](const void* body, int x0, int y0, int x1, int y1)
+        {
+            (*(const TileBody*)body)(x0, y0, x1, y1);
+        }, &tileBody);
+    }
+
+    const std::vector<TileSchedulerThreadStats>& getStats() const { return stats; }
+    double getWallMs() const { return wallMs; }
+
+    // share of the last call's wall time the thread spent running tiles
+    double getUtilization(int thread) const
+    {
+        return wallMs > 0.0 ? stats[thread].busyMs / wallMs : 0.0;
+    }
+
+private:
+    struct Tile
+    {
+        int x0, y0, x1, y1;
+    };
+
+    typedef void (*TileFunction)(const void* body, int x0, int y0, int x1, int y1);
+
+    // padded to a cache line, so threads popping their own queue do not share lines
+    struct alignas(64) TileQueue
+    {
+        std::mutex mutex;
+        std::deque<Tile> tiles;
+    };
+
+    std::vector<std::unique_ptr<TileQueue>> queues;
+    std::vector<TileSchedulerThreadStats> stats;
+    std::vector<std::thread> threads;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    TileFunction jobFunction = nullptr;
+    const void* jobBody = nullptr;
+    unsigned int generation = 0;
+    int runningWorkers = 0;
+    bool stopping = false;
+    double wallMs = 0.0;
+
+    void run(int width, int height, int tileSize, TileFunction function, const void* body);
+    void workerLoop(int thread);
+    // runs tiles of the own queue, then stolen ones, until every queue is empty; tiles never add tiles,
+    // so a thread that finds all queues empty is done
+    void runTiles(int thread);
+    bool takeTile(int thread, Tile& tile, bool& stolen);
+};
+
+#endif